@@ -0,0 +1,1047 @@
+/*
+ * libhids - Isolation Forest scoring for host-based intrusion detection
+ *
+ * Core shared by the frontends: tree building, flattened forests, batched
+ * scoring and the model file format. See hids.h for the API.
+ *
+ * Build:
+ *   static:  gcc -O2 -fPIC -fvisibility=hidden -c hids.c && ar rcs libhids.a hids.o
+ *   shared:  gcc -O2 -fPIC -fvisibility=hidden -shared -o libhids.so hids.c -lm
+ */
+
+#include "hids.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+// ==================== MODEL ====================
+
+#define HIDS_MODEL_MAGIC 0x4D444948u  // "HIDM"
+#define HIDS_MODEL_VERSION 5          // 2 stores the normalizer and threshold, 3 sources, 4 baseline, 5 c(2) = 1
+#define HIDS_SKLEARN_MAGIC 0x4C4B5348u  // "HSKL"
+#define HIDS_SKLEARN_VERSION 1
+#define HIDS_EULER_GAMMA 0.5772156649015329  // As numpy.euler_gamma
+#define HIDS_DRIFT_EPSILON 1e-4       // Floor on bin shares, so empty bins keep PSI finite
+
+// Flattened tree node; children are indices into the model's node array
+typedef struct {
+    int32_t split_attribute;          // -1 for a leaf
+    int32_t split_value;
+    int32_t left;                     // -1 if none
+    int32_t right;                    // -1 if none
+    double leaf_adjust;               // c(size) for leaves
+} HidsNode;
+
+// Trees [first_tree, first_tree + num_trees) of a merged model came from
+// one host's forest and keep its normalizer
+typedef struct {
+    char host[HIDS_HOST_MAX];
+    uint32_t first_tree;
+    uint32_t num_trees;
+    uint32_t subsample_size;
+    uint32_t reserved;
+    double c_norm;                    // c(subsample_size) of the host's forest
+    double weight;                    // Share of the score, relative to other sources
+} HidsSource;
+
+// Training-time distribution of one feature, or of scores
+typedef struct {
+    double mean;
+    double variance;
+    double edges[HIDS_DRIFT_BINS - 1];  // Deciles; bin b holds edges[b - 1] < x <= edges[b]
+    double share[HIDS_DRIFT_BINS];      // Fraction of baseline samples in each bin
+} HidsBaseline;
+
+struct hids_model {
+    uint32_t num_features;
+    uint32_t num_trees;
+    uint32_t subsample_size;
+    uint32_t max_depth;
+    double c_norm;                    // c(subsample_size)
+    double threshold;                 // Anomaly cut-off
+    int32_t *roots;                   // Root node of each tree
+    HidsNode *nodes;                  // All trees back to back
+    uint32_t num_nodes;
+    uint32_t capacity;
+    HidsSource *sources;              // None unless merged by hids_merge_forests()
+    uint32_t num_sources;
+    double *tree_scale;               // Per tree: source weight / (trees * c), with sources
+    HidsBaseline *baseline;           // num_features entries then scores, or NULL
+};
+
+// Model file header, followed by num_trees int32 roots, num_nodes
+// HidsNodes, num_sources HidsSources and num_baseline HidsBaselines, all
+// in host byte order
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t node_size;               // sizeof(HidsNode)
+    uint32_t num_features;
+    uint32_t num_trees;
+    uint32_t subsample_size;
+    uint32_t max_depth;
+    uint32_t num_nodes;
+    double c_norm;                    // Version 2 on
+    double threshold;
+    uint32_t num_sources;             // Version 3 on
+    uint32_t num_baseline;            // Version 4 on: 0 or num_features + 1
+} HidsModelHeader;
+
+uint32_t hids_version(void) {
+    return HIDS_API_VERSION;
+}
+
+const char* hids_strerror(hids_status status) {
+    switch (status) {
+    case HIDS_OK: return "success";
+    case HIDS_ERR_ARGUMENT: return "invalid argument";
+    case HIDS_ERR_NOMEM: return "out of memory";
+    case HIDS_ERR_IO: return "I/O error";
+    case HIDS_ERR_FORMAT: return "not a compatible model file";
+    }
+    return "unknown error";
+}
+
+// c(n) = 2 H(n - 1) - 2 (n - 1) / n, with H(1) = 1 exactly and larger
+// harmonic numbers approximated by ln(i) + Euler's constant
+double hids_c_factor(int n) {
+    if (n <= 1) return 0.0;
+    if (n == 2) return 1.0;
+    double harmonic = log(n - 1) + 0.5772156649;  // Euler's constant approximation
+    return 2.0 * harmonic - (2.0 * (n - 1.0) / n);
+}
+
+void hids_model_free(hids_model *model) {
+    if (model == NULL) return;
+    free(model->roots);
+    free(model->nodes);
+    free(model->sources);
+    free(model->tree_scale);
+    free(model->baseline);
+    free(model);
+}
+
+uint32_t hids_model_features(const hids_model *model) {
+    return model != NULL ? model->num_features : 0;
+}
+
+uint32_t hids_model_trees(const hids_model *model) {
+    return model != NULL ? model->num_trees : 0;
+}
+
+hids_status hids_model_root(const hids_model *model, uint32_t tree, int32_t *root) {
+    if (model == NULL || root == NULL || tree >= model->num_trees) return HIDS_ERR_ARGUMENT;
+    *root = model->roots[tree];
+    return HIDS_OK;
+}
+
+hids_status hids_model_node(const hids_model *model, int32_t index, hids_node_info *info) {
+    if (model == NULL || info == NULL || index < 0 || (uint32_t)index >= model->num_nodes) return HIDS_ERR_ARGUMENT;
+    const HidsNode *node = &model->nodes[index];
+    info->feature = node->split_attribute;
+    info->threshold = node->split_value;
+    info->left = node->left;
+    info->right = node->right;
+    info->leaf_adjust = node->leaf_adjust;
+    return HIDS_OK;
+}
+
+double hids_model_threshold(const hids_model *model) {
+    return model != NULL ? model->threshold : HIDS_DEFAULT_THRESHOLD;
+}
+
+uint32_t hids_model_sources(const hids_model *model) {
+    return model != NULL ? model->num_sources : 0;
+}
+
+hids_status hids_model_source(const hids_model *model, uint32_t index, hids_source_info *info) {
+    if (model == NULL || info == NULL || index >= model->num_sources) return HIDS_ERR_ARGUMENT;
+    const HidsSource *source = &model->sources[index];
+    double total = 0;
+    for (uint32_t s = 0; s < model->num_sources; s++) total += model->sources[s].weight;
+    info->host = source->host;
+    info->num_trees = source->num_trees;
+    info->subsample_size = source->subsample_size;
+    info->weight = source->weight / total;
+    return HIDS_OK;
+}
+
+hids_model* hids_model_alloc(uint32_t num_trees, uint32_t capacity) {
+    hids_model *model = (hids_model*)calloc(1, sizeof(hids_model));
+    if (model == NULL) return NULL;
+    model->roots = (int32_t*)malloc(num_trees * sizeof(int32_t));
+    model->nodes = (HidsNode*)malloc((capacity > 0 ? capacity : 1) * sizeof(HidsNode));
+    if (model->roots == NULL || model->nodes == NULL) {
+        hids_model_free(model);
+        return NULL;
+    }
+    model->num_trees = num_trees;
+    model->capacity = capacity;
+    return model;
+}
+
+// ==================== TRAINING ====================
+
+// Training state for one model; the generator keeps training reentrant
+typedef struct {
+    hids_model *model;
+    const int32_t *samples;
+    size_t stride;
+    uint64_t rng;                     // xorshift64 state
+    int failed;
+} HidsBuilder;
+
+uint64_t hids_random(HidsBuilder *b) {
+    b->rng ^= b->rng << 13;
+    b->rng ^= b->rng >> 7;
+    b->rng ^= b->rng << 17;
+    return b->rng;
+}
+
+// Uniform integer in [min, max]
+int32_t hids_random_int(HidsBuilder *b, int32_t min, int32_t max) {
+    return min + (int32_t)(hids_random(b) % (uint64_t)((int64_t)max - min + 1));
+}
+
+int32_t hids_new_node(HidsBuilder *b) {
+    hids_model *model = b->model;
+    if (model->num_nodes == model->capacity) {
+        uint32_t capacity = model->capacity ? 2 * model->capacity : 64;
+        HidsNode *nodes = (HidsNode*)realloc(model->nodes, capacity * sizeof(HidsNode));
+        if (nodes == NULL) {
+            b->failed = 1;
+            return -1;
+        }
+        model->nodes = nodes;
+        model->capacity = capacity;
+    }
+    HidsNode *node = &model->nodes[model->num_nodes];
+    node->split_attribute = -1;
+    node->split_value = 0;
+    node->left = node->right = -1;
+    node->leaf_adjust = 0.0;
+    return (int32_t)model->num_nodes++;
+}
+
+// Build a tree over the samples in indices, returning its root. Nodes are
+// stored in pre-order, so a subtree is one contiguous run of nodes.
+int32_t hids_build_tree(HidsBuilder *b, int32_t *indices, int n, uint32_t depth) {
+    int32_t index = hids_new_node(b);
+    if (index < 0) return -1;
+
+    int32_t attribute = hids_random_int(b, 0, (int32_t)b->model->num_features - 1);
+    int32_t min = 0, max = 0;
+    if (depth < b->model->max_depth && n > 1) {
+        min = max = b->samples[indices[0] * b->stride + attribute];
+        for (int i = 1; i < n; i++) {
+            int32_t value = b->samples[indices[i] * b->stride + attribute];
+            if (value < min) min = value;
+            if (value > max) max = value;
+        }
+    }
+    if (min == max) {
+        b->model->nodes[index].leaf_adjust = hids_c_factor(n);
+        return index;
+    }
+    int32_t split = hids_random_int(b, min, max);
+
+    // Partition in place: samples below the split first
+    int left = 0;
+    for (int i = 0; i < n; i++) {
+        if (b->samples[indices[i] * b->stride + attribute] < split) {
+            int32_t t = indices[i];
+            indices[i] = indices[left];
+            indices[left++] = t;
+        }
+    }
+    int32_t left_child = left > 0 ? hids_build_tree(b, indices, left, depth + 1) : -1;
+    int32_t right_child = n - left > 0 ? hids_build_tree(b, indices + left, n - left, depth + 1) : -1;
+    HidsNode *node = &b->model->nodes[index];
+    node->split_attribute = attribute;
+    node->split_value = split;
+    node->left = left_child;
+    node->right = right_child;
+    return index;
+}
+
+void hids_train_options_default(hids_train_options *options) {
+    options->num_features = 20;
+    options->num_trees = 10;
+    options->subsample_size = 8;
+    options->max_depth = 10;
+    options->seed = 0;
+}
+
+hids_status hids_train(const int32_t *samples, size_t n, size_t stride,
+                       const hids_train_options *options, hids_model **out) {
+    if (samples == NULL || n == 0 || n > INT32_MAX || options == NULL || out == NULL ||
+        options->num_features == 0 || options->num_features > HIDS_MAX_FEATURES || stride < options->num_features ||
+        options->num_trees == 0 || options->num_trees > HIDS_MAX_TREES || options->subsample_size == 0 ||
+        options->max_depth > HIDS_MAX_DEPTH) {
+        return HIDS_ERR_ARGUMENT;
+    }
+
+    uint32_t subsample = options->subsample_size < n ? options->subsample_size : (uint32_t)n;
+    hids_model *model = hids_model_alloc(options->num_trees, 2 * subsample * options->num_trees);
+    int32_t *indices = (int32_t*)malloc(subsample * sizeof(int32_t));
+    if (model == NULL || indices == NULL) {
+        hids_model_free(model);
+        free(indices);
+        return HIDS_ERR_NOMEM;
+    }
+    model->num_features = options->num_features;
+    model->subsample_size = subsample;
+    model->max_depth = options->max_depth;
+    model->c_norm = hids_c_factor(subsample);
+    model->threshold = HIDS_DEFAULT_THRESHOLD;
+
+    HidsBuilder b = {model, samples, stride, options->seed, 0};
+    if (b.rng == 0) b.rng = (uint64_t)time(NULL) * 0x9E3779B97F4A7C15ull + (uint64_t)clock();
+    if (b.rng == 0) b.rng = 1;
+    for (uint32_t t = 0; t < model->num_trees && !b.failed; t++) {
+        for (uint32_t i = 0; i < subsample; i++) indices[i] = hids_random_int(&b, 0, (int32_t)n - 1);
+        model->roots[t] = hids_build_tree(&b, indices, subsample, 0);
+    }
+    free(indices);
+    if (b.failed) {
+        hids_model_free(model);
+        return HIDS_ERR_NOMEM;
+    }
+    *out = model;
+    return HIDS_OK;
+}
+
+// ==================== SCORING ====================
+
+// Path length of one sample in one tree, walking the flattened nodes
+double hids_path_length(const hids_model *model, int32_t root, const int32_t *sample) {
+    int32_t index = root;
+    for (uint32_t depth = 0; depth <= model->max_depth; depth++) {
+        if (index < 0) return depth;
+
+        const HidsNode *node = &model->nodes[index];
+        if (node->split_attribute < 0) return depth + node->leaf_adjust;
+
+        if (sample[node->split_attribute] < node->split_value && node->left >= 0) {
+            index = node->left;
+        } else if (node->right >= 0) {
+            index = node->right;
+        } else {
+            return depth;
+        }
+    }
+    return model->max_depth;
+}
+
+// Scores samples tree by tree, so each tree's nodes stay in cache while
+// all samples walk it
+hids_status hids_score_batch(const hids_model *model, const int32_t *samples, size_t n,
+                             size_t stride, double *scores) {
+    if (model == NULL || (n > 0 && (samples == NULL || scores == NULL)) || stride < model->num_features) {
+        return HIDS_ERR_ARGUMENT;
+    }
+    for (size_t i = 0; i < n; i++) scores[i] = 0.0;
+
+    // Merged trees are normalized one by one, in the same single pass
+    if (model->tree_scale != NULL) {
+        for (uint32_t t = 0; t < model->num_trees; t++) {
+            double scale = model->tree_scale[t];
+            for (size_t i = 0; i < n; i++) {
+                scores[i] += scale * hids_path_length(model, model->roots[t], samples + i * stride);
+            }
+        }
+        for (size_t i = 0; i < n; i++) scores[i] = pow(2.0, -scores[i]);
+        return HIDS_OK;
+    }
+    for (uint32_t t = 0; t < model->num_trees; t++) {
+        for (size_t i = 0; i < n; i++) scores[i] += hids_path_length(model, model->roots[t], samples + i * stride);
+    }
+    for (size_t i = 0; i < n; i++) {
+        scores[i] = model->c_norm != 0 ? pow(2.0, -(scores[i] / model->num_trees) / model->c_norm) : 0.5;
+    }
+    return HIDS_OK;
+}
+
+// ==================== MODEL FILES ====================
+
+uint32_t hids_baseline_count(const hids_model *model) {
+    return model->baseline != NULL ? model->num_features + 1 : 0;
+}
+
+int hids_baseline_valid(const HidsBaseline *b) {
+    if (!isfinite(b->mean) || !isfinite(b->variance) || b->variance < 0) return 0;
+    for (int i = 0; i < HIDS_DRIFT_BINS - 1; i++) {
+        if (!isfinite(b->edges[i]) || (i > 0 && b->edges[i] < b->edges[i - 1])) return 0;
+    }
+    for (int i = 0; i < HIDS_DRIFT_BINS; i++) {
+        if (!(b->share[i] >= 0 && b->share[i] <= 1)) return 0;
+    }
+    return 1;
+}
+
+// Check model->sources and derive each tree's scale from them. Sources
+// cover the trees in order, and each tree contributes
+// weight / (total weight * trees in its source * c of its source) times
+// its path length to the exponent.
+hids_status hids_model_set_sources(hids_model *model) {
+    double total = 0;
+    uint32_t next = 0;
+    for (uint32_t s = 0; s < model->num_sources; s++) {
+        HidsSource *source = &model->sources[s];
+        source->host[HIDS_HOST_MAX - 1] = '\0';
+        if (source->first_tree != next || source->num_trees == 0 || source->num_trees > model->num_trees - next ||
+            !(source->c_norm > 0) || !(source->weight > 0) || isinf(source->weight) || isinf(source->c_norm)) {
+            return HIDS_ERR_FORMAT;
+        }
+        next += source->num_trees;
+        total += source->weight;
+    }
+    if (next != model->num_trees || isinf(total)) return HIDS_ERR_FORMAT;
+
+    free(model->tree_scale);
+    model->tree_scale = (double*)malloc(model->num_trees * sizeof(double));
+    if (model->tree_scale == NULL) return HIDS_ERR_NOMEM;
+    for (uint32_t s = 0; s < model->num_sources; s++) {
+        const HidsSource *source = &model->sources[s];
+        double scale = source->weight / total / (source->num_trees * source->c_norm);
+        for (uint32_t t = 0; t < source->num_trees; t++) model->tree_scale[source->first_tree + t] = scale;
+    }
+    return HIDS_OK;
+}
+
+size_t hids_model_size(const hids_model *model) {
+    if (model == NULL) return 0;
+    return sizeof(HidsModelHeader) + model->num_trees * sizeof(int32_t) + model->num_nodes * sizeof(HidsNode) +
+           model->num_sources * sizeof(HidsSource) + hids_baseline_count(model) * sizeof(HidsBaseline);
+}
+
+hids_status hids_serialize(const hids_model *model, void *data, size_t size) {
+    if (model == NULL || data == NULL || size < hids_model_size(model)) return HIDS_ERR_ARGUMENT;
+    HidsModelHeader header = {HIDS_MODEL_MAGIC, HIDS_MODEL_VERSION, sizeof(HidsNode), model->num_features,
+                              model->num_trees, model->subsample_size, model->max_depth, model->num_nodes,
+                              model->c_norm, model->threshold, model->num_sources, hids_baseline_count(model)};
+    char *p = (char*)data;
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    memcpy(p, model->roots, model->num_trees * sizeof(int32_t));
+    p += model->num_trees * sizeof(int32_t);
+    memcpy(p, model->nodes, model->num_nodes * sizeof(HidsNode));
+    p += model->num_nodes * sizeof(HidsNode);
+    memcpy(p, model->sources, model->num_sources * sizeof(HidsSource));
+    p += model->num_sources * sizeof(HidsSource);
+    memcpy(p, model->baseline, hids_baseline_count(model) * sizeof(HidsBaseline));
+    return HIDS_OK;
+}
+
+hids_status hids_deserialize(const void *data, size_t size, hids_model **out) {
+    if (data == NULL || out == NULL) return HIDS_ERR_ARGUMENT;
+
+    // Older headers end before the normalizer and threshold (version 1)
+    // or the sources (version 2); version 3 has no baseline
+    HidsModelHeader header;
+    size_t fixed = offsetof(HidsModelHeader, c_norm);
+    int read = size >= fixed;
+    if (read) memcpy(&header, data, fixed);
+    read = read && header.magic == HIDS_MODEL_MAGIC && header.version >= 1 && header.version <= HIDS_MODEL_VERSION;
+    if (read && header.version == 1) {
+        header.c_norm = hids_c_factor(header.subsample_size);
+        header.threshold = HIDS_DEFAULT_THRESHOLD;
+    } else if (read) {
+        fixed = header.version == 2 ? offsetof(HidsModelHeader, num_sources) : sizeof(header);
+        read = size >= fixed;
+        if (read) memcpy(&header, data, fixed);
+    }
+    if (read && header.version < 3) header.num_sources = 0;
+    if (read && header.version < 4) header.num_baseline = 0;
+    if (!read || header.node_size != sizeof(HidsNode) ||
+        header.num_features == 0 || header.num_features > HIDS_MAX_FEATURES || header.num_trees == 0 ||
+        header.num_trees > HIDS_MAX_TREES || header.max_depth > HIDS_MAX_DEPTH || header.num_nodes == 0 ||
+        header.num_sources > header.num_trees ||
+        (header.num_baseline != 0 && header.num_baseline != header.num_features + 1) ||
+        size != fixed + header.num_trees * sizeof(int32_t) + (size_t)header.num_nodes * sizeof(HidsNode) +
+                header.num_sources * sizeof(HidsSource) + header.num_baseline * sizeof(HidsBaseline)) {
+        return HIDS_ERR_FORMAT;
+    }
+    hids_model *model = hids_model_alloc(header.num_trees, header.num_nodes);
+    if (model == NULL) return HIDS_ERR_NOMEM;
+    const char *p = (const char*)data + fixed;
+    memcpy(model->roots, p, header.num_trees * sizeof(int32_t));
+    memcpy(model->nodes, p + header.num_trees * sizeof(int32_t), header.num_nodes * sizeof(HidsNode));
+
+    // Every index must stay inside the node array
+    int ok = 1;
+    for (uint32_t t = 0; ok && t < header.num_trees; t++) ok = model->roots[t] >= 0 && (uint32_t)model->roots[t] < header.num_nodes;
+    for (uint32_t i = 0; ok && i < header.num_nodes; i++) {
+        const HidsNode *node = &model->nodes[i];
+        ok = node->split_attribute < (int32_t)header.num_features &&
+             node->left >= -1 && node->left < (int32_t)header.num_nodes &&
+             node->right >= -1 && node->right < (int32_t)header.num_nodes;
+    }
+    if (ok && header.num_sources > 0) {
+        model->sources = (HidsSource*)malloc(header.num_sources * sizeof(HidsSource));
+        if (model->sources == NULL) {
+            hids_model_free(model);
+            return HIDS_ERR_NOMEM;
+        }
+        memcpy(model->sources, p + header.num_trees * sizeof(int32_t) + header.num_nodes * sizeof(HidsNode),
+               header.num_sources * sizeof(HidsSource));
+        model->num_sources = header.num_sources;
+        hids_status status = hids_model_set_sources(model);
+        if (status != HIDS_OK) {
+            hids_model_free(model);
+            return status;
+        }
+    }
+    if (ok && header.num_baseline > 0) {
+        model->baseline = (HidsBaseline*)malloc(header.num_baseline * sizeof(HidsBaseline));
+        if (model->baseline == NULL) {
+            hids_model_free(model);
+            return HIDS_ERR_NOMEM;
+        }
+        memcpy(model->baseline, p + header.num_trees * sizeof(int32_t) + header.num_nodes * sizeof(HidsNode) +
+               header.num_sources * sizeof(HidsSource), header.num_baseline * sizeof(HidsBaseline));
+        for (uint32_t f = 0; ok && f < header.num_baseline; f++) ok = hids_baseline_valid(&model->baseline[f]);
+    }
+    if (!ok) {
+        hids_model_free(model);
+        return HIDS_ERR_FORMAT;
+    }
+
+    // Before version 5, c(2) was -1 (H(1) taken as 0). Leaves and the
+    // normalizer holding it get the right value; a score baseline recorded
+    // under it no longer matches the scores, so it is dropped.
+    if (header.version < 5) {
+        int converted = 0;
+        for (uint32_t i = 0; i < header.num_nodes; i++) {
+            HidsNode *node = &model->nodes[i];
+            if (node->split_attribute < 0 && node->leaf_adjust == -1.0) {
+                node->leaf_adjust = hids_c_factor(2);
+                converted = 1;
+            }
+        }
+        if (header.c_norm == -1.0) {
+            header.c_norm = hids_c_factor(2);
+            converted = 1;
+        }
+        if (converted) {
+            free(model->baseline);
+            model->baseline = NULL;
+        }
+    }
+    model->num_features = header.num_features;
+    model->subsample_size = header.subsample_size;
+    model->max_depth = header.max_depth;
+    model->num_nodes = header.num_nodes;
+    model->c_norm = header.c_norm;
+    model->threshold = header.threshold;
+    *out = model;
+    return HIDS_OK;
+}
+
+hids_status hids_save(const hids_model *model, const char *path) {
+    if (model == NULL || path == NULL) return HIDS_ERR_ARGUMENT;
+    size_t size = hids_model_size(model);
+    void *data = malloc(size);
+    if (data == NULL) return HIDS_ERR_NOMEM;
+    hids_serialize(model, data, size);
+
+    FILE *f = fopen(path, "wb");
+    int ok = f != NULL && fwrite(data, size, 1, f) == 1;
+    if (f != NULL && fclose(f) != 0) ok = 0;
+    free(data);
+    return ok ? HIDS_OK : HIDS_ERR_IO;
+}
+
+hids_status hids_load(const char *path, hids_model **out) {
+    if (path == NULL || out == NULL) return HIDS_ERR_ARGUMENT;
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return HIDS_ERR_IO;
+
+    long size = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+    void *data = size > 0 ? malloc(size) : NULL;
+    int ok = data != NULL && fseek(f, 0, SEEK_SET) == 0 && fread(data, size, 1, f) == 1;
+    fclose(f);
+    hids_status status = ok ? hids_deserialize(data, size, out) :
+                         size > 0 && data == NULL ? HIDS_ERR_NOMEM : size == 0 ? HIDS_ERR_FORMAT : HIDS_ERR_IO;
+    free(data);
+    return status;
+}
+
+// ==================== SCIKIT-LEARN IMPORT ====================
+
+// sklearn's _average_path_length(): Euler's constant is not truncated
+// there, so imported leaves and normalizer use this instead of
+// hids_c_factor()
+double hids_sklearn_c(double n) {
+    if (n <= 1) return 0.0;
+    if (n <= 2) return 1.0;
+    return 2.0 * (log(n - 1.0) + HIDS_EULER_GAMMA) - 2.0 * (n - 1.0) / n;
+}
+
+// One dumped sklearn node
+typedef struct {
+    int32_t left;
+    int32_t right;
+    int32_t feature;
+    int32_t n_node_samples;
+    double threshold;
+} HidsSklearnNode;
+
+// Append one dumped tree at model->nodes[base]. sklearn numbers children
+// after their parent, so a single forward pass assigns depths, and the
+// ordering check also rules out cycles.
+hids_status hids_import_tree(hids_model *model, const HidsSklearnNode *tree, uint32_t count, uint32_t base,
+                             uint8_t *depths) {
+    memset(depths, 0, count);
+    for (uint32_t i = 0; i < count; i++) {
+        const HidsSklearnNode *in = &tree[i];
+        HidsNode *node = &model->nodes[base + i];
+        node->left = node->right = -1;
+        node->split_value = 0;
+        node->leaf_adjust = 0.0;
+        if (in->left < 0 || in->right < 0) {
+            if (in->left != -1 || in->right != -1 || in->n_node_samples < 0) return HIDS_ERR_FORMAT;
+            node->split_attribute = -1;
+            node->leaf_adjust = hids_sklearn_c(in->n_node_samples);
+            continue;
+        }
+        if ((uint32_t)in->left <= i || (uint32_t)in->left >= count || (uint32_t)in->right <= i ||
+            (uint32_t)in->right >= count || in->feature < 0 || (uint32_t)in->feature >= model->num_features ||
+            in->threshold != in->threshold || depths[i] >= HIDS_MAX_DEPTH) {
+            return HIDS_ERR_FORMAT;
+        }
+
+        // Integer counts go left on x <= t, which is x < floor(t) + 1
+        double split = floor(in->threshold) + 1.0;
+        node->split_attribute = in->feature;
+        node->split_value = split <= INT32_MIN ? INT32_MIN : split >= INT32_MAX ? INT32_MAX : (int32_t)split;
+        node->left = (int32_t)(base + in->left);
+        node->right = (int32_t)(base + in->right);
+        depths[in->left] = depths[in->right] = depths[i] + 1;
+        if (depths[i] + 1u > model->max_depth) model->max_depth = depths[i] + 1u;
+    }
+    return HIDS_OK;
+}
+
+hids_status hids_import_sklearn(const char *path, hids_model **out) {
+    if (path == NULL || out == NULL) return HIDS_ERR_ARGUMENT;
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return HIDS_ERR_IO;
+
+    uint32_t header[6];
+    double offset;
+    if (fread(header, sizeof(header), 1, f) != 1 || fread(&offset, sizeof(offset), 1, f) != 1 ||
+        header[0] != HIDS_SKLEARN_MAGIC || header[1] != HIDS_SKLEARN_VERSION || header[2] == 0 ||
+        header[2] > HIDS_MAX_FEATURES || header[3] == 0 || header[3] > HIDS_MAX_TREES || header[4] == 0 || offset != offset) {
+        fclose(f);
+        return HIDS_ERR_FORMAT;
+    }
+    hids_model *model = hids_model_alloc(header[3], 0);
+    if (model == NULL) {
+        fclose(f);
+        return HIDS_ERR_NOMEM;
+    }
+    model->num_features = header[2];
+    model->subsample_size = header[4];
+    model->c_norm = hids_sklearn_c(header[4]);
+    model->threshold = -offset;
+
+    hids_status status = HIDS_OK;
+    HidsSklearnNode *tree = NULL;
+    uint8_t *depths = NULL;
+    for (uint32_t t = 0; t < model->num_trees && status == HIDS_OK; t++) {
+        uint32_t count;
+        if (fread(&count, sizeof(count), 1, f) != 1 || count == 0 || count >= 2 * (uint64_t)model->subsample_size ||
+            model->num_nodes > INT32_MAX - count) {
+            status = HIDS_ERR_FORMAT;
+            break;
+        }
+        HidsSklearnNode *grown_tree = (HidsSklearnNode*)realloc(tree, count * sizeof(HidsSklearnNode));
+        uint8_t *grown_depths = grown_tree != NULL ? (uint8_t*)realloc(depths, count) : NULL;
+        HidsNode *nodes = grown_depths != NULL ?
+                          (HidsNode*)realloc(model->nodes, (model->num_nodes + count) * sizeof(HidsNode)) : NULL;
+        if (grown_tree != NULL) tree = grown_tree;
+        if (grown_depths != NULL) depths = grown_depths;
+        if (nodes == NULL) {
+            status = HIDS_ERR_NOMEM;
+            break;
+        }
+        model->nodes = nodes;
+        model->capacity = model->num_nodes + count;
+        if (fread(tree, sizeof(HidsSklearnNode), count, f) != count) {
+            status = HIDS_ERR_FORMAT;
+            break;
+        }
+        model->roots[t] = (int32_t)model->num_nodes;
+        status = hids_import_tree(model, tree, count, model->num_nodes, depths);
+        model->num_nodes += count;
+    }
+    fclose(f);
+    free(tree);
+    free(depths);
+    if (status != HIDS_OK) {
+        hids_model_free(model);
+        return status;
+    }
+    *out = model;
+    return HIDS_OK;
+}
+
+// ==================== FOREST MERGING ====================
+
+// Append a forest's nodes and roots to merged, shifting its child indices
+// past the nodes already there
+void hids_append_trees(hids_model *merged, const hids_model *model) {
+    int32_t base = (int32_t)merged->num_nodes;
+    for (uint32_t i = 0; i < model->num_nodes; i++) {
+        HidsNode node = model->nodes[i];
+        if (node.left >= 0) node.left += base;
+        if (node.right >= 0) node.right += base;
+        merged->nodes[merged->num_nodes++] = node;
+    }
+    for (uint32_t t = 0; t < model->num_trees; t++) merged->roots[merged->num_trees++] = model->roots[t] + base;
+}
+
+// Count the trees and nodes of n models, which must share a feature count
+hids_status hids_merge_size(const hids_model *const *models, size_t n, uint32_t *num_trees, uint32_t *num_nodes,
+                            uint32_t *max_depth) {
+    *num_trees = *num_nodes = *max_depth = 0;
+    for (size_t m = 0; m < n; m++) {
+        const hids_model *model = models[m];
+        if (model == NULL || model->num_features != models[0]->num_features ||
+            model->num_trees > HIDS_MAX_TREES - *num_trees || model->num_nodes > INT32_MAX - *num_nodes) {
+            return HIDS_ERR_ARGUMENT;
+        }
+        *num_trees += model->num_trees;
+        *num_nodes += model->num_nodes;
+        if (model->max_depth > *max_depth) *max_depth = model->max_depth;
+    }
+    return HIDS_OK;
+}
+
+hids_status hids_merge(const hids_model *const *models, size_t n, hids_model **out) {
+    if (models == NULL || n == 0 || out == NULL) return HIDS_ERR_ARGUMENT;
+
+    // Scores average path lengths over all trees against one normalizer,
+    // so only forests with the same c(subsample_size) can be pooled
+    uint32_t num_trees, num_nodes, max_depth;
+    if (hids_merge_size(models, n, &num_trees, &num_nodes, &max_depth) != HIDS_OK) return HIDS_ERR_ARGUMENT;
+    double threshold = 0;
+    for (size_t m = 0; m < n; m++) {
+        if (models[m]->c_norm != models[0]->c_norm || models[m]->num_sources > 0) return HIDS_ERR_ARGUMENT;
+        threshold += models[m]->threshold * models[m]->num_trees;
+    }
+    hids_model *merged = hids_model_alloc(num_trees, num_nodes);
+    if (merged == NULL) return HIDS_ERR_NOMEM;
+    merged->num_features = models[0]->num_features;
+    merged->subsample_size = models[0]->subsample_size;
+    merged->max_depth = max_depth;
+    merged->c_norm = models[0]->c_norm;
+    merged->threshold = threshold / num_trees;
+    merged->num_trees = 0;
+    for (size_t m = 0; m < n; m++) hids_append_trees(merged, models[m]);
+    *out = merged;
+    return HIDS_OK;
+}
+
+hids_status hids_merge_forests(const hids_merge_input *inputs, size_t n, hids_merge_mode mode, hids_model **out) {
+    if (inputs == NULL || n == 0 || n > HIDS_MAX_TREES || out == NULL ||
+        (mode != HIDS_MERGE_UNION && mode != HIDS_MERGE_WEIGHTED)) {
+        return HIDS_ERR_ARGUMENT;
+    }
+    const hids_model *models[HIDS_MAX_TREES];
+    uint32_t num_sources = 0;
+    for (size_t m = 0; m < n; m++) {
+        models[m] = inputs[m].model;
+        if (models[m] == NULL || (mode == HIDS_MERGE_WEIGHTED && !(inputs[m].weight > 0)) ||
+            (models[m]->num_sources == 0 && !(models[m]->c_norm > 0))) {
+            return HIDS_ERR_ARGUMENT;
+        }
+        num_sources += models[m]->num_sources > 0 ? models[m]->num_sources : 1;
+    }
+    uint32_t num_trees, num_nodes, max_depth;
+    if (hids_merge_size(models, n, &num_trees, &num_nodes, &max_depth) != HIDS_OK) return HIDS_ERR_ARGUMENT;
+
+    hids_model *merged = hids_model_alloc(num_trees, num_nodes);
+    HidsSource *sources = merged != NULL ? (HidsSource*)calloc(num_sources, sizeof(HidsSource)) : NULL;
+    if (sources == NULL) {
+        hids_model_free(merged);
+        return HIDS_ERR_NOMEM;
+    }
+    merged->num_features = models[0]->num_features;
+    merged->max_depth = max_depth;
+    merged->num_trees = 0;
+    merged->sources = sources;
+
+    // A forest's weight is its tree count in a union, or the caller's in a
+    // weighted ensemble. Already merged forests split theirs across their
+    // sources in proportion to the sources' own weights.
+    double threshold = 0, total = 0;
+    for (size_t m = 0; m < n; m++) {
+        const hids_model *model = models[m];
+        double weight = mode == HIDS_MERGE_UNION ? model->num_trees : inputs[m].weight;
+        threshold += model->threshold * weight;
+        total += weight;
+        uint32_t first = merged->num_trees;
+        if (model->num_sources == 0) {
+            HidsSource *source = &sources[merged->num_sources++];
+            if (inputs[m].host != NULL) snprintf(source->host, HIDS_HOST_MAX, "%s", inputs[m].host);
+            source->first_tree = first;
+            source->num_trees = model->num_trees;
+            source->subsample_size = model->subsample_size;
+            source->c_norm = model->c_norm;
+            source->weight = weight;
+        } else {
+            double own = 0;
+            for (uint32_t s = 0; s < model->num_sources; s++) own += model->sources[s].weight;
+            for (uint32_t s = 0; s < model->num_sources; s++) {
+                HidsSource *source = &sources[merged->num_sources++];
+                *source = model->sources[s];
+                source->first_tree += first;
+                source->weight = mode == HIDS_MERGE_UNION ? source->num_trees : weight * source->weight / own;
+            }
+        }
+        hids_append_trees(merged, model);
+    }
+    merged->threshold = threshold / total;
+
+    // Keep one subsample size and normalizer when every source shares them
+    merged->subsample_size = sources[0].subsample_size;
+    merged->c_norm = sources[0].c_norm;
+    for (uint32_t s = 1; s < merged->num_sources; s++) {
+        if (sources[s].c_norm != merged->c_norm) {
+            merged->subsample_size = 0;
+            merged->c_norm = 0;
+        }
+    }
+
+    hids_status status = hids_model_set_sources(merged);
+    if (status != HIDS_OK) {
+        hids_model_free(merged);
+        return status == HIDS_ERR_FORMAT ? HIDS_ERR_ARGUMENT : status;
+    }
+    *out = merged;
+    return HIDS_OK;
+}
+
+// ==================== DRIFT MONITORING ====================
+
+// Streaming statistics of one feature, or of scores
+typedef struct {
+    double mean;
+    double m2;                        // Sum of squared deviations from the mean
+    uint64_t bins[HIDS_DRIFT_BINS];   // Observations per baseline decile bin
+} HidsDriftStats;
+
+#define HIDS_DRIFT_TABLE 64           // Feature counts binned by table lookup, below this
+
+// Columns are the features, then scores. Small counts are binned through a
+// per-feature table; other values compare against every edge.
+struct hids_drift {
+    const hids_model *model;
+    uint32_t width;                   // num_features + 1
+    uint64_t count;
+    HidsDriftStats *stats;            // Per column
+    double *center;                   // Per column: baseline mean, subtracted before summing
+    uint8_t *table;                   // Bin of count x of feature f: table[f * HIDS_DRIFT_TABLE + x]
+    double *sums;                     // Per column, for the current batch: centered sum
+    double *squares;                  // and sum of squares
+};
+
+int hids_compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Bin of x over baseline deciles: how many edges lie below it
+int hids_drift_bin(const double *edges, double x) {
+    int bin = 0;
+    for (int i = 0; i < HIDS_DRIFT_BINS - 1; i++) bin += x > edges[i];
+    return bin;
+}
+
+// Mean, variance, deciles and bin shares of m values; sorts them
+void hids_baseline_fill(HidsBaseline *b, double *values, size_t m) {
+    double sum = 0, squares = 0;
+    for (size_t i = 0; i < m; i++) sum += values[i];
+    b->mean = sum / m;
+    for (size_t i = 0; i < m; i++) squares += (values[i] - b->mean) * (values[i] - b->mean);
+    b->variance = squares / m;
+
+    qsort(values, m, sizeof(double), hids_compare_double);
+    for (int i = 1; i < HIDS_DRIFT_BINS; i++) b->edges[i - 1] = values[(m * i) / HIDS_DRIFT_BINS];
+    size_t counts[HIDS_DRIFT_BINS] = {0};
+    for (size_t i = 0; i < m; i++) counts[hids_drift_bin(b->edges, values[i])]++;
+    for (int i = 0; i < HIDS_DRIFT_BINS; i++) b->share[i] = (double)counts[i] / m;
+}
+
+hids_status hids_model_set_baseline(hids_model *model, const int32_t *samples, size_t n, size_t stride) {
+    if (model == NULL || samples == NULL || n == 0 || stride < model->num_features) return HIDS_ERR_ARGUMENT;
+    uint32_t k = model->num_features;
+    size_t m = n < HIDS_DRIFT_BASELINE_ROWS ? n : HIDS_DRIFT_BASELINE_ROWS;
+    int32_t *rows = (int32_t*)malloc(m * k * sizeof(int32_t));
+    double *values = (double*)malloc(m * sizeof(double));
+    HidsBaseline *baseline = (HidsBaseline*)malloc((k + 1) * sizeof(HidsBaseline));
+    if (rows == NULL || values == NULL || baseline == NULL) {
+        free(rows);
+        free(values);
+        free(baseline);
+        return HIDS_ERR_NOMEM;
+    }
+    for (size_t i = 0; i < m; i++) memcpy(&rows[i * k], &samples[(i * n / m) * stride], k * sizeof(int32_t));
+
+    for (uint32_t f = 0; f < k; f++) {
+        for (size_t i = 0; i < m; i++) values[i] = rows[i * k + f];
+        hids_baseline_fill(&baseline[f], values, m);
+    }
+    hids_score_batch(model, rows, m, k, values);
+    hids_baseline_fill(&baseline[k], values, m);
+
+    free(model->baseline);
+    model->baseline = baseline;
+    free(rows);
+    free(values);
+    return HIDS_OK;
+}
+
+int hids_model_has_baseline(const hids_model *model) {
+    return model != NULL && model->baseline != NULL;
+}
+
+void hids_drift_free(hids_drift *monitor) {
+    if (monitor == NULL) return;
+    free(monitor->stats);
+    free(monitor->center);
+    free(monitor->table);
+    free(monitor->sums);
+    free(monitor->squares);
+    free(monitor);
+}
+
+hids_status hids_drift_create(const hids_model *model, hids_drift **out) {
+    if (model == NULL || out == NULL || model->baseline == NULL) return HIDS_ERR_ARGUMENT;
+    hids_drift *monitor = (hids_drift*)calloc(1, sizeof(hids_drift));
+    if (monitor == NULL) return HIDS_ERR_NOMEM;
+    uint32_t width = model->num_features + 1;
+    monitor->model = model;
+    monitor->width = width;
+    monitor->stats = (HidsDriftStats*)calloc(width, sizeof(HidsDriftStats));
+    monitor->center = (double*)malloc(width * sizeof(double));
+    monitor->table = (uint8_t*)malloc((size_t)model->num_features * HIDS_DRIFT_TABLE);
+    monitor->sums = (double*)malloc(width * sizeof(double));
+    monitor->squares = (double*)malloc(width * sizeof(double));
+    if (monitor->stats == NULL || monitor->center == NULL || monitor->table == NULL || monitor->sums == NULL ||
+        monitor->squares == NULL) {
+        hids_drift_free(monitor);
+        return HIDS_ERR_NOMEM;
+    }
+    for (uint32_t c = 0; c < width; c++) monitor->center[c] = model->baseline[c].mean;
+    for (uint32_t f = 0; f < model->num_features; f++) {
+        for (int x = 0; x < HIDS_DRIFT_TABLE; x++) {
+            monitor->table[f * HIDS_DRIFT_TABLE + x] = (uint8_t)hids_drift_bin(model->baseline[f].edges, x);
+        }
+    }
+    *out = monitor;
+    return HIDS_OK;
+}
+
+size_t hids_drift_size(const hids_drift *monitor) {
+    return sizeof(hids_drift) + monitor->width * (sizeof(HidsDriftStats) + 3 * sizeof(double)) +
+           (size_t)(monitor->width - 1) * HIDS_DRIFT_TABLE;
+}
+
+void hids_drift_reset(hids_drift *monitor) {
+    memset(monitor->stats, 0, monitor->width * sizeof(HidsDriftStats));
+    monitor->count = 0;
+}
+
+// Per sample, only centered sums and bin counts are kept; each batch's
+// moments are then folded into the running mean and m2 with Chan's
+// parallel form of Welford's update, which stays stable over long streams
+void hids_drift_observe(hids_drift *monitor, const int32_t *samples, size_t n, size_t stride,
+                        const double *scores) {
+    if (n == 0) return;
+    uint32_t width = monitor->width, k = width - 1;
+    const HidsBaseline *baseline = monitor->model->baseline;
+    const double *center = monitor->center;
+    const uint8_t *table = monitor->table;
+    double *sums = monitor->sums, *squares = monitor->squares;
+    HidsDriftStats *stats = monitor->stats;
+    for (uint32_t c = 0; c < width; c++) sums[c] = squares[c] = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        const int32_t *row = samples + i * stride;
+        for (uint32_t f = 0; f < k; f++) {
+            int32_t x = row[f];
+            double d = x - center[f];
+            sums[f] += d;
+            squares[f] += d * d;
+            int bin = (uint32_t)x < HIDS_DRIFT_TABLE ? table[f * HIDS_DRIFT_TABLE + x]
+                                                     : hids_drift_bin(baseline[f].edges, x);
+            stats[f].bins[bin]++;
+        }
+        double d = scores[i] - center[k];
+        sums[k] += d;
+        squares[k] += d * d;
+        stats[k].bins[hids_drift_bin(baseline[k].edges, scores[i])]++;
+    }
+
+    double before = (double)monitor->count, total = before + n;
+    for (uint32_t c = 0; c < width; c++) {
+        double batch_mean = center[c] + sums[c] / n;
+        double batch_m2 = squares[c] - sums[c] * sums[c] / n;
+        double delta = batch_mean - stats[c].mean;
+        stats[c].mean += delta * n / total;
+        stats[c].m2 += batch_m2 + delta * delta * before * n / total;
+    }
+    monitor->count += n;
+}
+
+// Population stability index of observed bin counts against baseline
+// shares: sum of (p - q) * ln(p / q), skipping bins empty on both sides
+double hids_drift_psi(const HidsDriftStats *stats, const HidsBaseline *baseline, uint64_t count) {
+    double psi = 0;
+    for (int b = 0; b < HIDS_DRIFT_BINS; b++) {
+        if (stats->bins[b] == 0 && baseline->share[b] == 0) continue;
+        double p = (double)stats->bins[b] / count, q = baseline->share[b];
+        if (p < HIDS_DRIFT_EPSILON) p = HIDS_DRIFT_EPSILON;
+        if (q < HIDS_DRIFT_EPSILON) q = HIDS_DRIFT_EPSILON;
+        psi += (p - q) * log(p / q);
+    }
+    return psi;
+}
+
+// Mean shift in baseline standard deviations; constant baselines count
+// any shift as infinite
+double hids_drift_shift(const HidsDriftStats *stats, const HidsBaseline *baseline) {
+    double delta = fabs(stats->mean - baseline->mean);
+    if (baseline->variance > 0) return delta / sqrt(baseline->variance);
+    return delta > 0 ? INFINITY : 0;
+}
+
+void hids_drift_check(const hids_drift *monitor, hids_drift_report *report) {
+    uint32_t k = monitor->width - 1;
+    const HidsBaseline *baseline = monitor->model->baseline;
+    memset(report, 0, sizeof(*report));
+    report->samples = monitor->count;
+    if (monitor->count == 0) return;
+
+    report->score_mean = monitor->stats[k].mean;
+    report->score_sd = sqrt(monitor->stats[k].m2 / monitor->count);
+    report->score_shift = hids_drift_shift(&monitor->stats[k], &baseline[k]);
+    report->score_psi = hids_drift_psi(&monitor->stats[k], &baseline[k], monitor->count);
+    for (uint32_t f = 0; f < k; f++) {
+        double psi = hids_drift_psi(&monitor->stats[f], &baseline[f], monitor->count);
+        if (psi > report->max_feature_psi) {
+            report->max_feature_psi = psi;
+            report->worst_feature = f;
+        }
+    }
+    report->worst_feature_shift = hids_drift_shift(&monitor->stats[report->worst_feature],
+                                                   &baseline[report->worst_feature]);
+    report->retrain = monitor->count >= HIDS_DRIFT_MIN_SAMPLES &&
+                      (report->score_psi > HIDS_DRIFT_PSI || report->max_feature_psi > HIDS_DRIFT_PSI);
+}
@@ -0,0 +1,222 @@
+/*
+ * libhids - Isolation Forest scoring for host-based intrusion detection
+ *
+ * Stable C API: models are opaque handles, and every buffer (samples,
+ * scores) belongs to the caller. Samples are rows of int32 feature counts
+ * (e.g. system call frequencies); a row may sit inside a larger record,
+ * with stride giving the distance between rows in int32 elements.
+ *
+ * Functions return HIDS_OK or a negative hids_status. The library keeps
+ * no global state, so separate models may be used from separate threads;
+ * one model may be scored from many threads at once.
+ */
+
+#ifndef HIDS_H
+#define HIDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define HIDS_API __attribute__((visibility("default")))
+#else
+#define HIDS_API
+#endif
+
+#define HIDS_API_VERSION 1            // Bumped on incompatible API changes
+#define HIDS_MAX_FEATURES 256         // Most features per sample
+#define HIDS_MAX_TREES 1024
+#define HIDS_MAX_DEPTH 30
+#define HIDS_DEFAULT_THRESHOLD 0.6    // Anomaly cut-off of models trained by hids_train()
+#define HIDS_HOST_MAX 64              // Longest host label kept for a merged forest, with its NUL
+#define HIDS_DRIFT_BINS 10            // Baseline decile bins per feature and for scores
+#define HIDS_DRIFT_PSI 0.25           // Population stability index that counts as drift
+#define HIDS_DRIFT_MIN_SAMPLES 1000   // Samples observed before drift is judged
+#define HIDS_DRIFT_BASELINE_ROWS 16384  // Most samples a baseline is computed from
+
+typedef struct hids_model hids_model;
+typedef struct hids_drift hids_drift;
+
+typedef enum {
+    HIDS_OK = 0,
+    HIDS_ERR_ARGUMENT = -1,           // Invalid argument
+    HIDS_ERR_NOMEM = -2,              // Out of memory
+    HIDS_ERR_IO = -3,                 // File could not be read or written
+    HIDS_ERR_FORMAT = -4              // Not a model file, or from an incompatible version
+} hids_status;
+
+// How hids_merge_forests() weighs the forests it combines
+typedef enum {
+    HIDS_MERGE_UNION = 0,             // Every tree counts the same
+    HIDS_MERGE_WEIGHTED = 1           // Each forest counts by its input weight, however many trees it has
+} hids_merge_mode;
+
+// One forest to merge
+typedef struct {
+    const hids_model *model;
+    const char *host;                 // Provenance label, may be NULL
+    double weight;                    // HIDS_MERGE_WEIGHTED only, e.g. the host's training rows
+} hids_merge_input;
+
+// Where some of a merged model's trees came from
+typedef struct {
+    const char *host;                 // Valid while the model is
+    uint32_t num_trees;
+    uint32_t subsample_size;
+    double weight;                    // Share of the score; the shares sum to 1
+} hids_source_info;
+
+// One node of a model's trees; see hids_model_node()
+typedef struct {
+    int32_t feature;                  // Split feature, -1 for a leaf
+    int32_t threshold;                // Samples with feature < threshold go left
+    int32_t left;                     // Node index, -1 if none
+    int32_t right;                    // Node index, -1 if none
+    double leaf_adjust;               // Leaves: c(samples that reached the leaf), added to the depth
+} hids_node_info;
+
+// Drift of observed samples from a model's baseline
+typedef struct {
+    uint64_t samples;                 // Observed since creation or the last reset
+    double score_mean;
+    double score_sd;                  // Standard deviation of observed scores
+    double score_shift;               // |score mean - baseline mean| in baseline standard deviations
+    double score_psi;                 // Population stability index of scores over baseline deciles
+    double max_feature_psi;           // Largest feature PSI
+    uint32_t worst_feature;           // Feature with that PSI
+    double worst_feature_shift;       // Its mean shift in baseline standard deviations
+    int retrain;                      // 1: score or feature PSI above HIDS_DRIFT_PSI, retrain recommended
+} hids_drift_report;
+
+// Training parameters; start from hids_train_options_default()
+typedef struct {
+    uint32_t num_features;            // Features per sample
+    uint32_t num_trees;
+    uint32_t subsample_size;          // Samples drawn for each tree
+    uint32_t max_depth;
+    uint64_t seed;                    // Random seed, 0 to seed from the clock
+} hids_train_options;
+
+// API version the library was built with (HIDS_API_VERSION)
+HIDS_API uint32_t hids_version(void);
+
+HIDS_API const char* hids_strerror(hids_status status);
+
+// 20 features, 10 trees of 8 samples, depth 10, seeded from the clock
+HIDS_API void hids_train_options_default(hids_train_options *options);
+
+// Train a model on n samples of normal behavior. Sample i starts at
+// samples + i * stride; stride is at least options->num_features.
+HIDS_API hids_status hids_train(const int32_t *samples, size_t n, size_t stride,
+                                const hids_train_options *options, hids_model **model);
+
+HIDS_API hids_status hids_save(const hids_model *model, const char *path);
+
+HIDS_API hids_status hids_load(const char *path, hids_model **model);
+
+// Bytes hids_serialize() writes: a model file's contents, for sending
+// models over sockets
+HIDS_API size_t hids_model_size(const hids_model *model);
+
+HIDS_API hids_status hids_serialize(const hids_model *model, void *data, size_t size);
+
+HIDS_API hids_status hids_deserialize(const void *data, size_t size, hids_model **model);
+
+// Pool the trees of n models into one. The models must share the feature
+// count and c(subsample_size), which normalizes the path length averaged
+// over all trees; the threshold is averaged weighted by tree count.
+HIDS_API hids_status hids_merge(const hids_model *const *models, size_t n, hids_model **merged);
+
+// Combine forests from different hosts, which may differ in subsample
+// size and tree count, into one model scored in a single pass. Each tree's
+// path length is normalized by its own forest's c(subsample_size):
+//   score = 2^(-sum over forests of share * mean over its trees of h / c)
+// where share is the forest's weight over the total. The result records
+// each forest as a source; merged forests may be merged again.
+HIDS_API hids_status hids_merge_forests(const hids_merge_input *inputs, size_t n, hids_merge_mode mode,
+                                        hids_model **merged);
+
+// Sources of a model from hids_merge_forests(); 0 for other models
+HIDS_API uint32_t hids_model_sources(const hids_model *model);
+
+HIDS_API hids_status hids_model_source(const hids_model *model, uint32_t index, hids_source_info *info);
+
+// Anomaly scores in (0, 1] for n samples laid out as for hids_train();
+// scores above about 0.6 are anomalous
+HIDS_API hids_status hids_score_batch(const hids_model *model, const int32_t *samples, size_t n,
+                                      size_t stride, double *scores);
+
+// Features per sample the model expects
+HIDS_API uint32_t hids_model_features(const hids_model *model);
+
+HIDS_API uint32_t hids_model_trees(const hids_model *model);
+
+// Walk a model's trees, e.g. to credit a score to the features split on
+// along each path. A sample's path length in a tree is the number of
+// splits taken plus leaf_adjust at the leaf; a missing child ends it.
+HIDS_API hids_status hids_model_root(const hids_model *model, uint32_t tree, int32_t *root);
+
+HIDS_API hids_status hids_model_node(const hids_model *model, int32_t index, hids_node_info *info);
+
+// Score above which a sample is anomalous
+HIDS_API double hids_model_threshold(const hids_model *model);
+
+// Import a scikit-learn IsolationForest dumped by scripts/export_sklearn.py.
+// Scores match score_samples() negated, and the threshold is -offset_, so
+// a sample is anomalous exactly when predict() returns -1. Features must be
+// integer counts: x <= t becomes x < floor(t) + 1.
+//
+// Dump layout, host byte order:
+//   uint32 magic "HSKL", uint32 version (1)
+//   uint32 num_features, num_trees, max_samples (max_samples_), reserved
+//   double offset (offset_)
+//   per tree: uint32 node_count, then node_count records of
+//     int32 left, int32 right (-1 for leaves), int32 feature (column of the
+//     input, -1 for leaves), int32 n_node_samples, double threshold
+HIDS_API hids_status hids_import_sklearn(const char *path, hids_model **model);
+
+HIDS_API void hids_model_free(hids_model *model);
+
+// Record the behavior a model was trained for: per-feature and score mean,
+// variance and decile edges of up to HIDS_DRIFT_BASELINE_ROWS of n samples,
+// evenly spaced. Stored in model files; merging drops it.
+HIDS_API hids_status hids_model_set_baseline(hids_model *model, const int32_t *samples, size_t n, size_t stride);
+
+HIDS_API int hids_model_has_baseline(const hids_model *model);
+
+// Streaming drift statistics against a model's baseline, in constant
+// memory: Welford mean and variance, and a histogram over the baseline
+// decile bins, per feature and for scores. The histogram is not a
+// quantile sketch: values beyond the baseline's outer deciles all count
+// in the end bins, however far out. A monitor refers to the model, which
+// must outlive it; it is not thread-safe, so use one per scoring thread.
+HIDS_API hids_status hids_drift_create(const hids_model *model, hids_drift **monitor);
+
+// Add n scored samples, laid out as for hids_score_batch()
+HIDS_API void hids_drift_observe(hids_drift *monitor, const int32_t *samples, size_t n, size_t stride,
+                                 const double *scores);
+
+HIDS_API void hids_drift_check(const hids_drift *monitor, hids_drift_report *report);
+
+// Bytes a monitor holds; fixed at creation
+HIDS_API size_t hids_drift_size(const hids_drift *monitor);
+
+// Start a new window, e.g. after each check
+HIDS_API void hids_drift_reset(hids_drift *monitor);
+
+HIDS_API void hids_drift_free(hids_drift *monitor);
+
+// Average path length of an unsuccessful search in a binary tree of n
+// samples, c(n): 0 for n <= 1, 1 for n = 2; normalizes path lengths into
+// scores
+HIDS_API double hids_c_factor(int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,417 @@
+/*
+ * hids - Python binding for libhids
+ *
+ * Scores any 2-D buffer-protocol array (NumPy arrays, memoryviews) in
+ * place. Rows of int32 with contiguous columns are handed to libhids as
+ * they are; other integer and float layouts are converted a block of rows
+ * at a time, so no copy of the whole array is ever made. Scoring releases
+ * the GIL and splits the rows across threads.
+ *
+ * Build:
+ *   gcc -O2 -pthread -fPIC -fvisibility=hidden -shared $(python3-config --includes) \
+ *       -o hids$(python3-config --extension-suffix) hidsmodule.c hids.c -lm
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hids.h"
+
+#define PYHIDS_BLOCK 1024             // Rows scored per hids_score_batch() call
+#define PYHIDS_MIN_ROWS 16384         // Fewest rows worth giving a thread
+#define PYHIDS_MAX_THREADS 256
+
+// ==================== ARRAY ACCESS ====================
+
+// A 2-D buffer and how to read one element of it as a feature count
+typedef struct {
+    Py_buffer view;
+    char kind;                        // 'i' signed, 'u' unsigned, 'f' float
+    Py_ssize_t rows;
+    Py_ssize_t cols;
+    int direct;                       // int32 rows libhids can read in place
+} SampleArray;
+
+// Release what sample_array_get() acquired
+void sample_array_release(SampleArray *a) {
+    PyBuffer_Release(&a->view);
+}
+
+// Accept a 2-D array of integers or floats in any strided layout
+int sample_array_get(PyObject *obj, SampleArray *a) {
+    if (PyObject_GetBuffer(obj, &a->view, PyBUF_STRIDES | PyBUF_FORMAT) != 0) return -1;
+
+    // Only native byte order is accepted
+    const char *format = a->view.format != NULL ? a->view.format : "B";
+    if (*format == '@' || *format == '=') format++;
+    else if (*format == (PY_BIG_ENDIAN ? '>' : '<')) format++;
+    else if (*format == '!' && PY_BIG_ENDIAN) format++;
+    a->kind = 0;
+    if (format[0] != '\0' && format[1] == '\0') {
+        if (strchr("bhilq", format[0])) a->kind = 'i';
+        else if (strchr("BHILQ", format[0])) a->kind = 'u';
+        else if (strchr("fd", format[0])) a->kind = 'f';
+    }
+    if (a->kind == 0 || a->view.ndim != 2 ||
+        !(a->kind == 'f' ? a->view.itemsize == 4 || a->view.itemsize == 8 :
+          a->view.itemsize == 1 || a->view.itemsize == 2 || a->view.itemsize == 4 || a->view.itemsize == 8)) {
+        PyErr_Format(PyExc_TypeError, "expected a 2-D array of integers or floats, got format '%s' with %d dimensions",
+                     a->view.format != NULL ? a->view.format : "B", a->view.ndim);
+        PyBuffer_Release(&a->view);
+        return -1;
+    }
+    a->rows = a->view.shape[0];
+    a->cols = a->view.shape[1];
+    a->direct = a->kind == 'i' && a->view.itemsize == 4 && a->view.strides[1] == 4 &&
+                a->view.strides[0] > 0 && a->view.strides[0] % 4 == 0 && ((uintptr_t)a->view.buf & 3) == 0;
+    return 0;
+}
+
+// Features are compared against integer split values, so x < split holds
+// exactly when floor(x) < split; values outside int32 saturate
+int32_t saturate(double x) {
+    if (x != x) return 0;
+    if (x <= INT32_MIN) return INT32_MIN;
+    if (x >= INT32_MAX) return INT32_MAX;
+    return (int32_t)floor(x);
+}
+
+int32_t read_element(const SampleArray *a, const char *p) {
+    switch (a->kind) {
+    case 'f':
+        return saturate(a->view.itemsize == 4 ? *(const float*)p : *(const double*)p);
+    case 'i':
+        switch (a->view.itemsize) {
+        case 1: return *(const int8_t*)p;
+        case 2: return *(const int16_t*)p;
+        case 4: return *(const int32_t*)p;
+        default: {
+            int64_t v = *(const int64_t*)p;
+            return v < INT32_MIN ? INT32_MIN : v > INT32_MAX ? INT32_MAX : (int32_t)v;
+        }
+        }
+    default:
+        switch (a->view.itemsize) {
+        case 1: return *(const uint8_t*)p;
+        case 2: return *(const uint16_t*)p;
+        case 4: {
+            uint32_t v = *(const uint32_t*)p;
+            return v > INT32_MAX ? INT32_MAX : (int32_t)v;
+        }
+        default: {
+            uint64_t v = *(const uint64_t*)p;
+            return v > INT32_MAX ? INT32_MAX : (int32_t)v;
+        }
+        }
+    }
+}
+
+// Copy rows [start, start + n) into dense int32 rows of k features
+void convert_rows(const SampleArray *a, Py_ssize_t start, Py_ssize_t n, int k, int32_t *out) {
+    for (Py_ssize_t i = 0; i < n; i++) {
+        const char *row = (const char*)a->view.buf + (start + i) * a->view.strides[0];
+        for (int j = 0; j < k; j++) out[i * k + j] = read_element(a, row + j * a->view.strides[1]);
+    }
+}
+
+// ==================== MODEL TYPE ====================
+
+typedef struct {
+    PyObject_HEAD
+    hids_model *model;
+} ModelObject;
+
+PyTypeObject ModelType;
+
+PyObject* raise_status(hids_status status, const char *path) {
+    PyObject *type = status == HIDS_ERR_NOMEM ? PyExc_MemoryError :
+                     status == HIDS_ERR_IO ? PyExc_OSError : PyExc_ValueError;
+    if (path != NULL) PyErr_Format(type, "%s: %s", path, hids_strerror(status));
+    else PyErr_SetString(type, hids_strerror(status));
+    return NULL;
+}
+
+PyObject* model_wrap(hids_model *model) {
+    ModelObject *self = PyObject_New(ModelObject, &ModelType);
+    if (self == NULL) {
+        hids_model_free(model);
+        return NULL;
+    }
+    self->model = model;
+    return (PyObject*)self;
+}
+
+void model_dealloc(ModelObject *self) {
+    hids_model_free(self->model);
+    PyObject_Free(self);
+}
+
+// One thread's share of the rows
+typedef struct {
+    const hids_model *model;
+    const SampleArray *samples;
+    Py_ssize_t start;
+    Py_ssize_t end;
+    double *scores;
+    hids_status status;
+} ScoreJob;
+
+void* score_rows(void *arg) {
+    ScoreJob *job = (ScoreJob*)arg;
+    const SampleArray *a = job->samples;
+    int k = (int)hids_model_features(job->model);
+    int32_t *block = a->direct ? NULL : (int32_t*)malloc(PYHIDS_BLOCK * k * sizeof(int32_t));
+    if (!a->direct && block == NULL) {
+        job->status = HIDS_ERR_NOMEM;
+        return NULL;
+    }
+    job->status = HIDS_OK;
+    for (Py_ssize_t i = job->start; i < job->end && job->status == HIDS_OK; i += PYHIDS_BLOCK) {
+        Py_ssize_t n = job->end - i < PYHIDS_BLOCK ? job->end - i : PYHIDS_BLOCK;
+        if (a->direct) {
+            const int32_t *rows = (const int32_t*)((const char*)a->view.buf + i * a->view.strides[0]);
+            job->status = hids_score_batch(job->model, rows, n, a->view.strides[0] / 4, job->scores + i);
+        } else {
+            convert_rows(a, i, n, k, block);
+            job->status = hids_score_batch(job->model, block, n, k, job->scores + i);
+        }
+    }
+    free(block);
+    return NULL;
+}
+
+PyObject* model_score(ModelObject *self, PyObject *args, PyObject *kwargs) {
+    static char *keywords[] = {"samples", "out", "threads", NULL};
+    PyObject *samples_obj, *out_obj = Py_None;
+    int threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|Oi:score", keywords, &samples_obj, &out_obj, &threads)) {
+        return NULL;
+    }
+    SampleArray samples;
+    if (sample_array_get(samples_obj, &samples) != 0) return NULL;
+    if (samples.cols < (Py_ssize_t)hids_model_features(self->model)) {
+        PyErr_Format(PyExc_ValueError, "samples have %zd features, the model needs %u", samples.cols,
+                     hids_model_features(self->model));
+        sample_array_release(&samples);
+        return NULL;
+    }
+
+    // Scores go to the caller's buffer of doubles, or a new one
+    PyObject *result;
+    Py_buffer out;
+    if (out_obj == Py_None) {
+        PyObject *bytes = PyByteArray_FromStringAndSize(NULL, samples.rows * (Py_ssize_t)sizeof(double));
+        PyObject *view = bytes != NULL ? PyMemoryView_FromObject(bytes) : NULL;
+        result = view != NULL ? PyObject_CallMethod(view, "cast", "s", "d") : NULL;
+        Py_XDECREF(view);
+        Py_XDECREF(bytes);
+        if (result == NULL || PyObject_GetBuffer(result, &out, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) != 0) {
+            Py_XDECREF(result);
+            sample_array_release(&samples);
+            return NULL;
+        }
+    } else {
+        if (PyObject_GetBuffer(out_obj, &out, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+            sample_array_release(&samples);
+            return NULL;
+        }
+        if (out.itemsize != sizeof(double) || out.format == NULL || strchr(out.format, 'd') == NULL ||
+            out.len != samples.rows * (Py_ssize_t)sizeof(double)) {
+            PyErr_Format(PyExc_ValueError, "out must be a contiguous buffer of %zd doubles", samples.rows);
+            PyBuffer_Release(&out);
+            sample_array_release(&samples);
+            return NULL;
+        }
+        result = out_obj;
+        Py_INCREF(result);
+    }
+
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > samples.rows / PYHIDS_MIN_ROWS) threads = (int)(samples.rows / PYHIDS_MIN_ROWS);
+    if (threads > PYHIDS_MAX_THREADS) threads = PYHIDS_MAX_THREADS;
+    if (threads < 1) threads = 1;
+
+    ScoreJob jobs[PYHIDS_MAX_THREADS];
+    pthread_t tids[PYHIDS_MAX_THREADS];
+    hids_status status = HIDS_OK;
+    Py_BEGIN_ALLOW_THREADS
+    for (int t = 0; t < threads; t++) {
+        jobs[t] = (ScoreJob){self->model, &samples, samples.rows * t / threads, samples.rows * (t + 1) / threads,
+                             (double*)out.buf, HIDS_OK};
+    }
+    // The calling thread takes the first share
+    int started = 1;
+    for (; started < threads; started++) {
+        if (pthread_create(&tids[started], NULL, score_rows, &jobs[started]) != 0) break;
+    }
+    for (int t = started; t < threads; t++) score_rows(&jobs[t]);
+    score_rows(&jobs[0]);
+    for (int t = 1; t < started; t++) pthread_join(tids[t], NULL);
+    for (int t = 0; t < threads; t++) {
+        if (jobs[t].status != HIDS_OK) status = jobs[t].status;
+    }
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&out);
+    sample_array_release(&samples);
+    if (status != HIDS_OK) {
+        Py_DECREF(result);
+        return raise_status(status, NULL);
+    }
+    return result;
+}
+
+PyObject* model_save(ModelObject *self, PyObject *args) {
+    const char *path;
+    if (!PyArg_ParseTuple(args, "s:save", &path)) return NULL;
+    hids_status status;
+    Py_BEGIN_ALLOW_THREADS
+    status = hids_save(self->model, path);
+    Py_END_ALLOW_THREADS
+    if (status != HIDS_OK) return raise_status(status, path);
+    Py_RETURN_NONE;
+}
+
+PyObject* model_num_features(ModelObject *self, void *closure) {
+    (void)closure;
+    return PyLong_FromUnsignedLong(hids_model_features(self->model));
+}
+
+PyObject* model_threshold(ModelObject *self, void *closure) {
+    (void)closure;
+    return PyFloat_FromDouble(hids_model_threshold(self->model));
+}
+
+PyMethodDef model_methods[] = {
+    {"score", (PyCFunction)(void(*)(void))model_score, METH_VARARGS | METH_KEYWORDS,
+     "score(samples, out=None, threads=0)\n\n"
+     "Anomaly scores in (0, 1] for each row of a 2-D array. Scores are written to out, a buffer of doubles, or a\n"
+     "new memoryview. threads=0 uses every online CPU."},
+    {"save", (PyCFunction)model_save, METH_VARARGS, "save(path)\n\nWrite the model file."},
+    {NULL, NULL, 0, NULL}
+};
+
+PyGetSetDef model_getset[] = {
+    {"num_features", (getter)model_num_features, NULL, "Features per sample the model expects", NULL},
+    {"threshold", (getter)model_threshold, NULL, "Score above which a sample is anomalous", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+PyTypeObject ModelType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "hids.Model",
+    .tp_basicsize = sizeof(ModelObject),
+    .tp_dealloc = (destructor)model_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Isolation Forest model; create with hids.train() or hids.load()",
+    .tp_methods = model_methods,
+    .tp_getset = model_getset,
+};
+
+// ==================== MODULE ====================
+
+PyObject* module_train(PyObject *module, PyObject *args, PyObject *kwargs) {
+    (void)module;
+    static char *keywords[] = {"samples", "num_trees", "subsample_size", "max_depth", "seed", NULL};
+    hids_train_options options;
+    hids_train_options_default(&options);
+    PyObject *samples_obj;
+    unsigned long long seed = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|IIIK:train", keywords, &samples_obj, &options.num_trees,
+                                     &options.subsample_size, &options.max_depth, &seed)) {
+        return NULL;
+    }
+    options.seed = seed;
+    SampleArray samples;
+    if (sample_array_get(samples_obj, &samples) != 0) return NULL;
+    if (samples.rows == 0 || samples.cols == 0 || samples.cols > HIDS_MAX_FEATURES) {
+        sample_array_release(&samples);
+        return raise_status(HIDS_ERR_ARGUMENT, NULL);
+    }
+    options.num_features = (uint32_t)samples.cols;
+
+    // Training reads rows at random, so non-int32 layouts are converted whole
+    int32_t *rows = NULL;
+    if (!samples.direct) {
+        rows = (int32_t*)malloc(samples.rows * samples.cols * sizeof(int32_t));
+        if (rows == NULL) {
+            sample_array_release(&samples);
+            return PyErr_NoMemory();
+        }
+    }
+    hids_model *model = NULL;
+    hids_status status;
+    Py_BEGIN_ALLOW_THREADS
+    if (rows != NULL) {
+        convert_rows(&samples, 0, samples.rows, (int)samples.cols, rows);
+        status = hids_train(rows, samples.rows, samples.cols, &options, &model);
+    } else {
+        status = hids_train((const int32_t*)samples.view.buf, samples.rows, samples.view.strides[0] / 4, &options,
+                            &model);
+    }
+    Py_END_ALLOW_THREADS
+    free(rows);
+    sample_array_release(&samples);
+    if (status != HIDS_OK) return raise_status(status, NULL);
+    return model_wrap(model);
+}
+
+PyObject* module_load(PyObject *module, PyObject *args) {
+    (void)module;
+    const char *path;
+    if (!PyArg_ParseTuple(args, "s:load", &path)) return NULL;
+    hids_model *model = NULL;
+    hids_status status;
+    Py_BEGIN_ALLOW_THREADS
+    status = hids_load(path, &model);
+    Py_END_ALLOW_THREADS
+    if (status != HIDS_OK) return raise_status(status, path);
+    return model_wrap(model);
+}
+
+PyObject* module_import_sklearn(PyObject *module, PyObject *args) {
+    (void)module;
+    const char *path;
+    if (!PyArg_ParseTuple(args, "s:import_sklearn", &path)) return NULL;
+    hids_model *model = NULL;
+    hids_status status;
+    Py_BEGIN_ALLOW_THREADS
+    status = hids_import_sklearn(path, &model);
+    Py_END_ALLOW_THREADS
+    if (status != HIDS_OK) return raise_status(status, path);
+    return model_wrap(model);
+}
+
+PyMethodDef module_methods[] = {
+    {"train", (PyCFunction)(void(*)(void))module_train, METH_VARARGS | METH_KEYWORDS,
+     "train(samples, num_trees=10, subsample_size=8, max_depth=10, seed=0)\n\n"
+     "Train a model on a 2-D array of normal behavior, one sample per row."},
+    {"load", module_load, METH_VARARGS, "load(path)\n\nRead a model file written by Model.save() or hids --train."},
+    {"import_sklearn", module_import_sklearn, METH_VARARGS,
+     "import_sklearn(path)\n\nRead a scikit-learn IsolationForest dumped by scripts/export_sklearn.py."},
+    {NULL, NULL, 0, NULL}
+};
+
+struct PyModuleDef hids_module = {
+    PyModuleDef_HEAD_INIT, "hids", "Isolation Forest scoring from libhids", -1, module_methods,
+    NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_hids(void) {
+    if (PyType_Ready(&ModelType) < 0) return NULL;
+    PyObject *module = PyModule_Create(&hids_module);
+    if (module == NULL) return NULL;
+    Py_INCREF(&ModelType);
+    if (PyModule_AddObject(module, "Model", (PyObject*)&ModelType) < 0) {
+        Py_DECREF(&ModelType);
+        Py_DECREF(module);
+        return NULL;
+    }
+    return module;
+}
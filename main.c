@@ -1,400 +1,7912 @@
-/*
- * Host-Based Intrusion Detection System (HIDS)
- * Using Isolation Forest for Anomaly Detection on System Calls
- * 
- * Academic Implementation for Operating Systems Course (CSE316)
- * 
- * This implementation demonstrates:
- * - System call frequency-based feature extraction
- * - Isolation Forest algorithm for anomaly detection
- * - Intrusion classification based on anomaly scores
- */
-
-// This is the code
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <math.h>
-#include <time.h>
-
-// ==================== CONFIGURATION ====================
-
-#define MAX_SYSCALLS 20          // Number of different system calls to track
-#define NUM_TREES 10             // Number of trees in Isolation Forest
-#define SUBSAMPLE_SIZE 8         // Subsample size for each tree
-#define MAX_TREE_DEPTH 10        // Maximum depth of isolation trees
-#define ANOMALY_THRESHOLD 0.6    // Threshold for classifying as anomaly
-
-// ==================== DATA STRUCTURES ====================
-
-// Represents a process's system call behavior
-typedef struct {
-    int syscall_freq[MAX_SYSCALLS];  // Frequency of each system call
-    int total_calls;                  // Total number of system calls
-    char process_name[50];            // Process identifier
-    int is_anomaly;                   // Ground truth (for testing)
-} ProcessBehavior;
-
-// Node in an Isolation Tree
-typedef struct IsolationNode {
-    int is_leaf;                      // 1 if leaf node, 0 if internal
-    int split_attribute;              // Which syscall to split on
-    int split_value;                  // Threshold value for split
-    struct IsolationNode *left;       // Left child (< split_value)
-    struct IsolationNode *right;      // Right child (>= split_value)
-    int size;                         // Number of samples at this node
-} IsolationNode;
-
-// Isolation Tree
-typedef struct {
-    IsolationNode *root;
-    int max_depth;
-} IsolationTree;
-
-// Isolation Forest
-typedef struct {
-    IsolationTree *trees[NUM_TREES];
-    int num_trees;
-    int subsample_size;
-} IsolationForest;
-
-// ==================== UTILITY FUNCTIONS ====================
-
-// Harmonic number for anomaly score calculation
-double harmonic_number(int n) {
-    if (n <= 1) return 0.0;
-    return log(n) + 0.5772156649;  // Euler's constant approximation
-}
-
-// Average path length of unsuccessful search in BST
-double c_factor(int n) {
-    if (n <= 1) return 0.0;
-    return 2.0 * harmonic_number(n - 1) - (2.0 * (n - 1.0) / n);
-}
-
-// Random integer between min and max (inclusive)
-int random_int(int min, int max) {
-    return min + rand() % (max - min + 1);
-}
-
-// ==================== DATASET GENERATION ====================
-
-// Generate synthetic normal process behavior
-void generate_normal_behavior(ProcessBehavior *pb, const char *name) {
-    strcpy(pb->process_name, name);
-    pb->total_calls = 0;
-    pb->is_anomaly = 0;
-    
-    // Normal processes have typical patterns
-    // Common syscalls: read(0), write(1), open(2), close(3), fork(4)
-    for (int i = 0; i < MAX_SYSCALLS; i++) {
-        if (i < 5) {
-            // Frequent common syscalls
-            pb->syscall_freq[i] = 50 + random_int(-10, 10);
-        } else if (i < 10) {
-            // Occasional syscalls
-            pb->syscall_freq[i] = 10 + random_int(-5, 5);
-        } else {
-            // Rare syscalls
-            pb->syscall_freq[i] = random_int(0, 3);
-        }
-        pb->total_calls += pb->syscall_freq[i];
-    }
-}
-
-// Generate synthetic anomalous process behavior
-void generate_anomalous_behavior(ProcessBehavior *pb, const char *name) {
-    strcpy(pb->process_name, name);
-    pb->total_calls = 0;
-    pb->is_anomaly = 1;
-    
-    // Anomalous processes have unusual patterns
-    for (int i = 0; i < MAX_SYSCALLS; i++) {
-        if (i >= 10) {
-            // Abnormally high rare syscalls (suspicious activity)
-            pb->syscall_freq[i] = 30 + random_int(-5, 15);
-        } else if (i < 5) {
-            // Abnormally low common syscalls
-            pb->syscall_freq[i] = 5 + random_int(-2, 3);
-        } else {
-            pb->syscall_freq[i] = random_int(0, 10);
-        }
-        pb->total_calls += pb->syscall_freq[i];
-    }
-}
-
-// ==================== ISOLATION TREE FUNCTIONS ====================
-
-// Create a new isolation tree node
-IsolationNode* create_node() {
-    IsolationNode *node = (IsolationNode*)malloc(sizeof(IsolationNode));
-    node->is_leaf = 0;
-    node->split_attribute = -1;
-    node->split_value = 0;
-    node->left = NULL;
-    node->right = NULL;
-    node->size = 0;
-    return node;
-}
-
-// Build isolation tree recursively
-IsolationNode* build_isolation_tree(ProcessBehavior *data, int *indices, 
-                                     int n, int current_depth, int max_depth) {
-    IsolationNode *node = create_node();
-    node->size = n;
-    
-    // Termination conditions: max depth or single/no samples
-    if (current_depth >= max_depth || n <= 1) {
-        node->is_leaf = 1;
-        return node;
-    }
-    
-    // Randomly select a feature (syscall) to split on
-    node->split_attribute = random_int(0, MAX_SYSCALLS - 1);
-    
-    // Find min and max values for this attribute in current subset
-    int min_val = data[indices[0]].syscall_freq[node->split_attribute];
-    int max_val = min_val;
-    
-    for (int i = 1; i < n; i++) {
-        int val = data[indices[i]].syscall_freq[node->split_attribute];
-        if (val < min_val) min_val = val;
-        if (val > max_val) max_val = val;
-    }
-    
-    // If all values are the same, make it a leaf
-    if (min_val == max_val) {
-        node->is_leaf = 1;
-        return node;
-    }
-    
-    // Random split value between min and max
-    node->split_value = random_int(min_val, max_val);
-    
-    // Partition data into left and right subsets
-    int *left_indices = (int*)malloc(n * sizeof(int));
-    int *right_indices = (int*)malloc(n * sizeof(int));
-    int left_count = 0, right_count = 0;
-    
-    for (int i = 0; i < n; i++) {
-        int val = data[indices[i]].syscall_freq[node->split_attribute];
-        if (val < node->split_value) {
-            left_indices[left_count++] = indices[i];
-        } else {
-            right_indices[right_count++] = indices[i];
-        }
-    }
-    
-    // Recursively build left and right subtrees
-    if (left_count > 0) {
-        node->left = build_isolation_tree(data, left_indices, left_count, 
-                                          current_depth + 1, max_depth);
-    }
-    if (right_count > 0) {
-        node->right = build_isolation_tree(data, right_indices, right_count, 
-                                           current_depth + 1, max_depth);
-    }
-    
-    free(left_indices);
-    free(right_indices);
-    
-    return node;
-}
-
-// Calculate path length for a single sample in a tree
-double path_length(IsolationNode *node, ProcessBehavior *sample, int current_depth) {
-    if (node == NULL) {
-        return current_depth;
-    }
-    
-    if (node->is_leaf) {
-        // Add average path length adjustment for leaf nodes
-        return current_depth + c_factor(node->size);
-    }
-    
-    int val = sample->syscall_freq[node->split_attribute];
-    
-    if (val < node->split_value && node->left != NULL) {
-        return path_length(node->left, sample, current_depth + 1);
-    } else if (node->right != NULL) {
-        return path_length(node->right, sample, current_depth + 1);
-    }
-    
-    return current_depth;
-}
-
-// Free isolation tree memory
-void free_tree(IsolationNode *node) {
-    if (node == NULL) return;
-    free_tree(node->left);
-    free_tree(node->right);
-    free(node);
-}
-
-// ==================== ISOLATION FOREST FUNCTIONS ====================
-
-// Train Isolation Forest on dataset
-IsolationForest* train_isolation_forest(ProcessBehavior *training_data, int n) {
-    IsolationForest *forest = (IsolationForest*)malloc(sizeof(IsolationForest));
-    forest->num_trees = NUM_TREES;
-    forest->subsample_size = SUBSAMPLE_SIZE < n ? SUBSAMPLE_SIZE : n;
-    
-    printf("\n[TRAINING] Building Isolation Forest with %d trees...\n", NUM_TREES);
-    
-    for (int t = 0; t < NUM_TREES; t++) {
-        // Random subsample
-        int *subsample_indices = (int*)malloc(forest->subsample_size * sizeof(int));
-        for (int i = 0; i < forest->subsample_size; i++) {
-            subsample_indices[i] = random_int(0, n - 1);
-        }
-        
-        // Build tree
-        forest->trees[t] = (IsolationTree*)malloc(sizeof(IsolationTree));
-        forest->trees[t]->max_depth = MAX_TREE_DEPTH;
-        forest->trees[t]->root = build_isolation_tree(training_data, subsample_indices, 
-                                                      forest->subsample_size, 0, MAX_TREE_DEPTH);
-        
-        free(subsample_indices);
-        printf("  Tree %d built successfully\n", t + 1);
-    }
-    
-    printf("[TRAINING] Isolation Forest training complete!\n");
-    return forest;
-}
-
-// Calculate anomaly score for a sample
-double anomaly_score(IsolationForest *forest, ProcessBehavior *sample) {
-    double avg_path_length = 0.0;
-    
-    // Calculate average path length across all trees
-    for (int t = 0; t < forest->num_trees; t++) {
-        avg_path_length += path_length(forest->trees[t]->root, sample, 0);
-    }
-    avg_path_length /= forest->num_trees;
-    
-    // Normalize using c_factor
-    double c = c_factor(forest->subsample_size);
-    if (c == 0) return 0.5;
-    
-    // Anomaly score formula: s = 2^(-E(h(x))/c(n))
-    double score = pow(2.0, -avg_path_length / c);
-    
-    return score;
-}
-
-// Free Isolation Forest memory
-void free_forest(IsolationForest *forest) {
-    for (int t = 0; t < forest->num_trees; t++) {
-        free_tree(forest->trees[t]->root);
-        free(forest->trees[t]);
-    }
-    free(forest);
-}
-
-// ==================== INTRUSION DETECTION ====================
-
-// Detect intrusions in test data
-void detect_intrusions(IsolationForest *forest, ProcessBehavior *test_data, int n) {
-    printf("\n[DETECTION] Running intrusion detection...\n");
-    printf("%-20s %-15s %-15s %-15s\n", "Process", "Anomaly Score", "Classification", "Ground Truth");
-    printf("================================================================\n");
-    
-    int true_positive = 0, true_negative = 0;
-    int false_positive = 0, false_negative = 0;
-    
-    for (int i = 0; i < n; i++) {
-        double score = anomaly_score(forest, &test_data[i]);
-        int predicted_anomaly = (score >= ANOMALY_THRESHOLD) ? 1 : 0;
-        
-        // Confusion matrix
-        if (predicted_anomaly == 1 && test_data[i].is_anomaly == 1) true_positive++;
-        else if (predicted_anomaly == 0 && test_data[i].is_anomaly == 0) true_negative++;
-        else if (predicted_anomaly == 1 && test_data[i].is_anomaly == 0) false_positive++;
-        else if (predicted_anomaly == 0 && test_data[i].is_anomaly == 1) false_negative++;
-        
-        printf("%-20s %-15.4f %-15s %-15s\n", 
-               test_data[i].process_name,
-               score,
-               predicted_anomaly ? "INTRUSION" : "NORMAL",
-               test_data[i].is_anomaly ? "ANOMALY" : "NORMAL");
-    }
-    
-    // Performance metrics
-    printf("\n[METRICS] Detection Performance:\n");
-    printf("  True Positives:  %d\n", true_positive);
-    printf("  True Negatives:  %d\n", true_negative);
-    printf("  False Positives: %d\n", false_positive);
-    printf("  False Negatives: %d\n", false_negative);
-    
-    double accuracy = (double)(true_positive + true_negative) / n;
-    printf("  Accuracy: %.2f%%\n", accuracy * 100);
-    
-    if (true_positive + false_positive > 0) {
-        double precision = (double)true_positive / (true_positive + false_positive);
-        printf("  Precision: %.2f%%\n", precision * 100);
-    }
-    
-    if (true_positive + false_negative > 0) {
-        double recall = (double)true_positive / (true_positive + false_negative);
-        printf("  Recall: %.2f%%\n", recall * 100);
-    }
-}
-
-// ==================== MAIN PROGRAM ====================
-
-int main() {
-    srand(time(NULL));
-    
-    printf("======================================================\n");
-    printf("  Host-Based Intrusion Detection System (HIDS)\n");
-    printf("  System Call Anomaly Detection using Isolation Forest\n");
-    printf("======================================================\n");
-    
-    // Generate training dataset (normal behavior only)
-    int train_size = 20;
-    ProcessBehavior *training_data = (ProcessBehavior*)malloc(train_size * sizeof(ProcessBehavior));
-    
-    printf("\n[DATA] Generating training dataset...\n");
-    for (int i = 0; i < train_size; i++) {
-        char name[50];
-        sprintf(name, "train_proc_%d", i);
-        generate_normal_behavior(&training_data[i], name);
-    }
-    printf("[DATA] Generated %d normal process behaviors for training\n", train_size);
-    
-    // Train Isolation Forest
-    IsolationForest *forest = train_isolation_forest(training_data, train_size);
-    
-    // Generate test dataset (mix of normal and anomalous)
-    int test_size = 10;
-    ProcessBehavior *test_data = (ProcessBehavior*)malloc(test_size * sizeof(ProcessBehavior));
-    
-    printf("\n[DATA] Generating test dataset...\n");
-    for (int i = 0; i < test_size; i++) {
-        char name[50];
-        sprintf(name, "test_proc_%d", i);
-        
-        // 60% normal, 40% anomalous
-        if (i < 6) {
-            generate_normal_behavior(&test_data[i], name);
-        } else {
-            generate_anomalous_behavior(&test_data[i], name);
-        }
-    }
-    printf("[DATA] Generated %d test process behaviors\n", test_size);
-    
-    // Detect intrusions
-    detect_intrusions(forest, test_data, test_size);
-    
-    // Cleanup
-    free_forest(forest);
-    free(training_data);
-    free(test_data);
-    
-    printf("\n[COMPLETE] HIDS execution finished successfully!\n");
-    printf("======================================================\n");
-    
-    return 0;
-
-}
+/*
+ * Host-Based Intrusion Detection System (HIDS)
+ * Using Isolation Forest for Anomaly Detection on System Calls
+ * 
+ * Academic Implementation for Operating Systems Course (CSE316)
+ * 
+ * This implementation demonstrates:
+ * - System call frequency-based feature extraction
+ * - Isolation Forest algorithm for anomaly detection
+ * - Intrusion classification based on anomaly scores
+ */
+
+// This is the code
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <linux/io_uring.h>
+#include <linux/perf_event.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "hids.h"
+
+// USDT probes for bpftrace/perf (see scripts/). Each probe is a single nop
+// until a tracer attaches. Compiled out if <sys/sdt.h> is missing or
+// HIDS_NO_USDT is defined.
+#if defined(__has_include) && !defined(HIDS_NO_USDT)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define HIDS_USDT 1
+#endif
+#endif
+
+#ifdef HIDS_USDT
+#define HIDS_PROBE1(name, a) DTRACE_PROBE1(hids, name, a)
+#define HIDS_PROBE2(name, a, b) DTRACE_PROBE2(hids, name, a, b)
+#else
+#define HIDS_PROBE1(name, a) do { } while (0)
+#define HIDS_PROBE2(name, a, b) do { } while (0)
+#endif
+
+// ==================== CONFIGURATION ====================
+
+#define MAX_SYSCALLS 20          // Number of different system calls to track
+#define NUM_TREES 10             // Number of trees in Isolation Forest
+#define SUBSAMPLE_SIZE 8         // Subsample size for each tree
+#define MAX_TREE_DEPTH 10        // Maximum depth of isolation trees
+#define ANOMALY_THRESHOLD 0.6    // Threshold for classifying as anomaly
+#define STREAM_WINDOW_CALLS 360  // Live window size, about one training sample
+#define RARE_SYSCALL_SHARE 0.01  // Syscalls below this share of training calls are rare
+#define RESCORE_JUMP_FACTOR 1.5  // Rescore when a syscall's share grows by this factor
+#define RESCORE_JUMP_FLOOR 4     // Smallest share a jump is measured from
+#define RESCORE_MIN_CALLS 60     // Calls needed in a window before it is scored
+#define RESCORE_SLOW_TICKS 100   // Rescoring cadence when nothing triggers
+#define QUEUE_TRIGGER_DEADLINE 5 // Ticks allowed to score a triggered process
+#define QUEUE_YOUNG_TICKS 50     // Processes younger than this are scored first
+#define QUEUE_YOUNG_BONUS 100.0  // Priority bonus for young processes
+#define QUEUE_STALENESS_WEIGHT 0.1  // Priority added per tick since last scored
+#define QUEUE_SHED_PRIORITY 40.0 // Late items below this priority are shed
+#define SAMPLING_MAX_PERIOD 64   // Sparsest syscall sampling: 1 in this many calls
+#define SAMPLING_PID_TARGET 8    // Per-PID sampling: calls kept per process per tick
+#define SAMPLING_MAX_PID_TARGET 1024  // Per-PID target at which sampling is effectively off
+#define HIST_SUB_BITS 4          // Latency histograms: 16 linear buckets per power of two
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+#define LATENCY_DUMP_MS 1000     // Period of the latency histogram dump
+#define SINK_MAX_PRODUCERS 64    // Scoring threads per result sink
+#define SINK_RING_RECORDS 4096   // Results buffered per scoring thread (power of two)
+#define SINK_BUFFER_SIZE (1 << 20)  // Bytes the sink writer batches per write
+#define SINK_MAX_LINE 512        // Longest formatted result
+#define SINK_IDLE_NS 50000       // Sink writer poll interval when idle
+#define SINK_UNLABELLED 255      // ground_truth of results without a label
+#define SINK_BINARY_MAGIC "HIDSRES1"
+#define ALERT_CLEAR_THRESHOLD 0.55  // An INTRUSION clears once the score drops below this
+#define ALERT_PID_BURST 2        // Alerts one process may raise back to back
+#define ALERT_PID_REFILL_TICKS 500  // Ticks for a process to earn another alert
+#define ALERT_EXE_BURST 8        // Alerts all processes of one executable may raise back to back
+#define ALERT_EXE_REFILL_TICKS 50   // Ticks for an executable to earn another alert
+#define ALERT_SUMMARY_TICKS 500  // Period of summaries for processes still in INTRUSION
+#define ATTRIBUTION_TOP_K 3      // Syscalls reported as the drivers of an alert
+#define AGG_WINDOW_CALLS STREAM_WINDOW_CALLS  // Aggregate windows decay like process windows
+#define AGG_MAX_DEPTH 16         // Ancestor levels a call is rolled up to
+#define AGG_MAX_CGROUPS 4096     // Cgroups tracked (power of two)
+#define AGG_MIN_MEMBERS 2        // Processes an aggregate needs before it is scored
+#define AGG_MIN_CALLS 120        // Calls an aggregate needs before it is scored
+#define MR_LEVELS 3              // Window resolutions kept per process
+#define MR_BUCKETS 8             // Buckets per resolution; a bucket spans MR_BUCKETS of the level below
+#define MR_MIN_CALLS 16          // Calls a window needs before it is scored
+#define MR_CALIBRATION_QUANTILE 0.999  // Share of normal windows scoring below each window's threshold
+#define SHARD_MAX_WRITERS 64     // Concurrent writers of sharded counters (one bit each in a mask)
+#define EPOCH_MAX_THREADS 64     // Threads using epoch reclamation at once (one bit each in a mask)
+#define EPOCH_RETIRE_BATCH 128   // Retired objects a thread collects before reclaiming
+#define POOL_SLAB_RECORDS 1024   // Process records per slab
+#define POOL_CACHE_RECORDS 64    // Records a thread caches; half move at a time to or from the pool
+#define DIRECTORY_MIN_CAPACITY 1024  // Smallest process directory
+#define CHECKPOINT_VERSION 1     // Bump when a checkpointed struct changes
+#define CHECKPOINT_BUFFER (1 << 20)  // Write buffer of the checkpoint writer
+#define NUMA_MAX_NODES 8         // NUMA nodes handled; more are folded into these
+#define NUMA_QUEUE_BATCHES 64    // Batches a node's work queue holds
+#define NUMA_BATCH 256           // Samples per work queue batch
+#define HUGE_PAGE_2MB (2ul << 20)
+#define HUGE_PAGE_1GB (1ul << 30)
+#define CPU_BUDGET_PERCENT 5.0   // Detector CPU as a percent of the CPUs its cgroup may use
+#define BUDGET_WINDOW_MS 100     // Interval CPU use is measured and the budget enforced over
+#define BUDGET_MAX_LEVEL 10      // Deepest shedding level; each level halves the work done
+#define BUDGET_SCORE_BATCH 256   // Scorings per tick at level 0 when the scheduler has no limit
+#define AUTOTUNE_SAMPLES 4096    // Synthetic samples scored per candidate
+#define AUTOTUNE_ROUNDS 5        // Timed rounds per candidate; the fastest counts
+#define AUTOTUNE_CACHE_DIR "/var/tmp" // Directory of the per-user, per-host decision caches
+#define AUTOTUNE_CACHE_ENTRIES 64 // Decisions a cache keeps; the oldest are dropped
+#define SHARD_MAX_WORKERS 64     // Training workers one coordinator accepts
+#define SHARD_TIMEOUT_MS 30000   // Longest wait for a worker to connect or answer
+
+// ==================== DATA STRUCTURES ====================
+
+// Represents a process's system call behavior
+typedef struct {
+    int syscall_freq[MAX_SYSCALLS];  // Frequency of each system call
+    int total_calls;                  // Total number of system calls
+    char process_name[50];            // Process identifier
+    int is_anomaly;                   // Ground truth (for testing)
+} ProcessBehavior;
+
+#define BEHAVIOR_STRIDE (sizeof(ProcessBehavior) / sizeof(int32_t))  // libhids stride of a ProcessBehavior array
+
+// Node in an Isolation Tree
+typedef struct IsolationNode {
+    int is_leaf;                      // 1 if leaf node, 0 if internal
+    int split_attribute;              // Which syscall to split on
+    int split_value;                  // Threshold value for split
+    struct IsolationNode *left;       // Left child (< split_value)
+    struct IsolationNode *right;      // Right child (>= split_value)
+    double leaf_adjust;               // c_factor(samples at the node), for leaves
+} IsolationNode;
+
+// A syscall's share in isolating a sample
+typedef struct {
+    int syscall;
+    double share;                     // Fraction of the total contribution, 0..1
+} SyscallAttribution;
+
+// Isolation Tree
+typedef struct {
+    IsolationNode *root;
+    int max_depth;
+} IsolationTree;
+
+// Isolation Forest
+typedef struct {
+    IsolationTree *trees[NUM_TREES];  // Copies of the model's trees, for attribution and the compact kernels
+    int num_trees;
+    int subsample_size;
+    hids_model *model;                // Trained by hids_train(), scored by anomaly_score()
+} IsolationForest;
+
+// ==================== UTILITY FUNCTIONS ====================
+
+// Average path length of unsuccessful search in BST; shared with libhids
+// so model files score the same here and in embedding agents
+double c_factor(int n) {
+    return hids_c_factor(n);
+}
+
+// Random integer between min and max (inclusive)
+int random_int(int min, int max) {
+    return min + rand() % (max - min + 1);
+}
+
+// A clock (monotonic, or a process or thread CPU clock) in nanoseconds
+uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Monotonic clock in nanoseconds
+uint64_t now_ns(void) {
+    return clock_ns(CLOCK_MONOTONIC);
+}
+
+// ==================== RUNTIME METRICS ====================
+
+// Monotonic counters, summed over all threads when read
+typedef enum {
+    METRIC_SAMPLES_SCORED,
+    METRIC_TREES_EVALUATED,
+    METRIC_EVENTS_INGESTED,
+    METRIC_EVENTS_SAMPLED_OUT,
+    METRIC_EVENTS_DROPPED,
+    METRIC_ALERTS,
+    METRIC_ALERTS_SUPPRESSED,
+    METRIC_ALERT_SUMMARIES,
+    METRIC_CHECKPOINTS,
+    METRIC_EVENTS_LATE,
+    NUM_COUNTERS
+} MetricCounter;
+
+// Point-in-time values, set by their owner
+typedef enum {
+    GAUGE_TRACKED_PIDS,
+    GAUGE_MODEL_BYTES,
+    GAUGE_TABLE_BYTES,
+    GAUGE_QUEUE_DEPTH,
+    GAUGE_CHECKPOINT_PAUSE_US,
+    GAUGE_CPU_MILLICORES,
+    GAUGE_SHED_LEVEL,
+    GAUGE_SCORE_KERNEL,
+    GAUGE_SCORE_BATCH,
+    NUM_GAUGES
+} MetricGauge;
+
+const char *counter_names[NUM_COUNTERS][2] = {
+    {"hids_samples_scored_total", "Samples scored"},
+    {"hids_trees_evaluated_total", "Isolation trees traversed while scoring"},
+    {"hids_events_ingested_total", "Syscall events offered to collection"},
+    {"hids_events_sampled_out_total", "Syscall events skipped by sampling"},
+    {"hids_events_dropped_total", "Syscall events dropped because the process table was full"},
+    {"hids_alerts_total", "INTRUSION alerts emitted"},
+    {"hids_alerts_suppressed_total", "INTRUSION alerts dropped by rate limiting"},
+    {"hids_alert_summaries_total", "Summaries emitted for processes staying in INTRUSION"},
+    {"hids_checkpoints_total", "Checkpoints of detector state written"},
+    {"hids_events_late_total", "Syscall events older than their multi-resolution window, counted at its current tick"},
+};
+
+const char *gauge_names[NUM_GAUGES][2] = {
+    {"hids_tracked_pids", "Processes in the process table"},
+    {"hids_model_bytes", "Memory used by all live compact forests and their replicas"},
+    {"hids_table_bytes", "Memory used by all live process tables"},
+    {"hids_scoring_queue_depth", "Processes waiting to be scored"},
+    {"hids_checkpoint_pause_us", "Time the pipeline stopped for the last checkpoint"},
+    {"hids_cpu_millicores", "Detector CPU use over the last budget window"},
+    {"hids_budget_shed_level", "Work shedding level, 0 when the detector runs in full"},
+    {"hids_score_kernel", "Scoring kernel picked by the autotuner (0 recursive, 1 libhids, 2 iterative, 3 batched)"},
+    {"hids_score_batch", "Samples per call of the scoring kernel picked by the autotuner"},
+};
+
+// One thread's counters, on their own cache lines. Only the owning
+// thread writes them, so increments need no locked instructions. Shards
+// are never freed: when a thread exits its shard keeps its counts and goes
+// to the next thread that registers, so there are as many shards as
+// threads ever ran at once.
+typedef struct MetricShard {
+    uint64_t counters[NUM_COUNTERS];
+    struct MetricShard *next;
+    int in_use;                       // 1 while a thread owns the shard
+} __attribute__((aligned(64))) MetricShard;
+
+MetricShard metric_shared_shard = {{0}, NULL, 1};  // Threads without a shard, updated with locked adds
+MetricShard *metric_shards = &metric_shared_shard; // Lock-free list of all shards
+__thread MetricShard *metric_shard = NULL;
+pthread_key_t metric_shard_key;       // Releases a thread's shard when it exits
+pthread_once_t metric_shard_once = PTHREAD_ONCE_INIT;
+int64_t metric_gauges[NUM_GAUGES];
+int metrics_enabled = 1;
+
+void metrics_thread_exit(void *shard) {
+    __atomic_store_n(&((MetricShard*)shard)->in_use, 0, __ATOMIC_RELEASE);
+}
+
+void metrics_create_key(void) {
+    pthread_key_create(&metric_shard_key, metrics_thread_exit);
+}
+
+// Give the calling thread a shard, reusing one left by an exited thread
+// when there is one. Scoring threads call it when they start: counting
+// never allocates, and threads without a shard of their own share one
+// with locked adds.
+MetricShard* metrics_register_thread(void) {
+    if (metric_shard != NULL) return metric_shard;
+    pthread_once(&metric_shard_once, metrics_create_key);
+
+    MetricShard *shard;
+    for (shard = __atomic_load_n(&metric_shards, __ATOMIC_ACQUIRE); shard != NULL; shard = shard->next) {
+        int idle = 0;
+        if (__atomic_compare_exchange_n(&shard->in_use, &idle, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) break;
+    }
+    if (shard == NULL) {
+        if (posix_memalign((void**)&shard, 64, sizeof(MetricShard)) != 0) return NULL;
+        memset(shard, 0, sizeof(MetricShard));
+        shard->in_use = 1;
+        shard->next = __atomic_load_n(&metric_shards, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&metric_shards, &shard->next, shard, 0,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+    pthread_setspecific(metric_shard_key, shard);
+    metric_shard = shard;
+    return shard;
+}
+
+void metric_add(MetricCounter counter, uint64_t n) {
+    if (!metrics_enabled) return;
+    MetricShard *shard = metric_shard;
+    if (shard == NULL) {
+        __atomic_fetch_add(&metric_shared_shard.counters[counter], n, __ATOMIC_RELAXED);
+        return;
+    }
+
+    uint64_t *value = &shard->counters[counter];
+    __atomic_store_n(value, __atomic_load_n(value, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+// Count one scored sample; one shard lookup for both scoring counters
+void metric_add_score(int trees) {
+    if (!metrics_enabled) return;
+    MetricShard *shard = metric_shard;
+    if (shard == NULL) {
+        __atomic_fetch_add(&metric_shared_shard.counters[METRIC_SAMPLES_SCORED], 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&metric_shared_shard.counters[METRIC_TREES_EVALUATED], trees, __ATOMIC_RELAXED);
+        return;
+    }
+
+    uint64_t *scored = &shard->counters[METRIC_SAMPLES_SCORED];
+    uint64_t *evaluated = &shard->counters[METRIC_TREES_EVALUATED];
+    __atomic_store_n(scored, __atomic_load_n(scored, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(evaluated, __atomic_load_n(evaluated, __ATOMIC_RELAXED) + trees, __ATOMIC_RELAXED);
+}
+
+void metric_set(MetricGauge gauge, int64_t value) {
+    __atomic_store_n(&metric_gauges[gauge], value, __ATOMIC_RELAXED);
+}
+
+// Adjust a gauge summed over its owners, e.g. bytes of all live tables
+void metric_gauge_add(MetricGauge gauge, int64_t delta) {
+    __atomic_fetch_add(&metric_gauges[gauge], delta, __ATOMIC_RELAXED);
+}
+
+// Sum a counter over all threads
+uint64_t metric_read(MetricCounter counter) {
+    uint64_t total = 0;
+    for (MetricShard *shard = __atomic_load_n(&metric_shards, __ATOMIC_ACQUIRE);
+         shard != NULL; shard = shard->next) {
+        total += __atomic_load_n(&shard->counters[counter], __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+// Write all metrics in Prometheus text exposition format
+void metrics_write_prometheus(FILE *out) {
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        fprintf(out, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+                counter_names[c][0], counter_names[c][1], counter_names[c][0],
+                counter_names[c][0], (unsigned long long)metric_read((MetricCounter)c));
+    }
+    for (int g = 0; g < NUM_GAUGES; g++) {
+        fprintf(out, "# HELP %s %s\n# TYPE %s gauge\n%s %lld\n",
+                gauge_names[g][0], gauge_names[g][1], gauge_names[g][0],
+                gauge_names[g][0], (long long)__atomic_load_n(&metric_gauges[g], __ATOMIC_RELAXED));
+    }
+}
+
+// Write metrics to a file for a textfile collector, replacing it atomically
+int metrics_write_file(const char *path) {
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *out = fopen(tmp, "w");
+    if (out == NULL) return -1;
+    metrics_write_prometheus(out);
+    if (fclose(out) != 0) return -1;
+    return rename(tmp, path);
+}
+
+// Serves metrics on a Unix socket: each connection gets one HTTP response,
+// e.g. curl --unix-socket <path> http://localhost/metrics
+typedef struct {
+    pthread_t thread;
+    int listen_fd;
+    char path[108];
+} MetricsServer;
+
+void* metrics_server_main(void *arg) {
+    MetricsServer *server = (MetricsServer*)arg;
+    for (;;) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            break;                    // Socket shut down
+        }
+
+        char request[512];
+        if (read(fd, request, sizeof(request)) < 0) {
+            close(fd);
+            continue;
+        }
+
+        FILE *out = fdopen(fd, "w");
+        if (out == NULL) {
+            close(fd);
+            continue;
+        }
+        fprintf(out, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n\r\n");
+        metrics_write_prometheus(out);
+        fclose(out);
+    }
+    return NULL;
+}
+
+int metrics_server_start(MetricsServer *server, const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    strcpy(addr.sun_path, path);
+    strcpy(server->path, path);
+
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server->listen_fd < 0) return -1;
+    unlink(path);
+    if (bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, 8) != 0 ||
+        pthread_create(&server->thread, NULL, metrics_server_main, server) != 0) {
+        close(server->listen_fd);
+        return -1;
+    }
+    return 0;
+}
+
+void metrics_server_stop(MetricsServer *server) {
+    shutdown(server->listen_fd, SHUT_RDWR);
+    pthread_join(server->thread, NULL);
+    close(server->listen_fd);
+    unlink(server->path);
+}
+
+// ==================== HUGE PAGES ====================
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+// Page size backing a region, from largest to smallest
+typedef enum {
+    PAGES_HUGE_1GB,                   // Reserved 1GB pages (MAP_HUGETLB)
+    PAGES_HUGE_2MB,                   // Reserved 2MB pages (MAP_HUGETLB)
+    PAGES_THP,                        // Transparent huge pages (madvise)
+    PAGES_DEFAULT                     // Normal 4KB pages
+} PageBacking;
+
+const char *page_backing_names[] = {"1GB huge pages", "2MB huge pages", "transparent huge pages", "4KB pages"};
+
+// Memory mapped for a model or dataset
+typedef struct {
+    void *base;
+    size_t size;                      // Mapped size, a multiple of the page size
+    PageBacking backing;              // What was obtained, which may be less than asked
+} HugeRegion;
+
+PageBacking model_pages = PAGES_DEFAULT;  // Pages requested for compact forests
+
+size_t huge_round(size_t size, size_t page) {
+    return (size + page - 1) & ~(page - 1);
+}
+
+// Map size bytes with the largest pages up to want that the system
+// gives us: reserved 1GB, then reserved 2MB pages, then transparent huge
+// pages, then normal pages. region->backing tells which was obtained.
+int huge_region_alloc(HugeRegion *region, size_t size, PageBacking want) {
+    memset(region, 0, sizeof(HugeRegion));
+    if (size == 0) size = 1;
+    const PageBacking reserved[] = {PAGES_HUGE_1GB, PAGES_HUGE_2MB};
+    const size_t page_sizes[] = {HUGE_PAGE_1GB, HUGE_PAGE_2MB};
+    const int shifts[] = {30, 21};
+    for (int i = 0; i < 2; i++) {
+        if (want > reserved[i]) continue;
+        size_t mapped = huge_round(size, page_sizes[i]);
+        void *p = mmap(NULL, mapped, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shifts[i] << MAP_HUGE_SHIFT), -1, 0);
+        if (p != MAP_FAILED) {
+            *region = (HugeRegion){p, mapped, reserved[i]};
+            return 0;
+        }
+    }
+
+    size_t mapped = huge_round(size, want <= PAGES_THP ? HUGE_PAGE_2MB : 4096);
+    void *p = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return -1;
+    *region = (HugeRegion){p, mapped, PAGES_DEFAULT};
+    if (want <= PAGES_THP && madvise(p, mapped, MADV_HUGEPAGE) == 0) region->backing = PAGES_THP;
+    return 0;
+}
+
+void huge_region_free(HugeRegion *region) {
+    if (region->base != NULL) munmap(region->base, region->size);
+    region->base = NULL;
+}
+
+// Bytes of a region currently backed by transparent huge pages, from
+// /proc/self/smaps; -1 if it cannot be read
+long huge_region_thp_bytes(const HugeRegion *region) {
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (f == NULL) return -1;
+    char line[256];
+    unsigned long start, end;
+    long bytes = 0, kb;
+    int inside = 0;
+    uintptr_t base = (uintptr_t)region->base;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            inside = start < base + region->size && end > base;
+        } else if (inside && sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) {
+            bytes += kb * 1024;
+        }
+    }
+    fclose(f);
+    return bytes;
+}
+
+// ==================== DATASET GENERATION ====================
+
+// Generate synthetic normal process behavior
+void generate_normal_behavior(ProcessBehavior *pb, const char *name) {
+    strcpy(pb->process_name, name);
+    pb->total_calls = 0;
+    pb->is_anomaly = 0;
+    
+    // Normal processes have typical patterns
+    // Common syscalls: read(0), write(1), open(2), close(3), fork(4)
+    for (int i = 0; i < MAX_SYSCALLS; i++) {
+        if (i < 5) {
+            // Frequent common syscalls
+            pb->syscall_freq[i] = 50 + random_int(-10, 10);
+        } else if (i < 10) {
+            // Occasional syscalls
+            pb->syscall_freq[i] = 10 + random_int(-5, 5);
+        } else {
+            // Rare syscalls
+            pb->syscall_freq[i] = random_int(0, 3);
+        }
+        pb->total_calls += pb->syscall_freq[i];
+    }
+}
+
+// Generate synthetic anomalous process behavior
+void generate_anomalous_behavior(ProcessBehavior *pb, const char *name) {
+    strcpy(pb->process_name, name);
+    pb->total_calls = 0;
+    pb->is_anomaly = 1;
+    
+    // Anomalous processes have unusual patterns
+    for (int i = 0; i < MAX_SYSCALLS; i++) {
+        if (i >= 10) {
+            // Abnormally high rare syscalls (suspicious activity)
+            pb->syscall_freq[i] = 30 + random_int(-5, 15);
+        } else if (i < 5) {
+            // Abnormally low common syscalls
+            pb->syscall_freq[i] = 5 + random_int(-2, 3);
+        } else {
+            pb->syscall_freq[i] = random_int(0, 10);
+        }
+        pb->total_calls += pb->syscall_freq[i];
+    }
+}
+
+// ==================== ISOLATION TREE FUNCTIONS ====================
+
+// Copy the subtree at index out of a trained libhids model
+IsolationNode* import_tree(const hids_model *model, int32_t index) {
+    hids_node_info info;
+    if (index < 0 || hids_model_node(model, index, &info) != HIDS_OK) return NULL;
+
+    IsolationNode *node = (IsolationNode*)malloc(sizeof(IsolationNode));
+    node->is_leaf = info.feature < 0;
+    node->split_attribute = info.feature;
+    node->split_value = info.threshold;
+    node->leaf_adjust = info.leaf_adjust;
+    node->left = import_tree(model, info.left);
+    node->right = import_tree(model, info.right);
+    return node;
+}
+
+// Calculate path length for a single sample in a tree
+double path_length(IsolationNode *node, ProcessBehavior *sample, int current_depth) {
+    if (node == NULL) {
+        return current_depth;
+    }
+    
+    if (node->is_leaf) {
+        // Add average path length adjustment for leaf nodes
+        return current_depth + node->leaf_adjust;
+    }
+    
+    int val = sample->syscall_freq[node->split_attribute];
+    
+    if (val < node->split_value && node->left != NULL) {
+        return path_length(node->left, sample, current_depth + 1);
+    } else if (node->right != NULL) {
+        return path_length(node->right, sample, current_depth + 1);
+    }
+    
+    return current_depth;
+}
+
+// Credit the split attributes on one root-to-leaf path. A split at depth d
+// gets 1 / (d + 1), divided by the path length, so early splits and trees
+// that isolate the sample quickly weigh the most.
+void attribution_add_path(double *contributions, const int *attributes, int splits, double length) {
+    static const double depth_weight[MAX_TREE_DEPTH + 1] = {
+        1.0, 1.0 / 2, 1.0 / 3, 1.0 / 4, 1.0 / 5, 1.0 / 6, 1.0 / 7, 1.0 / 8, 1.0 / 9, 1.0 / 10, 1.0 / 11
+    };
+    if (length <= 0.0) return;
+    double inv_length = 1.0 / length;
+    for (int d = 0; d < splits; d++) {
+        contributions[attributes[d]] += depth_weight[d] * inv_length;
+    }
+}
+
+// Select the k largest contributions as shares of the total; returns the
+// number written (fewer than k if fewer syscalls contributed)
+int attribution_top_k(const double *contributions, int k, SyscallAttribution *top) {
+    double total = 0.0;
+    for (int i = 0; i < MAX_SYSCALLS; i++) total += contributions[i];
+    if (total <= 0.0) return 0;
+
+    // k selection passes; each takes the largest contribution below the
+    // previous pick (ties broken by syscall number)
+    double inv_total = 1.0 / total;
+    double bound = INFINITY;
+    int bound_index = -1;
+    int count;
+    for (count = 0; count < k; count++) {
+        int best = -1;
+        double best_value = 0.0;
+        for (int i = 0; i < MAX_SYSCALLS; i++) {
+            double v = contributions[i];
+            int below = v < bound || (v == bound && i > bound_index);
+            if (below && v > best_value) {
+                best = i;
+                best_value = v;
+            }
+        }
+        if (best < 0) break;
+        top[count] = (SyscallAttribution){best, best_value * inv_total};
+        bound = best_value;
+        bound_index = best;
+    }
+    return count;
+}
+
+// Path length that also records the split attributes along the path;
+// same result as hids_score_batch() walking the tree
+double path_length_attributed(IsolationNode *node, ProcessBehavior *sample, double *contributions) {
+    int attributes[MAX_TREE_DEPTH + 1];
+    int depth = 0;
+    double length;
+
+    for (;;) {
+        if (node == NULL) {
+            length = depth;
+            break;
+        }
+        if (node->is_leaf) {
+            length = depth + node->leaf_adjust;
+            break;
+        }
+        int val = sample->syscall_freq[node->split_attribute];
+        IsolationNode *next = (val < node->split_value && node->left != NULL) ? node->left : node->right;
+        if (next == NULL) {
+            length = depth;
+            break;
+        }
+        attributes[depth++] = node->split_attribute;
+        node = next;
+    }
+
+    attribution_add_path(contributions, attributes, depth, length);
+    return length;
+}
+
+// Free isolation tree memory
+void free_tree(IsolationNode *node) {
+    if (node == NULL) return;
+    free_tree(node->left);
+    free_tree(node->right);
+    free(node);
+}
+
+// ==================== ISOLATION FOREST FUNCTIONS ====================
+
+// Train Isolation Forest on dataset with libhids. The seed comes from
+// rand(), so srand() still fixes the trees.
+IsolationForest* train_isolation_forest(ProcessBehavior *training_data, int n) {
+    IsolationForest *forest = (IsolationForest*)malloc(sizeof(IsolationForest));
+    forest->num_trees = NUM_TREES;
+    forest->subsample_size = SUBSAMPLE_SIZE < n ? SUBSAMPLE_SIZE : n;
+    
+    printf("\n[TRAINING] Building Isolation Forest with %d trees...\n", NUM_TREES);
+    
+    hids_train_options options;
+    hids_train_options_default(&options);
+    options.num_features = MAX_SYSCALLS;
+    options.num_trees = NUM_TREES;
+    options.subsample_size = SUBSAMPLE_SIZE;
+    options.max_depth = MAX_TREE_DEPTH;
+    options.seed = (uint64_t)rand() + 1;
+    HIDS_PROBE2(tree__start, NUM_TREES, forest->subsample_size);
+    hids_status status = hids_train(&training_data[0].syscall_freq[0], n, BEHAVIOR_STRIDE, &options,
+                                    &forest->model);
+    HIDS_PROBE2(tree__done, NUM_TREES, forest->subsample_size);
+    if (status != HIDS_OK) {
+        fprintf(stderr, "[TRAINING] Failed: %s\n", hids_strerror(status));
+        free(forest);
+        return NULL;
+    }
+    
+    for (int t = 0; t < NUM_TREES; t++) {
+        int32_t root = -1;
+        hids_model_root(forest->model, t, &root);
+        forest->trees[t] = (IsolationTree*)malloc(sizeof(IsolationTree));
+        forest->trees[t]->max_depth = MAX_TREE_DEPTH;
+        forest->trees[t]->root = import_tree(forest->model, root);
+        printf("  Tree %d built successfully\n", t + 1);
+    }
+    
+    printf("[TRAINING] Isolation Forest training complete!\n");
+    return forest;
+}
+
+// Calculate anomaly score for a sample with libhids
+double anomaly_score(IsolationForest *forest, ProcessBehavior *sample) {
+    HIDS_PROBE1(score__start, sample);
+    double score = 0.5;
+    hids_score_batch(forest->model, sample->syscall_freq, 1, MAX_SYSCALLS, &score);
+    metric_add_score(forest->num_trees);
+    
+    // Probes pass the score in millionths
+    HIDS_PROBE2(score__done, sample, (long)(score * 1e6));
+    return score;
+}
+
+// anomaly_score() walking the pointer trees with the recursive
+// path_length(); same scores
+double recursive_anomaly_score(IsolationForest *forest, ProcessBehavior *sample) {
+    HIDS_PROBE1(score__start, sample);
+    double avg_path_length = 0.0;
+    for (int t = 0; t < forest->num_trees; t++) {
+        avg_path_length += path_length(forest->trees[t]->root, sample, 0);
+    }
+    avg_path_length /= forest->num_trees;
+
+    double c = c_factor(forest->subsample_size);
+    double score = 0.5;
+    if (c != 0) score = pow(2.0, -avg_path_length / c);
+    metric_add_score(forest->num_trees);
+
+    HIDS_PROBE2(score__done, sample, (long)(score * 1e6));
+    return score;
+}
+
+// Score n samples in one hids_score_batch() call; same scores as
+// anomaly_score()
+void libhids_score_batch(IsolationForest *forest, const ProcessBehavior *samples, int n, double *scores) {
+    HIDS_PROBE1(score_batch__start, n);
+    hids_score_batch(forest->model, samples[0].syscall_freq, n, BEHAVIOR_STRIDE, scores);
+    for (int i = 0; i < n; i++) {
+        HIDS_PROBE2(score__done, &samples[i], (long)(scores[i] * 1e6));
+    }
+    metric_add(METRIC_SAMPLES_SCORED, n);
+    metric_add(METRIC_TREES_EVALUATED, (uint64_t)n * forest->num_trees);
+    HIDS_PROBE1(score_batch__done, n);
+}
+
+// Anomaly score together with the top-k syscalls that isolated the sample,
+// accumulated in the same traversal. The top-k selection only runs for
+// scores of at least min_score (0 for all); *num_top receives the number of
+// entries written to top, 0 below min_score.
+double anomaly_score_explained(IsolationForest *forest, ProcessBehavior *sample, double min_score,
+                               int k, SyscallAttribution *top, int *num_top) {
+    HIDS_PROBE1(score__start, sample);
+    double contributions[MAX_SYSCALLS] = {0};
+    double avg_path_length = 0.0;
+
+    for (int t = 0; t < forest->num_trees; t++) {
+        avg_path_length += path_length_attributed(forest->trees[t]->root, sample, contributions);
+    }
+    avg_path_length /= forest->num_trees;
+
+    double c = c_factor(forest->subsample_size);
+    double score = 0.5;
+    if (c != 0) score = pow(2.0, -avg_path_length / c);
+    metric_add_score(forest->num_trees);
+    *num_top = score >= min_score ? attribution_top_k(contributions, k, top) : 0;
+
+    HIDS_PROBE2(score__done, sample, (long)(score * 1e6));
+    return score;
+}
+
+// Free Isolation Forest memory
+void free_forest(IsolationForest *forest) {
+    for (int t = 0; t < forest->num_trees; t++) {
+        free_tree(forest->trees[t]->root);
+        free(forest->trees[t]);
+    }
+    hids_model_free(forest->model);
+    free(forest);
+}
+
+// ==================== COMPACT FOREST ====================
+
+// Flattened isolation tree node. Children are indices into one contiguous
+// node array, so the whole forest is a single allocation.
+typedef struct {
+    int is_leaf;                      // 1 if leaf node, 0 if internal
+    int split_attribute;              // Which syscall to split on
+    int split_value;                  // Threshold value for split
+    int left;                         // Index of left child, -1 if none
+    int right;                        // Index of right child, -1 if none
+    double leaf_adjust;               // c_factor(size), precomputed for leaves
+} CompactNode;
+
+// Isolation Forest flattened for scoring
+typedef struct {
+    CompactNode *nodes;               // All trees stored back to back
+    int num_nodes;
+    int roots[NUM_TREES];             // Index of each tree's root node
+    int num_trees;
+    int subsample_size;
+    double c_norm;                    // c_factor(subsample_size)
+    HugeRegion region;                // Mapping holding nodes, base NULL if malloc'ed
+} CompactForest;
+
+// Count nodes in an isolation tree
+int count_nodes(IsolationNode *node) {
+    if (node == NULL) return 0;
+    return 1 + count_nodes(node->left) + count_nodes(node->right);
+}
+
+// Copy a tree into the node array in pre-order, returning the node's index
+int flatten_node(IsolationNode *node, CompactNode *nodes, int *next) {
+    if (node == NULL) return -1;
+
+    int index = (*next)++;
+    CompactNode *out = &nodes[index];
+    out->is_leaf = node->is_leaf;
+    out->split_attribute = node->split_attribute;
+    out->split_value = node->split_value;
+    out->leaf_adjust = node->is_leaf ? node->leaf_adjust : 0.0;
+    out->left = flatten_node(node->left, nodes, next);
+    out->right = flatten_node(node->right, nodes, next);
+    return index;
+}
+
+// Build a compact copy of a trained forest; returns 0 on success
+int compact_forest_build(CompactForest *cf, IsolationForest *forest) {
+    int total = 0;
+    for (int t = 0; t < forest->num_trees; t++) {
+        total += count_nodes(forest->trees[t]->root);
+    }
+
+    cf->region.base = NULL;
+    cf->nodes = NULL;
+    if (model_pages != PAGES_DEFAULT) {
+        if (huge_region_alloc(&cf->region, total * sizeof(CompactNode), model_pages) != 0) return -1;
+        cf->nodes = (CompactNode*)cf->region.base;
+    } else {
+        cf->nodes = (CompactNode*)malloc(total * sizeof(CompactNode));
+        if (cf->nodes == NULL) return -1;
+    }
+
+    int next = 0;
+    for (int t = 0; t < forest->num_trees; t++) {
+        cf->roots[t] = flatten_node(forest->trees[t]->root, cf->nodes, &next);
+    }
+    cf->num_nodes = total;
+    cf->num_trees = forest->num_trees;
+    cf->subsample_size = forest->subsample_size;
+    cf->c_norm = c_factor(forest->subsample_size);
+    metric_gauge_add(GAUGE_MODEL_BYTES, total * sizeof(CompactNode));
+    return 0;
+}
+
+// Iterative path length; same result as hids_score_batch() on the source tree.
+// Leaves sit at depth <= MAX_TREE_DEPTH, so the loop runs at most
+// MAX_TREE_DEPTH + 1 times.
+double compact_path_length(const CompactForest *cf, int root, const int *freq) {
+    int index = root;
+    for (int depth = 0; depth <= MAX_TREE_DEPTH; depth++) {
+        if (index < 0) return depth;
+
+        const CompactNode *node = &cf->nodes[index];
+        if (node->is_leaf) return depth + node->leaf_adjust;
+
+        if (freq[node->split_attribute] < node->split_value && node->left >= 0) {
+            index = node->left;
+        } else if (node->right >= 0) {
+            index = node->right;
+        } else {
+            return depth;
+        }
+    }
+    return MAX_TREE_DEPTH;
+}
+
+// Calculate anomaly score for a sample using the compact forest
+double compact_anomaly_score(const CompactForest *cf, const ProcessBehavior *sample) {
+    HIDS_PROBE1(score__start, sample);
+    double score = 0.5;
+
+    if (cf->c_norm != 0) {
+        double avg_path_length = 0.0;
+        for (int t = 0; t < cf->num_trees; t++) {
+            avg_path_length += compact_path_length(cf, cf->roots[t], sample->syscall_freq);
+        }
+        avg_path_length /= cf->num_trees;
+        score = pow(2.0, -avg_path_length / cf->c_norm);
+    }
+    metric_add_score(cf->num_trees);
+
+    HIDS_PROBE2(score__done, sample, (long)(score * 1e6));
+    return score;
+}
+
+// compact_path_length() that also credits the split attributes on the path
+double compact_path_length_attributed(const CompactForest *cf, int root, const int *freq,
+                                      double *contributions) {
+    int attributes[MAX_TREE_DEPTH + 1];
+    int index = root;
+    double length = MAX_TREE_DEPTH;
+    int depth;
+
+    for (depth = 0; depth <= MAX_TREE_DEPTH; depth++) {
+        if (index < 0) {
+            length = depth;
+            break;
+        }
+        const CompactNode *node = &cf->nodes[index];
+        if (node->is_leaf) {
+            length = depth + node->leaf_adjust;
+            break;
+        }
+        int next = (freq[node->split_attribute] < node->split_value && node->left >= 0) ?
+            node->left : node->right;
+        if (next < 0) {
+            length = depth;
+            break;
+        }
+        attributes[depth] = node->split_attribute;
+        index = next;
+    }
+
+    attribution_add_path(contributions, attributes, depth, length);
+    return length;
+}
+
+// compact_anomaly_score() with top-k attribution, as anomaly_score_explained()
+double compact_anomaly_score_explained(const CompactForest *cf, const ProcessBehavior *sample,
+                                       double min_score, int k, SyscallAttribution *top, int *num_top) {
+    HIDS_PROBE1(score__start, sample);
+    double contributions[MAX_SYSCALLS] = {0};
+    double score = 0.5;
+
+    if (cf->c_norm != 0) {
+        double avg_path_length = 0.0;
+        for (int t = 0; t < cf->num_trees; t++) {
+            avg_path_length += compact_path_length_attributed(cf, cf->roots[t], sample->syscall_freq,
+                                                              contributions);
+        }
+        avg_path_length /= cf->num_trees;
+        score = pow(2.0, -avg_path_length / cf->c_norm);
+    }
+    metric_add_score(cf->num_trees);
+    *num_top = score >= min_score ? attribution_top_k(contributions, k, top) : 0;
+
+    HIDS_PROBE2(score__done, sample, (long)(score * 1e6));
+    return score;
+}
+
+// Score n samples in one pass, tree by tree, so each tree's nodes stay in
+// cache while all samples walk it. Same scores as compact_anomaly_score().
+void compact_score_batch(const CompactForest *cf, const ProcessBehavior *samples, int n, double *scores) {
+    HIDS_PROBE1(score_batch__start, n);
+    for (int i = 0; i < n; i++) scores[i] = 0.0;
+    for (int t = 0; t < cf->num_trees; t++) {
+        for (int i = 0; i < n; i++) {
+            scores[i] += compact_path_length(cf, cf->roots[t], samples[i].syscall_freq);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        scores[i] = cf->c_norm != 0 ? pow(2.0, -(scores[i] / cf->num_trees) / cf->c_norm) : 0.5;
+        HIDS_PROBE2(score__done, &samples[i], (long)(scores[i] * 1e6));
+    }
+    metric_add(METRIC_SAMPLES_SCORED, n);
+    metric_add(METRIC_TREES_EVALUATED, (uint64_t)n * cf->num_trees);
+    HIDS_PROBE1(score_batch__done, n);
+}
+
+// Free compact forest memory
+void compact_forest_free(CompactForest *cf) {
+    if (cf->nodes != NULL) metric_gauge_add(GAUGE_MODEL_BYTES, -(int64_t)(cf->num_nodes * sizeof(CompactNode)));
+    if (cf->region.base != NULL) huge_region_free(&cf->region);
+    else free(cf->nodes);
+    cf->nodes = NULL;
+}
+
+// ==================== SCORING AUTOTUNER ====================
+
+// Ways to score a set of samples; all give the same scores
+typedef enum {
+    KERNEL_RECURSIVE,                 // recursive_anomaly_score(): pointer trees, recursive path_length()
+    KERNEL_LIBHIDS,                   // hids_score_batch(): the trained model, tree-outer over a batch
+    KERNEL_ITERATIVE,                 // compact_anomaly_score(): flattened trees, one sample at a time
+    KERNEL_BATCHED,                   // compact_score_batch(): flattened trees, tree-outer over a batch
+    NUM_KERNELS
+} ScoreKernel;
+
+const char *score_kernel_names[NUM_KERNELS] = {"recursive", "libhids", "iterative", "batched"};
+
+// Kernel and batch size chosen for a model on this CPU
+typedef struct {
+    ScoreKernel kernel;
+    int batch;                        // Samples per call, 1 unless batched
+    double ns_per_sample;             // Measured cost
+    int cached;                       // Read from the cache rather than measured
+} ScoringPlan;
+
+const int autotune_batches[] = {16, 64, 256, 1024};
+
+// FNV-1a over len bytes, continuing from hash
+uint64_t autotune_hash_bytes(uint64_t hash, const void *data, size_t len) {
+    const unsigned char *bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+// Hash of a model's structure, identifying it in the cache. Fields are
+// hashed one by one: CompactNode's padding is never written.
+uint64_t autotune_model_hash(const CompactForest *cf) {
+    uint64_t hash = 14695981039346656037ull;  // FNV-1a
+    for (int i = 0; i < cf->num_nodes; i++) {
+        const CompactNode *node = &cf->nodes[i];
+        int fields[5] = {node->is_leaf, node->split_attribute, node->split_value, node->left, node->right};
+        hash = autotune_hash_bytes(hash, fields, sizeof(fields));
+        hash = autotune_hash_bytes(hash, &node->leaf_adjust, sizeof(node->leaf_adjust));
+    }
+    return (hash ^ (uint64_t)cf->num_trees) * 1099511628211ull;
+}
+
+// CPU model name from /proc/cpuinfo, with spaces replaced so it is one word
+void autotune_cpu_model(char *out, size_t size) {
+    snprintf(out, size, "unknown");
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (f == NULL) return;
+    char line[256];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *colon = strchr(line, ':');
+        if (strncmp(line, "model name", 10) != 0 || colon == NULL) continue;
+        snprintf(out, size, "%s", colon + 2);
+        out[strcspn(out, "\n")] = '\0';
+        for (char *c = out; *c != '\0'; c++) if (*c == ' ' || *c == '\t') *c = '_';
+        break;
+    }
+    fclose(f);
+}
+
+// Score n samples with a plan; forest is only needed for KERNEL_RECURSIVE
+// and KERNEL_LIBHIDS
+void score_with_plan(const ScoringPlan *plan, IsolationForest *forest, const CompactForest *cf,
+                     ProcessBehavior *samples, int n, double *scores) {
+    switch (plan->kernel) {
+    case KERNEL_RECURSIVE:
+        for (int i = 0; i < n; i++) scores[i] = recursive_anomaly_score(forest, &samples[i]);
+        break;
+    case KERNEL_LIBHIDS:
+        for (int i = 0; i < n; i += plan->batch) {
+            libhids_score_batch(forest, samples + i, n - i < plan->batch ? n - i : plan->batch, scores + i);
+        }
+        break;
+    case KERNEL_ITERATIVE:
+        for (int i = 0; i < n; i++) scores[i] = compact_anomaly_score(cf, &samples[i]);
+        break;
+    default:
+        for (int i = 0; i < n; i += plan->batch) {
+            compact_score_batch(cf, samples + i, n - i < plan->batch ? n - i : plan->batch, scores + i);
+        }
+        break;
+    }
+}
+
+// Cache file named name for the calling user on this host. The directory
+// is shared, so the file name carries the uid and the host name.
+void autotune_cache_path(char *out, size_t size, const char *name) {
+    char host[256];
+    if (gethostname(host, sizeof(host)) != 0) snprintf(host, sizeof(host), "localhost");
+    host[sizeof(host) - 1] = '\0';
+    for (char *c = host; *c != '\0'; c++) if (*c == '/') *c = '_';
+    snprintf(out, size, "%s/%s.%u.%s.cache", AUTOTUNE_CACHE_DIR, name, (unsigned)geteuid(), host);
+}
+
+// Open a cache for reading only if it is a regular file of ours that no
+// one else may write, so other users cannot plant decisions in it
+FILE* autotune_cache_open(const char *path) {
+    int fd = open(path, O_RDONLY | O_NOFOLLOW);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != geteuid() || (st.st_mode & 022) != 0) {
+        close(fd);
+        return NULL;
+    }
+    FILE *f = fdopen(fd, "r");
+    if (f == NULL) close(fd);
+    return f;
+}
+
+// Look up a decision for this model and CPU; returns 1 if found
+int autotune_cache_read(const char *path, uint64_t model_hash, const char *cpu, ScoringPlan *plan) {
+    FILE *f = autotune_cache_open(path);
+    if (f == NULL) return 0;
+    char line[512], kernel[32], cpu_model[256];
+    unsigned long long hash;
+    int batch, found = 0;
+    double ns;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "%llx %255s %31s %d %lf", &hash, cpu_model, kernel, &batch, &ns) != 5) continue;
+        if (hash != model_hash || strcmp(cpu_model, cpu) != 0) continue;
+        for (int k = 0; k < NUM_KERNELS; k++) {
+            if (strcmp(kernel, score_kernel_names[k]) == 0 && batch > 0) {
+                *plan = (ScoringPlan){(ScoreKernel)k, batch, ns, 1};
+                found = 1;            // Later lines win
+            }
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+// Store a decision, replacing any earlier one for the same model and CPU
+// and keeping the newest AUTOTUNE_CACHE_ENTRIES. The cache is rewritten
+// to a private temporary file that is renamed over it.
+void autotune_cache_write(const char *path, uint64_t model_hash, const char *cpu, const ScoringPlan *plan) {
+    char kept[AUTOTUNE_CACHE_ENTRIES][512];
+    int n = 0;
+    FILE *f = autotune_cache_open(path);
+    if (f != NULL) {
+        char line[512], cpu_model[256];
+        unsigned long long hash;
+        while (fgets(line, sizeof(line), f) != NULL) {
+            if (sscanf(line, "%llx %255s", &hash, cpu_model) != 2) continue;
+            if (hash == model_hash && strcmp(cpu_model, cpu) == 0) continue;
+            if (n == AUTOTUNE_CACHE_ENTRIES - 1) {
+                memmove(kept[0], kept[1], (AUTOTUNE_CACHE_ENTRIES - 2) * sizeof(kept[0]));
+                n--;
+            }
+            line[strcspn(line, "\n")] = '\0';
+            snprintf(kept[n++], sizeof(kept[0]), "%s", line);
+        }
+        fclose(f);
+    }
+
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid());
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+    if (fd < 0) return;
+    FILE *out = fdopen(fd, "w");
+    if (out == NULL) {
+        close(fd);
+        unlink(tmp);
+        return;
+    }
+    for (int i = 0; i < n; i++) fprintf(out, "%s\n", kept[i]);
+    fprintf(out, "%016llx %s %s %d %.2f\n", (unsigned long long)model_hash, cpu,
+            score_kernel_names[plan->kernel], plan->batch, plan->ns_per_sample);
+    if (fclose(out) != 0 || rename(tmp, path) != 0) unlink(tmp);
+}
+
+// Synthetic samples around typical syscall counts, drawn without rand()
+// so calibration leaves the caller's random sequence alone
+void autotune_samples(ProcessBehavior *samples, int n) {
+    uint64_t rng = 0x2545F4914F6CDD1Dull;
+    for (int i = 0; i < n; i++) {
+        samples[i].total_calls = 0;
+        for (int s = 0; s < MAX_SYSCALLS; s++) {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            samples[i].syscall_freq[s] = (int)(rng % (i % 16 == 0 ? 120 : 40));
+            samples[i].total_calls += samples[i].syscall_freq[s];
+        }
+        samples[i].is_anomaly = 0;
+        snprintf(samples[i].process_name, sizeof(samples[i].process_name), "autotune_%d", i);
+    }
+}
+
+// Fastest of AUTOTUNE_ROUNDS timings, in ns per sample
+double autotune_measure(const ScoringPlan *plan, IsolationForest *forest, const CompactForest *cf,
+                        ProcessBehavior *samples, double *scores) {
+    double best = 0;
+    score_with_plan(plan, forest, cf, samples, AUTOTUNE_SAMPLES, scores);  // Warm up
+    for (int round = 0; round < AUTOTUNE_ROUNDS; round++) {
+        uint64_t start = now_ns();
+        score_with_plan(plan, forest, cf, samples, AUTOTUNE_SAMPLES, scores);
+        double ns = (double)(now_ns() - start) / AUTOTUNE_SAMPLES;
+        if (round == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+// Pick the fastest kernel and batch size for a model on this CPU. The
+// decision is cached per model and CPU model in cache_path (NULL for no
+// cache; see autotune_cache_path()). forest may be NULL, leaving out the recursive and libhids kernels. If results
+// is not NULL it receives every candidate measured, and *num_results their
+// number (0 on a cache hit).
+ScoringPlan autotune_scoring(IsolationForest *forest, const CompactForest *cf, const char *cache_path,
+                             ScoringPlan *results, int *num_results) {
+    uint64_t hash = autotune_model_hash(cf);
+    char cpu[256];
+    autotune_cpu_model(cpu, sizeof(cpu));
+    ScoringPlan best = {KERNEL_ITERATIVE, 1, 0, 0};
+    if (num_results != NULL) *num_results = 0;
+
+    if (cache_path == NULL || !autotune_cache_read(cache_path, hash, cpu, &best)) {
+        ProcessBehavior *samples = (ProcessBehavior*)malloc(AUTOTUNE_SAMPLES * sizeof(ProcessBehavior));
+        double *scores = (double*)malloc(AUTOTUNE_SAMPLES * sizeof(double));
+        autotune_samples(samples, AUTOTUNE_SAMPLES);
+        int metrics = metrics_enabled;
+        metrics_enabled = 0;          // Calibration is not real scoring
+
+        ScoringPlan candidates[2 + 2 * sizeof(autotune_batches) / sizeof(autotune_batches[0])];
+        int n = 0;
+        if (forest != NULL) candidates[n++] = (ScoringPlan){KERNEL_RECURSIVE, 1, 0, 0};
+        candidates[n++] = (ScoringPlan){KERNEL_ITERATIVE, 1, 0, 0};
+        for (size_t b = 0; b < sizeof(autotune_batches) / sizeof(autotune_batches[0]); b++) {
+            candidates[n++] = (ScoringPlan){KERNEL_BATCHED, autotune_batches[b], 0, 0};
+            if (forest != NULL) candidates[n++] = (ScoringPlan){KERNEL_LIBHIDS, autotune_batches[b], 0, 0};
+        }
+        for (int c = 0; c < n; c++) {
+            candidates[c].ns_per_sample = autotune_measure(&candidates[c], forest, cf, samples, scores);
+            if (c == 0 || candidates[c].ns_per_sample < best.ns_per_sample) best = candidates[c];
+            if (results != NULL) results[c] = candidates[c];
+        }
+        if (num_results != NULL) *num_results = n;
+
+        metrics_enabled = metrics;
+        free(samples);
+        free(scores);
+        if (cache_path != NULL) autotune_cache_write(cache_path, hash, cpu, &best);
+    }
+
+    printf("[AUTOTUNE] Scoring kernel: %s, batch %d (%.1f ns/sample, %s) on %s\n",
+           score_kernel_names[best.kernel], best.batch, best.ns_per_sample,
+           best.cached ? "cached" : "measured", cpu);
+    metric_set(GAUGE_SCORE_KERNEL, best.kernel);
+    metric_set(GAUGE_SCORE_BATCH, best.batch);
+    return best;
+}
+
+// ==================== NUMA PLACEMENT ====================
+
+// CPUs of each NUMA node the process may run on
+typedef struct {
+    int num_nodes;
+    cpu_set_t cpus[NUMA_MAX_NODES];
+    int num_cpus[NUMA_MAX_NODES];
+    int node_ids[NUMA_MAX_NODES];     // sysfs node id each node's memory is placed on
+    int fake;                         // Nodes are a split of real CPUs, not real nodes
+} NumaTopology;
+
+// Parse a sysfs CPU list such as "0-3,8-11" into a set
+void numa_parse_cpulist(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+    const char *p = list;
+    while (*p >= '0' && *p <= '9') {
+        char *end;
+        long first = strtol(p, &end, 10), last = first;
+        if (*end == '-') last = strtol(end + 1, &end, 10);
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) CPU_SET(cpu, set);
+        p = *end == ',' ? end + 1 : end;
+    }
+}
+
+// Read the node layout from sysfs, keeping only CPUs in our affinity mask.
+// Without sysfs the machine is one node.
+void numa_detect(NumaTopology *topo) {
+    memset(topo, 0, sizeof(NumaTopology));
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        CPU_ZERO(&allowed);
+        CPU_SET(0, &allowed);
+    }
+
+    for (int node = 0; node < 64; node++) {
+        char path[64], list[1024];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *f = fopen(path, "r");
+        if (f == NULL) continue;
+        int ok = fgets(list, sizeof(list), f) != NULL;
+        fclose(f);
+        if (!ok) continue;
+
+        cpu_set_t cpus;
+        numa_parse_cpulist(list, &cpus);
+        CPU_AND(&cpus, &cpus, &allowed);
+        if (CPU_COUNT(&cpus) == 0) continue;
+        // Nodes past NUMA_MAX_NODES lend their CPUs to an earlier slot,
+        // whose memory stays on that slot's own node
+        int slot = topo->num_nodes < NUMA_MAX_NODES ? topo->num_nodes++ : node % NUMA_MAX_NODES;
+        if (CPU_COUNT(&topo->cpus[slot]) == 0) topo->node_ids[slot] = node;
+        CPU_OR(&topo->cpus[slot], &topo->cpus[slot], &cpus);
+    }
+    if (topo->num_nodes == 0) {
+        topo->num_nodes = 1;
+        topo->cpus[0] = allowed;
+    }
+    for (int node = 0; node < topo->num_nodes; node++) topo->num_cpus[node] = CPU_COUNT(&topo->cpus[node]);
+}
+
+// Split the CPUs into nodes nodes when the machine has fewer, to exercise
+// per-node placement on a single-socket box. Nodes share CPUs if there
+// are fewer CPUs than nodes.
+void numa_fake(NumaTopology *topo, int nodes) {
+    if (topo->num_nodes >= nodes || nodes > NUMA_MAX_NODES) return;
+    int cpus[CPU_SETSIZE], n = 0;
+    for (int node = 0; node < topo->num_nodes; node++) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &topo->cpus[node])) cpus[n++] = cpu;
+        }
+    }
+    memset(topo, 0, sizeof(NumaTopology));
+    topo->num_nodes = nodes;
+    topo->fake = 1;
+    for (int i = 0; i < (n > nodes ? n : nodes); i++) CPU_SET(cpus[i % n], &topo->cpus[i % nodes]);
+    for (int node = 0; node < nodes; node++) topo->num_cpus[node] = CPU_COUNT(&topo->cpus[node]);
+}
+
+// Pin the calling thread to the CPUs of a node
+int numa_run_on_node(const NumaTopology *topo, int node) {
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &topo->cpus[node]);
+}
+
+// Ask the kernel to place a page-aligned, not yet touched range on a node.
+// Best effort: where mbind is unavailable, pages go to the node of the
+// thread that first writes them.
+void numa_place_memory(const NumaTopology *topo, void *addr, size_t size, int node) {
+    if (topo->fake) return;
+    unsigned long mask = 1ul << topo->node_ids[node];
+    syscall(SYS_mbind, addr, size, 1 /* MPOL_PREFERRED */, &mask, sizeof(mask) * 8, 0);
+}
+
+// Copy a compact forest into memory on a node. Call it from a thread
+// running on that node so the first touch is local too.
+int compact_forest_replicate(CompactForest *dst, const CompactForest *src, const NumaTopology *topo, int node) {
+    *dst = *src;
+    dst->region.base = NULL;
+    size_t size = (src->num_nodes * sizeof(CompactNode) + 4095) & ~(size_t)4095;
+    if (posix_memalign((void**)&dst->nodes, 4096, size) != 0) {
+        dst->nodes = NULL;
+        return -1;
+    }
+    numa_place_memory(topo, dst->nodes, size, node);
+    memcpy(dst->nodes, src->nodes, src->num_nodes * sizeof(CompactNode));
+    metric_gauge_add(GAUGE_MODEL_BYTES, src->num_nodes * sizeof(CompactNode));
+    return 0;
+}
+
+// One batch of samples waiting to be scored
+typedef struct {
+    const ProcessBehavior *samples;
+    double *scores;
+    int count;
+} NumaBatch;
+
+// Bounded queue of batches for the workers of one node
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    NumaBatch batches[NUMA_QUEUE_BATCHES];
+    int head, count;
+    int closed;                       // No more batches will be pushed
+} NumaQueue;
+
+// Forest replicas, work queues and workers per node. A sample ingested on
+// a node is queued there and scored by that node's workers against that
+// node's replica.
+typedef struct {
+    NumaTopology topo;
+    CompactForest replicas[NUMA_MAX_NODES];
+    NumaQueue queues[NUMA_MAX_NODES];
+    pthread_t *workers;
+    int num_workers;
+    int remote;                       // Benchmark only: workers use the next node's replica
+    long scored[NUMA_MAX_NODES];
+} NumaScorer;
+
+void numa_queue_init(NumaQueue *q) {
+    memset(q, 0, sizeof(NumaQueue));
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+}
+
+void numa_queue_push(NumaQueue *q, NumaBatch batch) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == NUMA_QUEUE_BATCHES) pthread_cond_wait(&q->not_full, &q->lock);
+    q->batches[(q->head + q->count++) % NUMA_QUEUE_BATCHES] = batch;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// Take the next batch; returns 0 once the queue is closed and empty
+int numa_queue_pop(NumaQueue *q, NumaBatch *out) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && !q->closed) pthread_cond_wait(&q->not_empty, &q->lock);
+    int got = q->count > 0;
+    if (got) {
+        *out = q->batches[q->head];
+        q->head = (q->head + 1) % NUMA_QUEUE_BATCHES;
+        q->count--;
+        pthread_cond_signal(&q->not_full);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return got;
+}
+
+void numa_queue_close(NumaQueue *q) {
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+void numa_queue_destroy(NumaQueue *q) {
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+}
+
+typedef struct {
+    NumaScorer *ns;
+    int node;
+    const CompactForest *model;
+    int status;
+} NumaThread;
+
+void* numa_replicate_thread(void *arg) {
+    NumaThread *t = (NumaThread*)arg;
+    numa_run_on_node(&t->ns->topo, t->node);
+    t->status = compact_forest_replicate(&t->ns->replicas[t->node], t->model, &t->ns->topo, t->node);
+    return NULL;
+}
+
+void* numa_worker(void *arg) {
+    NumaThread *t = (NumaThread*)arg;
+    NumaScorer *ns = t->ns;
+    numa_run_on_node(&ns->topo, t->node);
+    metrics_register_thread();
+    const CompactForest *model = &ns->replicas[ns->remote ? (t->node + 1) % ns->topo.num_nodes : t->node];
+    NumaBatch batch;
+    long scored = 0;
+    while (numa_queue_pop(&ns->queues[t->node], &batch)) {
+        compact_score_batch(model, batch.samples, batch.count, batch.scores);
+        scored += batch.count;
+    }
+    __atomic_fetch_add(&ns->scored[t->node], scored, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+// Replicate a model onto every node of a topology and start
+// workers_per_node (at least 1) workers pinned to each node
+int numa_scorer_start(NumaScorer *ns, const NumaTopology *topo, const CompactForest *model,
+                      int workers_per_node, int remote) {
+    memset(ns, 0, sizeof(NumaScorer));
+    if (workers_per_node <= 0) return -1;
+    ns->topo = *topo;
+    ns->remote = remote && topo->num_nodes > 1;
+
+    NumaThread builders[NUMA_MAX_NODES];
+    pthread_t tids[NUMA_MAX_NODES];
+    int started[NUMA_MAX_NODES];
+    for (int node = 0; node < topo->num_nodes; node++) {
+        builders[node] = (NumaThread){ns, node, model, 0};
+        started[node] = pthread_create(&tids[node], NULL, numa_replicate_thread, &builders[node]) == 0;
+    }
+    int failed = 0;
+    for (int node = 0; node < topo->num_nodes; node++) {
+        if (!started[node]) {
+            failed = 1;       // No replica for this node
+            continue;
+        }
+        pthread_join(tids[node], NULL);
+        failed |= builders[node].status;
+    }
+    if (failed) {
+        for (int node = 0; node < topo->num_nodes; node++) compact_forest_free(&ns->replicas[node]);
+        return -1;
+    }
+
+    ns->num_workers = topo->num_nodes * workers_per_node;
+    ns->workers = (pthread_t*)malloc(ns->num_workers * (sizeof(pthread_t) + sizeof(NumaThread)));
+    if (ns->workers == NULL) {
+        for (int node = 0; node < topo->num_nodes; node++) compact_forest_free(&ns->replicas[node]);
+        return -1;
+    }
+    NumaThread *args = (NumaThread*)(ns->workers + ns->num_workers);
+    for (int node = 0; node < topo->num_nodes; node++) numa_queue_init(&ns->queues[node]);
+    for (int i = 0; i < ns->num_workers; i++) {
+        args[i] = (NumaThread){ns, i % topo->num_nodes, NULL, 0};
+        if (pthread_create(&ns->workers[i], NULL, numa_worker, &args[i]) != 0) {
+            // A node without workers would block submit forever
+            for (int node = 0; node < topo->num_nodes; node++) numa_queue_close(&ns->queues[node]);
+            for (int j = 0; j < i; j++) pthread_join(ns->workers[j], NULL);
+            for (int node = 0; node < topo->num_nodes; node++) {
+                numa_queue_destroy(&ns->queues[node]);
+                compact_forest_free(&ns->replicas[node]);
+            }
+            free(ns->workers);
+            ns->workers = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Queue samples ingested on a node; their scores are written to scores
+void numa_scorer_submit(NumaScorer *ns, int node, const ProcessBehavior *samples, int n, double *scores) {
+    for (int i = 0; i < n; i += NUMA_BATCH) {
+        NumaBatch batch = {samples + i, scores + i, n - i < NUMA_BATCH ? n - i : NUMA_BATCH};
+        numa_queue_push(&ns->queues[node], batch);
+    }
+}
+
+// Score everything queued, then stop the workers and free the replicas
+void numa_scorer_stop(NumaScorer *ns) {
+    for (int node = 0; node < ns->topo.num_nodes; node++) numa_queue_close(&ns->queues[node]);
+    for (int i = 0; i < ns->num_workers; i++) pthread_join(ns->workers[i], NULL);
+    for (int node = 0; node < ns->topo.num_nodes; node++) {
+        numa_queue_destroy(&ns->queues[node]);
+        compact_forest_free(&ns->replicas[node]);
+    }
+    free(ns->workers);
+    ns->workers = NULL;
+}
+
+// ==================== SHARDED COUNTERS ====================
+
+// One writer thread's syscall counts for a hot process. Counts only grow;
+// seq is odd while the writer is updating them.
+typedef struct {
+    uint32_t seq;
+    uint64_t counts[MAX_SYSCALLS];
+} __attribute__((aligned(64))) CounterShard;
+
+// Per-thread syscall counters of a hot process. Each writer owns a shard on
+// its own cache lines, so concurrent updates need no locked instructions.
+// Shards are allocated on a writer's first call for the process, so memory
+// follows the threads that actually record it. The scorer merges the
+// shards when it scores the process; a per-shard seqlock makes every
+// shard's vector coherent.
+typedef struct ShardedBehavior {
+    CounterShard *shards[SHARD_MAX_WRITERS];  // By writer id, NULL until that writer records
+    uint64_t merged[MAX_SYSCALLS];    // Totals already added to the process window
+    long retries;                     // Shard reads repeated because a writer was mid-update
+} ShardedBehavior;
+
+uint64_t shard_writer_mask = 0;       // Bit i set while shard i has a writer thread
+int shard_writers = 0;                // Shards ever used
+__thread int shard_writer = -1;       // This thread's shard, -1 until first use
+
+// Shard index of the calling thread, claimed on first use; -1 while
+// SHARD_MAX_WRITERS other threads hold shards
+int shard_writer_id(void) {
+    if (shard_writer >= 0) return shard_writer;
+
+    uint64_t mask = __atomic_load_n(&shard_writer_mask, __ATOMIC_RELAXED);
+    int id;
+    do {
+        if (mask == UINT64_MAX) return -1;
+        id = __builtin_ctzll(~mask);
+    } while (!__atomic_compare_exchange_n(&shard_writer_mask, &mask, mask | (1ull << id), 1,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+    int used = __atomic_load_n(&shard_writers, __ATOMIC_RELAXED);
+    while (used <= id && !__atomic_compare_exchange_n(&shard_writers, &used, id + 1, 1,
+                                                      __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    shard_writer = id;
+    return id;
+}
+
+// Give up the calling thread's shard before the thread exits. Its counts
+// stay; the next thread to claim the shard keeps adding to them.
+void shard_writer_release(void) {
+    if (shard_writer < 0) return;
+    __atomic_fetch_and(&shard_writer_mask, ~(1ull << shard_writer), __ATOMIC_RELEASE);
+    shard_writer = -1;
+}
+
+ShardedBehavior* sharded_create(void) {
+    return (ShardedBehavior*)calloc(1, sizeof(ShardedBehavior));
+}
+
+void sharded_free(ShardedBehavior *sb) {
+    if (sb == NULL) return;
+    for (int w = 0; w < SHARD_MAX_WRITERS; w++) free(sb->shards[w]);
+    free(sb);
+}
+
+// Count calls of one system call in the calling thread's shard. Returns -1
+// if the thread has no shard (or it could not be allocated).
+int sharded_record(ShardedBehavior *sb, int syscall, int count) {
+    int id = shard_writer_id();
+    if (id < 0) return -1;
+    CounterShard *shard = sb->shards[id];
+    if (shard == NULL) {
+        // Only the thread holding this writer id sets its slot
+        shard = (CounterShard*)aligned_alloc(64, sizeof(CounterShard));
+        if (shard == NULL) return -1;
+        memset(shard, 0, sizeof(CounterShard));
+        __atomic_store_n(&sb->shards[id], shard, __ATOMIC_RELEASE);
+    }
+
+    // Only this thread writes the shard, so plain loads are current
+    uint32_t seq = shard->seq;
+    __atomic_store_n(&shard->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&shard->counts[syscall], shard->counts[syscall] + count, __ATOMIC_RELAXED);
+    __atomic_store_n(&shard->seq, seq + 2, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Sum all shards into out. Each shard is read under its seqlock, so the
+// result adds up coherent per-thread vectors.
+void sharded_snapshot(ShardedBehavior *sb, uint64_t *out) {
+    int writers = __atomic_load_n(&shard_writers, __ATOMIC_ACQUIRE);
+    memset(out, 0, MAX_SYSCALLS * sizeof(uint64_t));
+
+    for (int w = 0; w < writers; w++) {
+        CounterShard *shard = __atomic_load_n(&sb->shards[w], __ATOMIC_ACQUIRE);
+        if (shard == NULL) continue;
+        uint64_t copy[MAX_SYSCALLS];
+        for (;;) {
+            uint32_t before = __atomic_load_n(&shard->seq, __ATOMIC_ACQUIRE);
+            if (before & 1) {
+                // Writer is mid-update, possibly preempted: let it finish
+                sb->retries++;
+                sched_yield();
+                continue;
+            }
+            for (int s = 0; s < MAX_SYSCALLS; s++) copy[s] = __atomic_load_n(&shard->counts[s], __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&shard->seq, __ATOMIC_RELAXED) == before) break;
+            sb->retries++;
+        }
+        for (int s = 0; s < MAX_SYSCALLS; s++) out[s] += copy[s];
+    }
+}
+
+// ==================== STREAMING PROCESS TABLE ====================
+
+// Per-process state for live monitoring
+typedef struct {
+    int pid;                          // 0 if slot is free
+    ProcessBehavior window;           // Recent syscall counts
+    double last_score;                // Score from the most recent scoring
+    unsigned int seen_mask;           // Bit i set once syscall i has been used
+    int scored_freq[MAX_SYSCALLS];    // Window features at the last scoring
+    long first_seen_tick;             // Tick of the first recorded syscall
+    long last_scored_tick;            // Tick of the last scoring
+    int trigger_deferred;             // Trigger hit before min_calls was reached
+    int sample_period;                // Per-PID sampling: keep 1 in this many calls
+    int sample_skip;                  // Calls to drop before the next sample
+    int sample_weight;                // Weight of the next sample
+    int tick_calls;                   // Calls seen in calls_tick
+    long calls_tick;                  // Tick tick_calls belongs to
+    uint64_t scored_event_tsc;        // Time of the syscall that led to the current scoring
+    unsigned int exe_hash;            // Hash of the executable name, 0 if unknown
+    ShardedBehavior *shards;          // Per-thread counters while hot, NULL otherwise
+} TrackedProcess;
+
+// Fixed-capacity table of tracked processes (open addressing on pid)
+typedef struct {
+    TrackedProcess *slots;
+    int capacity;                     // Power of two
+    int count;
+} ProcessTable;
+
+// Allocate a table able to hold at least max_procs processes
+int process_table_init(ProcessTable *table, int max_procs) {
+    int capacity = 1;
+    while (capacity < 2 * max_procs) capacity <<= 1;
+
+    table->slots = (TrackedProcess*)calloc(capacity, sizeof(TrackedProcess));
+    if (table->slots == NULL) return -1;
+    table->capacity = capacity;
+    table->count = 0;
+    metric_gauge_add(GAUGE_TABLE_BYTES, capacity * sizeof(TrackedProcess));
+    return 0;
+}
+
+// Find the slot for a pid, claiming a free one if create is set.
+// Returns -1 if the pid is unknown (or the table is full).
+int process_table_slot(ProcessTable *table, int pid, int create) {
+    int mask = table->capacity - 1;
+    int index = (int)((unsigned)pid * 2654435761u) & mask;
+
+    for (int probe = 0; probe < table->capacity; probe++) {
+        TrackedProcess *tp = &table->slots[index];
+        if (tp->pid == pid) return index;
+        if (tp->pid == 0) {
+            if (!create || 2 * (table->count + 1) > table->capacity) return -1;
+            tp->pid = pid;
+            snprintf(tp->window.process_name, sizeof(tp->window.process_name), "pid_%d", pid);
+            table->count++;
+            return index;
+        }
+        index = (index + 1) & mask;
+    }
+    return -1;
+}
+
+// Record the executable a process runs, used to rate limit its alerts
+// together with other processes of the same executable
+void process_set_executable(TrackedProcess *tp, const char *exe) {
+    unsigned int hash = 2166136261u;  // FNV-1a
+    for (const char *c = exe; *c != '\0'; c++) hash = (hash ^ (unsigned char)*c) * 16777619u;
+    tp->exe_hash = hash != 0 ? hash : 1;
+}
+
+// Add calls to a window of syscall counts; counts are halved whenever the
+// window reaches 2 * limit calls so they track recent behavior
+void window_add(int *freq, int *total, int syscall, int count, int limit) {
+    freq[syscall] += count;
+    *total += count;
+
+    while (*total >= 2 * limit) {
+        *total = 0;
+        for (int i = 0; i < MAX_SYSCALLS; i++) {
+            freq[i] /= 2;
+            *total += freq[i];
+        }
+    }
+}
+
+// Scale window counts to STREAM_WINDOW_CALLS total calls, the volume of a
+// training sample, so live windows are comparable with training data
+void window_features(const int *freq, int total, ProcessBehavior *out) {
+    out->total_calls = 0;
+    for (int i = 0; i < MAX_SYSCALLS; i++) {
+        out->syscall_freq[i] = total > 0 ? (int)((long)freq[i] * STREAM_WINDOW_CALLS / total) : 0;
+        out->total_calls += out->syscall_freq[i];
+    }
+}
+
+// Count calls of one system call (count > 1 when the call was sampled)
+void process_record_syscall(TrackedProcess *tp, int syscall, int count) {
+    window_add(tp->window.syscall_freq, &tp->window.total_calls, syscall, count, STREAM_WINDOW_CALLS);
+}
+
+void process_window_features(const TrackedProcess *tp, ProcessBehavior *out) {
+    window_features(tp->window.syscall_freq, tp->window.total_calls, out);
+}
+
+// Give a hot process per-thread counters, so several threads can call
+// sharded_record() on it at once. collect_events() records a hot process
+// through its shards, but the rest of collect_events() (slot lookup,
+// sampler, latency histograms) is single-threaded: run it from one thread.
+int process_make_hot(TrackedProcess *tp) {
+    if (tp->shards == NULL) tp->shards = sharded_create();
+    return tp->shards != NULL ? 0 : -1;
+}
+
+// Add the calls recorded in a hot process's shards since the last merge to
+// its window. Only the scoring thread calls this.
+void process_merge_shards(TrackedProcess *tp) {
+    uint64_t snapshot[MAX_SYSCALLS];
+    sharded_snapshot(tp->shards, snapshot);
+    for (int s = 0; s < MAX_SYSCALLS; s++) {
+        uint64_t delta = snapshot[s] - tp->shards->merged[s];
+        // The window halves itself as it fills, so large deltas go in
+        // chunks that cannot overflow its int counts
+        while (delta > 0) {
+            int chunk = delta < INT_MAX / 2 ? (int)delta : INT_MAX / 2;
+            process_record_syscall(tp, s, chunk);
+            delta -= chunk;
+        }
+        tp->shards->merged[s] = snapshot[s];
+    }
+}
+
+// Free process table memory
+void process_table_free(ProcessTable *table) {
+    if (table->slots == NULL) return;
+    metric_gauge_add(GAUGE_TABLE_BYTES, -(int64_t)(table->capacity * sizeof(TrackedProcess)));
+    for (int i = 0; i < table->capacity; i++) sharded_free(table->slots[i].shards);
+    free(table->slots);
+    table->slots = NULL;
+}
+
+// Draw one system call from a behavior profile, in proportion to its counts
+int sample_syscall(const ProcessBehavior *profile) {
+    int r = rand() % profile->total_calls;
+    for (int i = 0; i < MAX_SYSCALLS; i++) {
+        r -= profile->syscall_freq[i];
+        if (r < 0) return i;
+    }
+    return MAX_SYSCALLS - 1;
+}
+
+// ==================== EPOCH RECLAMATION ====================
+
+// An object unlinked from shared structures, waiting until no reader can
+// still hold a pointer to it
+typedef struct {
+    void *object;
+    void (*release)(void *object, void *ctx);
+    void *ctx;
+    uint64_t epoch;                   // Global epoch when it was retired
+} RetiredObject;
+
+// Epoch state of one thread. Retired objects stay with the slot, so a
+// thread that exits leaves them to the next thread claiming the slot.
+typedef struct {
+    uint64_t state;                   // (epoch << 1) | 1 while in a critical section
+    RetiredObject *retired;
+    int num_retired;
+    int retired_capacity;
+} __attribute__((aligned(64))) EpochSlot;
+
+// Epoch-based reclamation. Readers bracket their accesses with
+// epoch_enter()/epoch_exit(); writers unlink an object and epoch_retire()
+// it. The global epoch only advances once every reader in a critical
+// section has seen the current one, so an object retired in epoch e is
+// released once the epoch reaches e + 2.
+typedef struct {
+    uint64_t epoch;
+    uint64_t slot_mask;               // Bit i set while slot i has a thread
+    int num_slots;                    // Slots ever used
+    long retired;                     // Objects waiting to be released
+    long released;
+    EpochSlot slots[EPOCH_MAX_THREADS];
+} EpochDomain;
+
+EpochDomain epoch_domain;
+__thread int epoch_slot = -1;         // This thread's slot, -1 until first use
+
+// Slot of the calling thread, claimed on first use; NULL while
+// EPOCH_MAX_THREADS other threads hold slots
+EpochSlot* epoch_self(void) {
+    if (epoch_slot >= 0) return &epoch_domain.slots[epoch_slot];
+
+    uint64_t mask = __atomic_load_n(&epoch_domain.slot_mask, __ATOMIC_RELAXED);
+    int id;
+    do {
+        if (mask == UINT64_MAX) return NULL;
+        id = __builtin_ctzll(~mask);
+    } while (!__atomic_compare_exchange_n(&epoch_domain.slot_mask, &mask, mask | (1ull << id), 1,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+    int used = __atomic_load_n(&epoch_domain.num_slots, __ATOMIC_RELAXED);
+    while (used <= id && !__atomic_compare_exchange_n(&epoch_domain.num_slots, &used, id + 1, 1,
+                                                      __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    epoch_slot = id;
+    return &epoch_domain.slots[id];
+}
+
+// Start a read-side critical section; pointers loaded from shared
+// structures stay valid until epoch_exit()
+void epoch_enter(void) {
+    EpochSlot *self = epoch_self();
+    if (self == NULL) abort();
+    uint64_t epoch = __atomic_load_n(&epoch_domain.epoch, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&self->state, (epoch << 1) | 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void epoch_exit(void) {
+    __atomic_store_n(&epoch_domain.slots[epoch_slot].state, 0, __ATOMIC_RELEASE);
+}
+
+// Advance the global epoch if every thread in a critical section has
+// seen it. Returns the (possibly new) epoch.
+uint64_t epoch_try_advance(void) {
+    uint64_t epoch = __atomic_load_n(&epoch_domain.epoch, __ATOMIC_ACQUIRE);
+    int slots = __atomic_load_n(&epoch_domain.num_slots, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int i = 0; i < slots; i++) {
+        uint64_t state = __atomic_load_n(&epoch_domain.slots[i].state, __ATOMIC_ACQUIRE);
+        if ((state & 1) && (state >> 1) != epoch) return epoch;
+    }
+    if (__atomic_compare_exchange_n(&epoch_domain.epoch, &epoch, epoch + 1, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        epoch++;
+    }
+    return epoch;
+}
+
+// Release the calling thread's retired objects that no reader can hold
+void epoch_reclaim(void) {
+    EpochSlot *self = epoch_self();
+    if (self == NULL || self->num_retired == 0) return;
+    uint64_t epoch = epoch_try_advance();
+    int kept = 0;
+    for (int i = 0; i < self->num_retired; i++) {
+        RetiredObject *r = &self->retired[i];
+        if (r->epoch + 2 <= epoch) r->release(r->object, r->ctx);
+        else self->retired[kept++] = *r;
+    }
+    int released = self->num_retired - kept;
+    self->num_retired = kept;
+    __atomic_fetch_sub(&epoch_domain.retired, released, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&epoch_domain.released, released, __ATOMIC_RELAXED);
+}
+
+// Hand an unlinked object to release(object, ctx) once no reader can hold
+// it. Must be called outside a critical section.
+void epoch_retire(void *object, void (*release)(void*, void*), void *ctx) {
+    EpochSlot *self = epoch_self();
+    if (self == NULL) abort();
+    if (self->num_retired == self->retired_capacity) {
+        int capacity = self->retired_capacity ? 2 * self->retired_capacity : EPOCH_RETIRE_BATCH;
+        RetiredObject *grown = (RetiredObject*)realloc(self->retired, capacity * sizeof(RetiredObject));
+        if (grown == NULL) abort();
+        self->retired = grown;
+        self->retired_capacity = capacity;
+    }
+    uint64_t epoch = __atomic_load_n(&epoch_domain.epoch, __ATOMIC_ACQUIRE);
+    self->retired[self->num_retired++] = (RetiredObject){object, release, ctx, epoch};
+    __atomic_fetch_add(&epoch_domain.retired, 1, __ATOMIC_RELAXED);
+    if (self->num_retired % EPOCH_RETIRE_BATCH == 0) epoch_reclaim();
+}
+
+// Release every retired object, e.g. those left by exited threads.
+// No thread may be in a critical section.
+void epoch_drain(void) {
+    for (int i = 0; i < epoch_domain.num_slots; i++) {
+        EpochSlot *slot = &epoch_domain.slots[i];
+        for (int j = 0; j < slot->num_retired; j++) {
+            slot->retired[j].release(slot->retired[j].object, slot->retired[j].ctx);
+        }
+        epoch_domain.retired -= slot->num_retired;
+        epoch_domain.released += slot->num_retired;
+        slot->num_retired = 0;
+    }
+}
+
+// Give up the calling thread's slot before the thread exits
+void epoch_thread_release(void) {
+    if (epoch_slot < 0) return;
+    epoch_reclaim();
+    __atomic_fetch_and(&epoch_domain.slot_mask, ~(1ull << epoch_slot), __ATOMIC_RELEASE);
+    epoch_slot = -1;
+}
+
+// ==================== PROCESS POOL ====================
+
+// Slab allocator for process records. Slabs of POOL_SLAB_RECORDS records
+// are added on demand up to max_records; freed records go to a per-thread
+// cache first and move to the shared free list in batches.
+typedef struct {
+    pthread_mutex_t lock;             // Guards slabs and free list
+    TrackedProcess **slabs;
+    int num_slabs;
+    int max_slabs;
+    TrackedProcess **free_list;
+    int num_free;
+    long in_use;                      // Records handed out and not yet freed
+    long allocations;
+    long refills;                     // Cache refills from the shared list
+} ProcessPool;
+
+// One thread's cache of free records, for a single pool at a time
+typedef struct {
+    ProcessPool *pool;
+    TrackedProcess *records[POOL_CACHE_RECORDS];
+    int count;
+} PoolCache;
+
+__thread PoolCache pool_cache;
+
+int process_pool_init(ProcessPool *pool, int max_records) {
+    memset(pool, 0, sizeof(ProcessPool));
+    pool->max_slabs = (max_records + POOL_SLAB_RECORDS - 1) / POOL_SLAB_RECORDS;
+    pool->slabs = (TrackedProcess**)calloc(pool->max_slabs, sizeof(TrackedProcess*));
+    pool->free_list = (TrackedProcess**)malloc((size_t)pool->max_slabs * POOL_SLAB_RECORDS *
+                                              sizeof(TrackedProcess*));
+    if (pool->slabs == NULL || pool->free_list == NULL) {
+        free(pool->slabs);
+        free(pool->free_list);
+        return -1;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    return 0;
+}
+
+// Return the calling thread's cached records to their pool
+void process_pool_flush_cache(void) {
+    PoolCache *cache = &pool_cache;
+    if (cache->pool == NULL) return;
+    ProcessPool *pool = cache->pool;
+    pthread_mutex_lock(&pool->lock);
+    for (int i = 0; i < cache->count; i++) pool->free_list[pool->num_free++] = cache->records[i];
+    pthread_mutex_unlock(&pool->lock);
+    cache->count = 0;
+    cache->pool = NULL;
+}
+
+// Move up to half a cache of records from the shared list, adding a slab
+// if it is empty. Called with the lock held.
+void process_pool_refill(ProcessPool *pool, PoolCache *cache) {
+    if (pool->num_free == 0 && pool->num_slabs < pool->max_slabs) {
+        TrackedProcess *slab = (TrackedProcess*)aligned_alloc(64, POOL_SLAB_RECORDS * sizeof(TrackedProcess));
+        if (slab != NULL) {
+            pool->slabs[pool->num_slabs++] = slab;
+            for (int i = POOL_SLAB_RECORDS - 1; i >= 0; i--) pool->free_list[pool->num_free++] = &slab[i];
+        }
+    }
+    int take = pool->num_free < POOL_CACHE_RECORDS / 2 ? pool->num_free : POOL_CACHE_RECORDS / 2;
+    for (int i = 0; i < take; i++) cache->records[cache->count++] = pool->free_list[--pool->num_free];
+    pool->refills++;
+}
+
+// Allocate a zeroed record; NULL once max_records are in use
+TrackedProcess* process_pool_alloc(ProcessPool *pool) {
+    PoolCache *cache = &pool_cache;
+    if (cache->pool != pool) {
+        process_pool_flush_cache();
+        cache->pool = pool;
+    }
+    if (cache->count == 0) {
+        pthread_mutex_lock(&pool->lock);
+        process_pool_refill(pool, cache);
+        pthread_mutex_unlock(&pool->lock);
+        if (cache->count == 0) return NULL;
+    }
+
+    TrackedProcess *tp = cache->records[--cache->count];
+    memset(tp, 0, sizeof(TrackedProcess));
+    __atomic_fetch_add(&pool->in_use, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&pool->allocations, 1, __ATOMIC_RELAXED);
+    return tp;
+}
+
+// Return a record no reader can still hold (see process_pool_retire())
+void process_pool_free(ProcessPool *pool, TrackedProcess *tp) {
+    PoolCache *cache = &pool_cache;
+    if (cache->pool != pool) {
+        process_pool_flush_cache();
+        cache->pool = pool;
+    }
+    sharded_free(tp->shards);
+    tp->shards = NULL;
+    tp->pid = -1;                     // Readers of a freed record would see this
+    __atomic_fetch_sub(&pool->in_use, 1, __ATOMIC_RELAXED);
+
+    if (cache->count == POOL_CACHE_RECORDS) {
+        pthread_mutex_lock(&pool->lock);
+        for (int i = 0; i < POOL_CACHE_RECORDS / 2; i++) {
+            pool->free_list[pool->num_free++] = cache->records[--cache->count];
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    cache->records[cache->count++] = tp;
+}
+
+void process_pool_release(void *object, void *ctx) {
+    process_pool_free((ProcessPool*)ctx, (TrackedProcess*)object);
+}
+
+// Free an unlinked record once concurrent readers are done with it
+void process_pool_retire(ProcessPool *pool, TrackedProcess *tp) {
+    epoch_retire(tp, process_pool_release, pool);
+}
+
+void process_pool_print_stats(ProcessPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    long capacity = (long)pool->num_slabs * POOL_SLAB_RECORDS;
+    printf("  Slabs:        %d of %d (%.1f MB)\n", pool->num_slabs, pool->max_slabs,
+           capacity * sizeof(TrackedProcess) / 1e6);
+    printf("  In use:       %ld of %ld records (%.1f%%)\n", pool->in_use, capacity,
+           capacity ? 100.0 * pool->in_use / capacity : 0.0);
+    printf("  Free:         %d shared, %ld in thread caches\n", pool->num_free,
+           capacity - pool->num_free - pool->in_use);
+    printf("  Retired:      %ld waiting for readers, %ld released\n",
+           __atomic_load_n(&epoch_domain.retired, __ATOMIC_RELAXED),
+           __atomic_load_n(&epoch_domain.released, __ATOMIC_RELAXED));
+    printf("  Allocations:  %ld, %ld cache refills\n", pool->allocations, pool->refills);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Free all slabs. Every thread must have flushed its cache.
+void process_pool_free_all(ProcessPool *pool) {
+    for (int i = 0; i < pool->num_slabs; i++) {
+        for (int r = 0; r < POOL_SLAB_RECORDS; r++) sharded_free(pool->slabs[i][r].shards);
+        free(pool->slabs[i]);
+    }
+    free(pool->slabs);
+    free(pool->free_list);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+// Pid to record map for processes that come and go. One thread creates and
+// removes processes; any thread may look them up or scan them inside an
+// epoch critical section. Removed records and outgrown tables are retired,
+// never freed under a reader.
+typedef struct {
+    TrackedProcess **entries;         // NULL if empty, DIRECTORY_REMOVED if deleted
+    int capacity;                     // Power of two
+    int count;
+    int removed;
+} DirectoryTable;
+
+#define DIRECTORY_REMOVED ((TrackedProcess*)1)
+
+typedef struct {
+    DirectoryTable *table;            // Current table, replaced when it fills up
+    ProcessPool *pool;
+    long creations;
+    long exits;
+} ProcessDirectory;
+
+DirectoryTable* directory_table_create(int capacity) {
+    DirectoryTable *t = (DirectoryTable*)malloc(sizeof(DirectoryTable));
+    if (t == NULL) return NULL;
+    t->entries = (TrackedProcess**)calloc(capacity, sizeof(TrackedProcess*));
+    if (t->entries == NULL) {
+        free(t);
+        return NULL;
+    }
+    t->capacity = capacity;
+    t->count = 0;
+    t->removed = 0;
+    return t;
+}
+
+void directory_table_release(void *object, void *ctx) {
+    (void)ctx;
+    DirectoryTable *t = (DirectoryTable*)object;
+    free(t->entries);
+    free(t);
+}
+
+int directory_init(ProcessDirectory *dir, ProcessPool *pool) {
+    dir->table = directory_table_create(DIRECTORY_MIN_CAPACITY);
+    dir->pool = pool;
+    dir->creations = 0;
+    dir->exits = 0;
+    return dir->table != NULL ? 0 : -1;
+}
+
+// Find a process; the record stays valid until the caller's epoch_exit()
+TrackedProcess* directory_lookup(ProcessDirectory *dir, int pid) {
+    DirectoryTable *t = __atomic_load_n(&dir->table, __ATOMIC_ACQUIRE);
+    int mask = t->capacity - 1;
+    int index = (int)((unsigned)pid * 2654435761u) & mask;
+    for (int probe = 0; probe < t->capacity; probe++) {
+        TrackedProcess *tp = __atomic_load_n(&t->entries[index], __ATOMIC_ACQUIRE);
+        if (tp == NULL) return NULL;
+        if (tp != DIRECTORY_REMOVED && tp->pid == pid) return tp;
+        index = (index + 1) & mask;
+    }
+    return NULL;
+}
+
+// Insert into a table not yet visible to readers, or at an empty or
+// removed entry of the current one
+void directory_table_insert(DirectoryTable *t, TrackedProcess *tp) {
+    int mask = t->capacity - 1;
+    int index = (int)((unsigned)tp->pid * 2654435761u) & mask;
+    while (t->entries[index] != NULL && t->entries[index] != DIRECTORY_REMOVED) index = (index + 1) & mask;
+    if (t->entries[index] == DIRECTORY_REMOVED) t->removed--;
+    __atomic_store_n(&t->entries[index], tp, __ATOMIC_RELEASE);
+    t->count++;
+}
+
+// Copy live entries into a table sized for them and publish it; readers
+// still on the old table finish their scan before it is released
+int directory_rebuild(ProcessDirectory *dir) {
+    DirectoryTable *old = dir->table;
+    int capacity = DIRECTORY_MIN_CAPACITY;
+    while (capacity < 4 * (old->count + 1)) capacity <<= 1;
+    DirectoryTable *t = directory_table_create(capacity);
+    if (t == NULL) return -1;
+    for (int i = 0; i < old->capacity; i++) {
+        TrackedProcess *tp = old->entries[i];
+        if (tp != NULL && tp != DIRECTORY_REMOVED) directory_table_insert(t, tp);
+    }
+    __atomic_store_n(&dir->table, t, __ATOMIC_RELEASE);
+    epoch_retire(old, directory_table_release, NULL);
+    return 0;
+}
+
+// Start tracking a new process. The record is not visible to readers
+// until directory_publish(), so the caller can fill it in first. Returns
+// NULL if the pid is already known or the pool is exhausted. Only the
+// owning thread creates, publishes and removes.
+TrackedProcess* directory_create(ProcessDirectory *dir, int pid) {
+    if (directory_lookup(dir, pid) != NULL) return NULL;
+    TrackedProcess *tp = process_pool_alloc(dir->pool);
+    if (tp == NULL) return NULL;
+    tp->pid = pid;
+    snprintf(tp->window.process_name, sizeof(tp->window.process_name), "pid_%d", pid);
+    return tp;
+}
+
+// Make a record from directory_create() visible to readers. Returns -1,
+// freeing the record, if the directory could not grow.
+int directory_publish(ProcessDirectory *dir, TrackedProcess *tp) {
+    DirectoryTable *t = dir->table;
+    if ((t->count + t->removed + 1) * 4 > t->capacity * 3) {
+        if (directory_rebuild(dir) != 0) {
+            process_pool_free(dir->pool, tp);
+            return -1;
+        }
+        t = dir->table;
+    }
+    directory_table_insert(t, tp);
+    dir->creations++;
+    return 0;
+}
+
+// Stop tracking an exited process; its record is freed once readers are done
+int directory_remove(ProcessDirectory *dir, int pid) {
+    DirectoryTable *t = dir->table;
+    int mask = t->capacity - 1;
+    int index = (int)((unsigned)pid * 2654435761u) & mask;
+    for (int probe = 0; probe < t->capacity; probe++) {
+        TrackedProcess *tp = t->entries[index];
+        if (tp == NULL) return -1;
+        if (tp != DIRECTORY_REMOVED && tp->pid == pid) {
+            __atomic_store_n(&t->entries[index], DIRECTORY_REMOVED, __ATOMIC_RELEASE);
+            t->count--;
+            t->removed++;
+            dir->exits++;
+            process_pool_retire(dir->pool, tp);
+            return 0;
+        }
+        index = (index + 1) & mask;
+    }
+    return -1;
+}
+
+// Free the directory and all records still in it. No reader may be active.
+void directory_free(ProcessDirectory *dir) {
+    DirectoryTable *t = dir->table;
+    for (int i = 0; i < t->capacity; i++) {
+        if (t->entries[i] != NULL && t->entries[i] != DIRECTORY_REMOVED) process_pool_free(dir->pool, t->entries[i]);
+    }
+    directory_table_release(t, NULL);
+    dir->table = NULL;
+}
+
+// ==================== PROCESS TREE AGGREGATION ====================
+
+// Decayed syscall counts of a group of processes
+typedef struct {
+    int syscall_freq[MAX_SYSCALLS];
+    int total_calls;
+    int members;                      // Processes in the group
+    int dirty;                        // Changed since last scored, and in the dirty list
+    double last_score;
+} AggregateWindow;
+
+// A cgroup (container) and the roll-up of its processes
+typedef struct {
+    uint64_t id;                      // Any value, 0 included (the root cgroup)
+    int used;                         // 0 if the entry is free
+    AggregateWindow window;
+} CgroupEntry;
+
+// Roll-ups of process behavior along the process tree and per cgroup. Each
+// recorded call is added to the subtree windows of the process and its
+// ancestors (up to AGG_MAX_DEPTH levels) and to its cgroup's window, so
+// aggregates are kept current without rescanning. Memory is fixed at init:
+// one subtree window per table slot plus AGG_MAX_CGROUPS cgroup windows.
+// Processes are never unlinked, as the table never frees slots.
+typedef struct {
+    ProcessTable *table;
+    int *parents;                     // Parent slot of each slot, -1 if none
+    int *cgroup_of;                   // Cgroup entry of each slot, -1 if none
+    AggregateWindow *subtrees;        // Per slot: the process and its descendants
+    CgroupEntry *cgroups;             // Open addressing on id
+    int *dirty;                       // Changed aggregates: slot, or capacity + cgroup entry
+    int num_dirty;
+    int num_cgroups;
+    long dropped_cgroups;             // Processes whose cgroup did not fit
+} ProcessAggregates;
+
+// A scored aggregate
+typedef struct {
+    int slot;                         // Subtree root slot, -1 for a cgroup
+    uint64_t cgroup;                  // Cgroup id if slot is -1
+    const AggregateWindow *window;
+} AggregateRef;
+
+// Called with every aggregate score
+typedef void (*AggregateCallback)(const AggregateRef *agg, double score, void *ctx);
+
+int aggregates_init(ProcessAggregates *agg, ProcessTable *table) {
+    int capacity = table->capacity;
+    memset(agg, 0, sizeof(ProcessAggregates));
+    agg->parents = (int*)malloc(capacity * sizeof(int));
+    agg->cgroup_of = (int*)malloc(capacity * sizeof(int));
+    agg->subtrees = (AggregateWindow*)calloc(capacity, sizeof(AggregateWindow));
+    agg->cgroups = (CgroupEntry*)calloc(AGG_MAX_CGROUPS, sizeof(CgroupEntry));
+    agg->dirty = (int*)malloc((capacity + AGG_MAX_CGROUPS) * sizeof(int));
+    if (agg->parents == NULL || agg->cgroup_of == NULL || agg->subtrees == NULL ||
+        agg->cgroups == NULL || agg->dirty == NULL) {
+        free(agg->parents);
+        free(agg->cgroup_of);
+        free(agg->subtrees);
+        free(agg->cgroups);
+        free(agg->dirty);
+        return -1;
+    }
+    for (int i = 0; i < capacity; i++) {
+        agg->parents[i] = -1;
+        agg->cgroup_of[i] = -1;
+        agg->subtrees[i].members = 1;
+    }
+    agg->table = table;
+    return 0;
+}
+
+// Memory held by the aggregates, fixed at init
+size_t aggregates_bytes(const ProcessAggregates *agg) {
+    size_t capacity = agg->table->capacity;
+    return capacity * (sizeof(AggregateWindow) + 3 * sizeof(int)) +
+           AGG_MAX_CGROUPS * (sizeof(CgroupEntry) + sizeof(int));
+}
+
+AggregateWindow* aggregates_window(ProcessAggregates *agg, int index) {
+    int capacity = agg->table->capacity;
+    return index < capacity ? &agg->subtrees[index] : &agg->cgroups[index - capacity].window;
+}
+
+// Queue an aggregate for the next scoring pass
+void aggregates_mark(ProcessAggregates *agg, int index, AggregateWindow *w) {
+    if (w->dirty || w->members < AGG_MIN_MEMBERS) return;
+    w->dirty = 1;
+    agg->dirty[agg->num_dirty++] = index;
+}
+
+// Add all counts of one window to another
+void aggregate_merge(AggregateWindow *dst, const AggregateWindow *src) {
+    for (int i = 0; i < MAX_SYSCALLS; i++) {
+        if (src->syscall_freq[i] > 0) {
+            window_add(dst->syscall_freq, &dst->total_calls, i, src->syscall_freq[i], AGG_WINDOW_CALLS);
+        }
+    }
+}
+
+// Make parent_slot the parent of child_slot. The child's subtree joins the
+// ancestors' windows once; later calls are rolled up as they arrive.
+// Returns -1 if the child already has a parent or the link would form a cycle.
+int aggregates_link(ProcessAggregates *agg, int child_slot, int parent_slot) {
+    if (agg->parents[child_slot] >= 0) return -1;
+    int s = parent_slot;
+    for (int depth = 0; s >= 0 && depth < AGG_MAX_DEPTH; depth++) {
+        if (s == child_slot) return -1;
+        s = agg->parents[s];
+    }
+
+    agg->parents[child_slot] = parent_slot;
+    const AggregateWindow *child = &agg->subtrees[child_slot];
+    s = parent_slot;
+    for (int depth = 0; s >= 0 && depth < AGG_MAX_DEPTH; depth++) {
+        AggregateWindow *w = &agg->subtrees[s];
+        w->members += child->members;
+        aggregate_merge(w, child);
+        aggregates_mark(agg, s, w);
+        s = agg->parents[s];
+    }
+    return 0;
+}
+
+// Put a process in a cgroup, claiming an entry for new cgroup ids.
+// Returns -1 if the process already has a cgroup or the table is full.
+int aggregates_set_cgroup(ProcessAggregates *agg, int slot, uint64_t cgroup) {
+    if (agg->cgroup_of[slot] >= 0) return -1;
+    int mask = AGG_MAX_CGROUPS - 1;
+    int index = (int)((cgroup * 0x9E3779B97F4A7C15ull) >> 40) & mask;
+
+    for (int probe = 0; probe < AGG_MAX_CGROUPS; probe++) {
+        CgroupEntry *entry = &agg->cgroups[index];
+        if (!entry->used) {
+            entry->id = cgroup;
+            entry->used = 1;
+            agg->num_cgroups++;
+        }
+        if (entry->id == cgroup) {
+            agg->cgroup_of[slot] = index;
+            entry->window.members++;
+            return 0;
+        }
+        index = (index + 1) & mask;
+    }
+    agg->dropped_cgroups++;
+    return -1;
+}
+
+// Roll up calls of one system call by the process in slot
+void aggregates_record(ProcessAggregates *agg, int slot, int syscall, int count) {
+    int s = slot;
+    for (int depth = 0; s >= 0 && depth <= AGG_MAX_DEPTH; depth++) {
+        AggregateWindow *w = &agg->subtrees[s];
+        window_add(w->syscall_freq, &w->total_calls, syscall, count, AGG_WINDOW_CALLS);
+        aggregates_mark(agg, s, w);
+        s = agg->parents[s];
+    }
+
+    int cgroup = agg->cgroup_of[slot];
+    if (cgroup >= 0) {
+        AggregateWindow *w = &agg->cgroups[cgroup].window;
+        window_add(w->syscall_freq, &w->total_calls, syscall, count, AGG_WINDOW_CALLS);
+        aggregates_mark(agg, agg->table->capacity + cgroup, w);
+    }
+}
+
+// Score the aggregates changed since the last pass. Returns aggregates scored.
+int aggregates_score(ProcessAggregates *agg, const CompactForest *model,
+                     AggregateCallback on_score, void *ctx) {
+    int capacity = agg->table->capacity;
+    int scored = 0;
+    for (int i = 0; i < agg->num_dirty; i++) {
+        int index = agg->dirty[i];
+        AggregateWindow *w = aggregates_window(agg, index);
+        w->dirty = 0;
+        if (w->total_calls < AGG_MIN_CALLS) continue;
+
+        ProcessBehavior features;
+        window_features(w->syscall_freq, w->total_calls, &features);
+        w->last_score = compact_anomaly_score(model, &features);
+        scored++;
+        if (on_score != NULL) {
+            AggregateRef ref = {index < capacity ? index : -1,
+                                index < capacity ? 0 : agg->cgroups[index - capacity].id, w};
+            on_score(&ref, w->last_score, ctx);
+        }
+    }
+    agg->num_dirty = 0;
+    return scored;
+}
+
+void aggregates_free(ProcessAggregates *agg) {
+    free(agg->parents);
+    free(agg->cgroup_of);
+    free(agg->subtrees);
+    free(agg->cgroups);
+    free(agg->dirty);
+    agg->subtrees = NULL;
+    agg->cgroups = NULL;
+}
+
+// ==================== MULTI-RESOLUTION WINDOWS ====================
+
+// Syscall histograms of one process over MR_LEVELS window sizes. Level l
+// is a ring of MR_BUCKETS buckets of MR_BUCKETS^l ticks each. Calls only go
+// into the finest bucket; a bucket is rolled into the level above when it
+// closes, so each window lags by at most one bucket of the level below.
+typedef struct {
+    uint16_t buckets[MR_LEVELS][MR_BUCKETS][MAX_SYSCALLS];  // Saturating counts
+    int sums[MR_LEVELS][MAX_SYSCALLS];      // Each level's buckets added up
+    int totals[MR_LEVELS];
+    long tick;                              // Tick of the current finest bucket
+} MultiWindow;
+
+// Multi-resolution windows for the processes of a table, scored against
+// one forest per window size
+typedef struct {
+    ProcessTable *table;
+    MultiWindow *windows;                   // One per table slot
+    const CompactForest *models[MR_LEVELS]; // Forest trained on windows of each size
+    double thresholds[MR_LEVELS];           // Score that flags a window of each size
+    ProcessBehavior *features;              // Scoring scratch, one entry per slot
+    int *members;
+    double *batch;
+} MultiResolution;
+
+int multires_init(MultiResolution *mr, ProcessTable *table) {
+    mr->windows = (MultiWindow*)calloc(table->capacity, sizeof(MultiWindow));
+    mr->features = (ProcessBehavior*)malloc(table->capacity * sizeof(ProcessBehavior));
+    mr->members = (int*)malloc(table->capacity * sizeof(int));
+    mr->batch = (double*)malloc(table->capacity * sizeof(double));
+    if (mr->windows == NULL || mr->features == NULL || mr->members == NULL || mr->batch == NULL) {
+        free(mr->windows);
+        free(mr->features);
+        free(mr->members);
+        free(mr->batch);
+        return -1;
+    }
+    mr->table = table;
+    for (int level = 0; level < MR_LEVELS; level++) {
+        mr->models[level] = NULL;
+        mr->thresholds[level] = ANOMALY_THRESHOLD;
+    }
+    return 0;
+}
+
+// Ticks spanned by one bucket of a level
+long multires_span(int level) {
+    long span = 1;
+    while (level-- > 0) span *= MR_BUCKETS;
+    return span;
+}
+
+void multires_add_bucket(int *sums, int *total, uint16_t *bucket, const uint16_t *counts) {
+    for (int s = 0; s < MAX_SYSCALLS; s++) {
+        int room = UINT16_MAX - bucket[s];
+        int add = counts[s] < room ? counts[s] : room;
+        bucket[s] += add;
+        sums[s] += add;
+        *total += add;
+    }
+}
+
+void multires_evict_bucket(int *sums, int *total, uint16_t *bucket) {
+    for (int s = 0; s < MAX_SYSCALLS; s++) {
+        sums[s] -= bucket[s];
+        *total -= bucket[s];
+        bucket[s] = 0;
+    }
+}
+
+// Move a window forward to the given tick, rolling closed buckets up and
+// evicting the oldest ones. Idle gaps longer than the widest window reset it.
+void multires_advance(MultiWindow *w, long tick) {
+    if (tick <= w->tick) return;
+    long widest = multires_span(MR_LEVELS);
+    if (tick - w->tick >= widest) {
+        int empty = 1;
+        for (int level = 0; level < MR_LEVELS; level++) empty &= w->totals[level] == 0;
+        if (!empty) memset(w, 0, sizeof(MultiWindow));
+        w->tick = tick;
+        return;
+    }
+
+    long spans[MR_LEVELS + 1];
+    for (int level = 0; level <= MR_LEVELS; level++) spans[level] = multires_span(level);
+
+    for (long t = w->tick; t < tick; t++) {
+        // Roll buckets closing at the end of tick t into the level above
+        for (int level = 0; level + 1 < MR_LEVELS && (t + 1) % spans[level] == 0; level++) {
+            multires_add_bucket(w->sums[level + 1], &w->totals[level + 1],
+                                w->buckets[level + 1][(t / spans[level + 1]) % MR_BUCKETS],
+                                w->buckets[level][(t / spans[level]) % MR_BUCKETS]);
+        }
+        // Open new buckets, evicting the ones they replace
+        for (int level = 0; level < MR_LEVELS && (t + 1) % spans[level] == 0; level++) {
+            multires_evict_bucket(w->sums[level], &w->totals[level],
+                                  w->buckets[level][((t + 1) / spans[level]) % MR_BUCKETS]);
+        }
+    }
+    w->tick = tick;
+}
+
+// Count calls of one system call at the given tick. Calls from before the
+// window's current tick (late events from another collector) are counted
+// at the current tick, as their own bucket may already be rolled up.
+void multires_record(MultiWindow *w, int syscall, int count, long tick) {
+    if (tick < w->tick) {
+        metric_add(METRIC_EVENTS_LATE, count);
+        tick = w->tick;
+    }
+    if (tick != w->tick) multires_advance(w, tick);
+    uint16_t *bucket = &w->buckets[0][tick % MR_BUCKETS][syscall];
+    int add = count < UINT16_MAX - *bucket ? count : UINT16_MAX - *bucket;
+    *bucket += add;
+    w->sums[0][syscall] += add;
+    w->totals[0] += add;
+}
+
+// Feature vector of one window size, scaled like process windows
+void multires_features(const MultiWindow *w, int level, ProcessBehavior *out) {
+    window_features(w->sums[level], w->totals[level], out);
+}
+
+// Score n processes at every window size, in one batched pass per forest.
+// scores[i * MR_LEVELS + level] receives each score, -1 for windows with
+// fewer than MR_MIN_CALLS calls.
+void multires_score(MultiResolution *mr, const int *slots, int n, long tick, double *scores) {
+    ProcessBehavior *features = mr->features;
+    int *members = mr->members;
+    double *batch = mr->batch;
+    for (int i = 0; i < n; i++) multires_advance(&mr->windows[slots[i]], tick);
+
+    for (int level = 0; level < MR_LEVELS; level++) {
+        int count = 0;
+        for (int i = 0; i < n; i++) {
+            const MultiWindow *w = &mr->windows[slots[i]];
+            scores[i * MR_LEVELS + level] = -1.0;
+            if (w->totals[level] < MR_MIN_CALLS) continue;
+            multires_features(w, level, &features[count]);
+            members[count++] = i;
+        }
+        compact_score_batch(mr->models[level], features, count, batch);
+        for (int j = 0; j < count; j++) scores[members[j] * MR_LEVELS + level] = batch[j];
+    }
+}
+
+int compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Set a window size's threshold to the MR_CALIBRATION_QUANTILE score of
+// normal windows. Short windows are noisy, so their forests score normal
+// behavior over a wider range than ANOMALY_THRESHOLD assumes. Returns 0,
+// or -1 with the threshold unchanged if there are no samples or no memory.
+int multires_calibrate(MultiResolution *mr, int level, const ProcessBehavior *normal, int n) {
+    if (n <= 0) return -1;
+    double *scores = (double*)malloc(n * sizeof(double));
+    if (scores == NULL) return -1;
+    compact_score_batch(mr->models[level], normal, n, scores);
+    qsort(scores, n, sizeof(double), compare_double);
+    int index = (int)(MR_CALIBRATION_QUANTILE * (n - 1));
+    mr->thresholds[level] = scores[index];
+    free(scores);
+    return 0;
+}
+
+// Bit l set if the window of size l reached its threshold, given scores
+// from multires_score()
+unsigned int multires_flags(const MultiResolution *mr, const double *scores) {
+    unsigned int flags = 0;
+    for (int level = 0; level < MR_LEVELS; level++) {
+        if (scores[level] >= 0.0 && scores[level] >= mr->thresholds[level]) flags |= 1u << level;
+    }
+    return flags;
+}
+
+void multires_free(MultiResolution *mr) {
+    free(mr->windows);
+    free(mr->features);
+    free(mr->members);
+    free(mr->batch);
+    mr->windows = NULL;
+}
+
+// ==================== REAL-TIME SCORING ====================
+
+// Scoring state for inline enforcement. Everything rt_score() touches is
+// allocated and locked in memory up front: scoring never allocates,
+// does no I/O, takes no locks, and visits at most
+// (MAX_TREE_DEPTH + 1) * NUM_TREES nodes.
+typedef struct {
+    CompactForest model;
+    ProcessTable table;
+    ProcessBehavior scratch;          // Feature vector being scored
+    int locked;                       // 1 if all memory was mlock'd
+} RealtimeScorer;
+
+// Create a real-time scorer from a trained forest
+RealtimeScorer* rt_scorer_create(IsolationForest *forest, int max_procs) {
+    RealtimeScorer *rt = (RealtimeScorer*)calloc(1, sizeof(RealtimeScorer));
+    if (rt == NULL) return NULL;
+
+    if (compact_forest_build(&rt->model, forest) != 0 ||
+        process_table_init(&rt->table, max_procs) != 0) {
+        compact_forest_free(&rt->model);
+        free(rt);
+        return NULL;
+    }
+
+    // mlock also faults the pages in, so first use does not page fault
+    rt->locked =
+        mlock(rt, sizeof(RealtimeScorer)) == 0 &&
+        mlock(rt->model.nodes, rt->model.num_nodes * sizeof(CompactNode)) == 0 &&
+        mlock(rt->table.slots, rt->table.capacity * sizeof(TrackedProcess)) == 0;
+    metrics_register_thread();        // Other threads calling rt_score() register when they start
+    return rt;
+}
+
+// Score one tracked process by slot index
+double rt_score(RealtimeScorer *rt, int slot) {
+    TrackedProcess *tp = &rt->table.slots[slot];
+    process_window_features(tp, &rt->scratch);
+    tp->last_score = compact_anomaly_score(&rt->model, &rt->scratch);
+    return tp->last_score;
+}
+
+// Free real-time scorer memory
+void rt_scorer_free(RealtimeScorer *rt) {
+    munlock(rt->model.nodes, rt->model.num_nodes * sizeof(CompactNode));
+    munlock(rt->table.slots, rt->table.capacity * sizeof(TrackedProcess));
+    compact_forest_free(&rt->model);
+    process_table_free(&rt->table);
+    munlock(rt, sizeof(RealtimeScorer));
+    free(rt);
+}
+
+// ==================== PIPELINE LATENCY ====================
+
+// Pipeline stages with a latency histogram
+typedef enum {
+    STAGE_COLLECTION,                 // Syscall to its batch being handed over
+    STAGE_AGGREGATION,                // Batch handed over to all events counted
+    STAGE_QUEUEING,                   // Waiting in the scoring queue
+    STAGE_SCORING,                    // anomaly score computation
+    STAGE_ALERT,                      // Writing the INTRUSION line
+    STAGE_END_TO_END,                 // Triggering syscall to alert written
+    NUM_STAGES
+} PipelineStage;
+
+const char *stage_names[NUM_STAGES] = {
+    "collection", "aggregation", "queueing", "scoring", "alert", "end-to-end"
+};
+
+// Log-linear (HDR-style) histogram of TSC tick counts: each power of two
+// is split into 2^HIST_SUB_BITS linear buckets, so recorded values keep
+// about 6% precision over the whole 64-bit range. Each histogram has a
+// single writer; readers may run concurrently and see a slightly stale view.
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} LatencyHistogram;
+
+LatencyHistogram pipeline_latency[NUM_STAGES];
+double tsc_per_ns = 1.0;              // Set by tsc_calibrate()
+int tsc_calibrated = 0;
+
+// Cheap timestamp: the CPU's time-stamp counter where available
+uint64_t read_tsc(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return now_ns();
+#endif
+}
+
+// Measure TSC ticks per nanosecond against the monotonic clock
+void tsc_calibrate(void) {
+    struct timespec start, end, pause = {0, 20000000};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t tsc_start = read_tsc();
+    nanosleep(&pause, NULL);
+    uint64_t tsc_end = read_tsc();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    if (ns > 0 && tsc_end > tsc_start) tsc_per_ns = (tsc_end - tsc_start) / ns;
+    tsc_calibrated = 1;
+}
+
+int hist_bucket(uint64_t value) {
+    if (value < HIST_SUB_BUCKETS) return (int)value;
+    int exponent = 63 - __builtin_clzll(value);
+    int sub = (int)(value >> (exponent - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1);
+    return (exponent - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS + sub;
+}
+
+// Largest value that falls in a bucket
+uint64_t hist_bucket_upper(int bucket) {
+    if (bucket < HIST_SUB_BUCKETS) return bucket;
+    int exponent = bucket / HIST_SUB_BUCKETS + HIST_SUB_BITS - 1;
+    uint64_t sub = bucket % HIST_SUB_BUCKETS;
+    int shift = exponent - HIST_SUB_BITS;
+    return ((HIST_SUB_BUCKETS + sub) << shift) + ((1ull << shift) - 1);
+}
+
+// Record a value; relaxed loads and stores keep concurrent readers
+// well-defined without locked instructions on the writer
+void hist_record(LatencyHistogram *h, uint64_t value) {
+    uint64_t *count = &h->counts[hist_bucket(value)];
+    __atomic_store_n(count, __atomic_load_n(count, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->total, __atomic_load_n(&h->total, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    if (value > __atomic_load_n(&h->max, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&h->max, value, __ATOMIC_RELAXED);
+    }
+}
+
+// Record the latency of a stage that started at start_tsc
+void stage_record(PipelineStage stage, uint64_t start_tsc) {
+    uint64_t now = read_tsc();
+    hist_record(&pipeline_latency[stage], now > start_tsc ? now - start_tsc : 0);
+}
+
+// Value at percentile p (0-100), from a snapshot of the counts
+uint64_t hist_percentile(const uint64_t *counts, uint64_t total, double p) {
+    uint64_t target = (uint64_t)ceil(p / 100.0 * total);
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += counts[b];
+        if (seen >= target) return hist_bucket_upper(b);
+    }
+    return 0;
+}
+
+// Print a percentile summary of every stage in microseconds
+void latency_dump(FILE *out) {
+    static uint64_t counts[HIST_BUCKETS];
+    if (!tsc_calibrated) tsc_calibrate();
+    flockfile(out);
+    fprintf(out, "[LATENCY] %-12s %10s %10s %10s %10s %10s (us)\n",
+            "Stage", "Count", "p50", "p99", "p99.9", "Max");
+    for (int stage = 0; stage < NUM_STAGES; stage++) {
+        LatencyHistogram *h = &pipeline_latency[stage];
+        uint64_t total = 0;
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            counts[b] = __atomic_load_n(&h->counts[b], __ATOMIC_RELAXED);
+            total += counts[b];
+        }
+        double to_us = 1.0 / (tsc_per_ns * 1000.0);
+        fprintf(out, "  %-19s %10llu %10.2f %10.2f %10.2f %10.2f\n", stage_names[stage],
+                (unsigned long long)total,
+                hist_percentile(counts, total, 50.0) * to_us,
+                hist_percentile(counts, total, 99.0) * to_us,
+                hist_percentile(counts, total, 99.9) * to_us,
+                __atomic_load_n(&h->max, __ATOMIC_RELAXED) * to_us);
+    }
+    fflush(out);
+    funlockfile(out);
+}
+
+// Background dumper: prints the histograms every period_ms and whenever
+// the process receives SIGUSR1, while the pipeline keeps running
+typedef struct {
+    pthread_t thread;
+    FILE *out;
+    int period_ms;
+    volatile int stop;
+    sigset_t saved_mask;              // Caller's mask, restored by latency_dumper_stop()
+} LatencyDumper;
+
+void* latency_dumper_main(void *arg) {
+    LatencyDumper *dumper = (LatencyDumper*)arg;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    struct timespec period = {dumper->period_ms / 1000, (dumper->period_ms % 1000) * 1000000L};
+
+    while (!dumper->stop) {
+        int sig = sigtimedwait(&set, NULL, &period);
+        if (dumper->stop) break;
+        if (sig == SIGUSR1 || (sig < 0 && errno == EAGAIN)) latency_dump(dumper->out);
+    }
+    return NULL;
+}
+
+// Start the dumper. SIGUSR1 is blocked in the calling thread (and threads
+// it creates later) so that only the dumper receives it, until
+// latency_dumper_stop() on the same thread restores the mask.
+int latency_dumper_start(LatencyDumper *dumper, FILE *out, int period_ms) {
+    if (!tsc_calibrated) tsc_calibrate();
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &set, &dumper->saved_mask);
+
+    dumper->out = out;
+    dumper->period_ms = period_ms;
+    dumper->stop = 0;
+    int status = pthread_create(&dumper->thread, NULL, latency_dumper_main, dumper);
+    if (status != 0) pthread_sigmask(SIG_SETMASK, &dumper->saved_mask, NULL);
+    return status;
+}
+
+void latency_dumper_stop(LatencyDumper *dumper) {
+    dumper->stop = 1;
+    pthread_kill(dumper->thread, SIGUSR1);
+    pthread_join(dumper->thread, NULL);
+
+    // Take a SIGUSR1 still pending for the process, so unblocking it does
+    // not run the default action and end the process
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    struct timespec none = {0, 0};
+    while (sigtimedwait(&set, NULL, &none) == SIGUSR1) {
+    }
+    pthread_sigmask(SIG_SETMASK, &dumper->saved_mask, NULL);
+}
+
+// ==================== SCORING QUEUE ====================
+
+// Order in which queued processes are scored
+typedef enum {
+    QUEUE_ORDER_RISK,                 // Highest priority first
+    QUEUE_ORDER_FIFO                  // Arrival order
+} QueueOrder;
+
+// A process waiting to be scored
+typedef struct {
+    int slot;                         // Process table slot
+    double priority;                  // Estimated risk, higher is more urgent
+    double key;                       // Heap key: priority, or arrival order for FIFO
+    long deadline;                    // Tick by which it should be scored
+    uint64_t event_tsc;               // Time of the syscall that queued it
+    uint64_t enqueue_tsc;             // Time it was queued
+} ScoreItem;
+
+// Binary max-heap of processes waiting to be scored, with counters for
+// queue depth, deadline misses and shed work. Each slot is queued at most
+// once; queuing it again raises its priority in place.
+typedef struct {
+    ScoreItem *items;
+    int *positions;                   // Heap index of each slot, -1 if not queued
+    int depth;
+    int capacity;
+    QueueOrder order;
+    long sequence;                    // Arrival counter for FIFO order
+    long pushed;
+    long scored;
+    long deadline_misses;             // Items scored after their deadline
+    long shed;                        // Items dropped without scoring
+    int peak_depth;
+} ScoringQueue;
+
+// Create a queue for slots 0 .. capacity - 1
+int scoring_queue_init(ScoringQueue *q, int capacity, QueueOrder order) {
+    memset(q, 0, sizeof(ScoringQueue));
+    q->items = (ScoreItem*)malloc(capacity * sizeof(ScoreItem));
+    q->positions = (int*)malloc(capacity * sizeof(int));
+    if (q->items == NULL || q->positions == NULL) {
+        free(q->items);
+        free(q->positions);
+        return -1;
+    }
+    for (int i = 0; i < capacity; i++) q->positions[i] = -1;
+    q->capacity = capacity;
+    q->order = order;
+    return 0;
+}
+
+// Place an item at heap index i and record its position
+void scoring_queue_place(ScoringQueue *q, int i, ScoreItem item) {
+    q->items[i] = item;
+    q->positions[item.slot] = i;
+}
+
+void scoring_queue_sift_up(ScoringQueue *q, int i) {
+    ScoreItem item = q->items[i];
+    while (i > 0 && q->items[(i - 1) / 2].key < item.key) {
+        scoring_queue_place(q, i, q->items[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    scoring_queue_place(q, i, item);
+}
+
+void scoring_queue_sift_down(ScoringQueue *q, int i) {
+    ScoreItem item = q->items[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= q->depth) break;
+        if (child + 1 < q->depth && q->items[child + 1].key > q->items[child].key) child++;
+        if (q->items[child].key <= item.key) break;
+        scoring_queue_place(q, i, q->items[child]);
+        i = child;
+    }
+    scoring_queue_place(q, i, item);
+}
+
+// Queue a slot. If it is already queued, keep the higher priority and the
+// earlier deadline and event time.
+void scoring_queue_push(ScoringQueue *q, int slot, double priority, long deadline, uint64_t event_tsc) {
+    int pos = q->positions[slot];
+    if (pos >= 0) {
+        ScoreItem *item = &q->items[pos];
+        if (deadline < item->deadline) item->deadline = deadline;
+        if (event_tsc < item->event_tsc) item->event_tsc = event_tsc;
+        if (priority > item->priority) {
+            item->priority = priority;
+            if (q->order == QUEUE_ORDER_RISK) item->key = priority;
+            scoring_queue_sift_up(q, pos);
+        }
+        return;
+    }
+
+    ScoreItem item = {slot, priority, 0.0, deadline, event_tsc, read_tsc()};
+    item.key = q->order == QUEUE_ORDER_FIFO ? -(double)q->sequence : priority;
+    q->sequence++;
+    q->items[q->depth] = item;
+    scoring_queue_sift_up(q, q->depth++);
+
+    q->pushed++;
+    if (q->depth > q->peak_depth) q->peak_depth = q->depth;
+}
+
+// Remove the most urgent item; returns 0 if the queue is empty
+int scoring_queue_pop(ScoringQueue *q, ScoreItem *out) {
+    if (q->depth == 0) return 0;
+    *out = q->items[0];
+    q->positions[out->slot] = -1;
+
+    if (--q->depth > 0) {
+        q->items[0] = q->items[q->depth];
+        scoring_queue_sift_down(q, 0);
+    }
+    return 1;
+}
+
+int compare_item_key_desc(const void *a, const void *b) {
+    double x = ((const ScoreItem*)a)->key, y = ((const ScoreItem*)b)->key;
+    return (x < y) - (x > y);
+}
+
+// Drop the least urgent items until at most keep remain. A descending
+// sort leaves a valid heap, so only positions need rebuilding.
+void scoring_queue_shed(ScoringQueue *q, int keep) {
+    if (q->depth <= keep) return;
+    qsort(q->items, q->depth, sizeof(ScoreItem), compare_item_key_desc);
+    for (int i = 0; i < q->depth; i++) {
+        q->positions[q->items[i].slot] = i < keep ? i : -1;
+    }
+    q->shed += q->depth - keep;
+    q->depth = keep;
+}
+
+// Print queue metrics
+void scoring_queue_print_metrics(const ScoringQueue *q) {
+    printf("  Queue Depth:      %d (peak %d)\n", q->depth, q->peak_depth);
+    printf("  Queued:           %ld\n", q->pushed);
+    printf("  Scored:           %ld\n", q->scored);
+    printf("  Deadline Misses:  %ld\n", q->deadline_misses);
+    printf("  Shed:             %ld\n", q->shed);
+}
+
+void scoring_queue_free(ScoringQueue *q) {
+    free(q->items);
+    free(q->positions);
+    q->items = NULL;
+    q->positions = NULL;
+}
+
+// ==================== EVENT-DRIVEN RESCORING ====================
+
+// Conditions that make a process due for immediate rescoring
+typedef struct {
+    unsigned int rare_mask;           // Bit i set if syscall i is rare in training
+    double jump_factor;               // Share growth that triggers a rescore
+    int jump_floor;                   // Smallest share a jump is measured from
+    int min_calls;                    // Calls needed before a window is scored
+    int slow_ticks;                   // Cadence for processes without triggers
+} RescoreTriggers;
+
+// Rescoring scheduler. Triggered processes are queued with a short deadline,
+// all others are swept round-robin once every slow_ticks with a long one.
+// Each tick scores up to score_budget queued processes in priority order;
+// under overload, low-priority work past its deadline and the tail of a
+// queue deeper than shed_depth are shed.
+typedef struct {
+    RescoreTriggers triggers;
+    ProcessTable *table;
+    ScoringQueue queue;
+    int score_budget;                 // Scorings per tick, 0 for unlimited
+    int shed_depth;                   // Queue depth kept after each tick
+    int cursor;                       // Next slot of the slow sweep
+    ProcessAggregates *aggregates;    // Roll-ups fed with every call, NULL if none
+    long tick;
+    long scores;                      // Total scorings performed
+    uint64_t event_tsc;               // Time of the syscall being recorded, 0 if none
+} RescoreScheduler;
+
+// Called with every score the scheduler computes
+typedef void (*ScoreCallback)(TrackedProcess *tp, double score, void *ctx);
+
+// Derive default triggers; syscalls making up less than RARE_SYSCALL_SHARE
+// of all training calls form the rare set
+void rescore_triggers_from_training(RescoreTriggers *triggers, ProcessBehavior *data, int n) {
+    long per_syscall[MAX_SYSCALLS] = {0};
+    long total = 0;
+    for (int i = 0; i < n; i++) {
+        for (int s = 0; s < MAX_SYSCALLS; s++) {
+            per_syscall[s] += data[i].syscall_freq[s];
+            total += data[i].syscall_freq[s];
+        }
+    }
+
+    triggers->rare_mask = 0;
+    for (int s = 0; s < MAX_SYSCALLS; s++) {
+        if (per_syscall[s] < RARE_SYSCALL_SHARE * total) triggers->rare_mask |= 1u << s;
+    }
+    triggers->jump_factor = RESCORE_JUMP_FACTOR;
+    triggers->jump_floor = RESCORE_JUMP_FLOOR;
+    triggers->min_calls = RESCORE_MIN_CALLS;
+    triggers->slow_ticks = RESCORE_SLOW_TICKS;
+}
+
+int rescore_scheduler_init(RescoreScheduler *sched, ProcessTable *table, const RescoreTriggers *triggers) {
+    if (scoring_queue_init(&sched->queue, table->capacity, QUEUE_ORDER_RISK) != 0) return -1;
+    sched->triggers = *triggers;
+    sched->table = table;
+    sched->score_budget = 0;
+    sched->shed_depth = table->capacity;
+    sched->cursor = 0;
+    sched->aggregates = NULL;
+    sched->tick = 1;                  // Tick 0 means "never scored"
+    sched->scores = 0;
+    return 0;
+}
+
+// Scoring priority: how far the window moved since the last scoring, plus
+// a bonus for young processes and a term growing with time since scored
+double rescore_priority(const RescoreScheduler *sched, const TrackedProcess *tp) {
+    ProcessBehavior features;
+    process_window_features(tp, &features);
+
+    int change = 0;
+    for (int i = 0; i < MAX_SYSCALLS; i++) {
+        change += abs(features.syscall_freq[i] - tp->scored_freq[i]);
+    }
+
+    double priority = change;
+    if (sched->tick - tp->first_seen_tick < QUEUE_YOUNG_TICKS) priority += QUEUE_YOUNG_BONUS;
+    long since = sched->tick - (tp->last_scored_tick > 0 ? tp->last_scored_tick : tp->first_seen_tick);
+    return priority + since * QUEUE_STALENESS_WEIGHT;
+}
+
+// Queue a process, or raise its priority if it is already waiting
+void rescore_enqueue(RescoreScheduler *sched, int slot, long deadline_ticks) {
+    TrackedProcess *tp = &sched->table->slots[slot];
+    uint64_t event_tsc = sched->event_tsc ? sched->event_tsc : read_tsc();
+    scoring_queue_push(&sched->queue, slot, rescore_priority(sched, tp), sched->tick + deadline_ticks, event_tsc);
+}
+
+// Record one system call and queue the process if it crossed a trigger:
+// first use of a rare syscall, the syscall's share of the window growing
+// jump_factor times beyond its value at the last scoring, or a new process
+// reaching min_calls. Triggers hit below min_calls fire once it is reached.
+void rescore_on_syscall(RescoreScheduler *sched, int slot, int syscall, int count) {
+    TrackedProcess *tp = &sched->table->slots[slot];
+    const RescoreTriggers *tr = &sched->triggers;
+    process_record_syscall(tp, syscall, count);
+    if (sched->aggregates != NULL) aggregates_record(sched->aggregates, slot, syscall, count);
+    if (tp->first_seen_tick == 0) tp->first_seen_tick = sched->tick;
+
+    unsigned int bit = 1u << syscall;
+    int triggered = tp->trigger_deferred;
+    if ((tr->rare_mask & bit) && !(tp->seen_mask & bit)) triggered = 1;
+    tp->seen_mask |= bit;
+
+    if (tp->window.total_calls < tr->min_calls) {
+        tp->trigger_deferred = triggered;
+        return;
+    }
+    tp->trigger_deferred = 0;
+    // A new process is queued once on reaching min_calls; while it waits,
+    // later calls leave it alone rather than recomputing its priority
+    if (tp->last_scored_tick == 0 && sched->queue.positions[slot] < 0) triggered = 1;
+
+    long current = (long)tp->window.syscall_freq[syscall] * STREAM_WINDOW_CALLS / tp->window.total_calls;
+    int base = tp->scored_freq[syscall] > tr->jump_floor ? tp->scored_freq[syscall] : tr->jump_floor;
+    if (current > tr->jump_factor * base) triggered = 1;
+
+    if (triggered) rescore_enqueue(sched, slot, QUEUE_TRIGGER_DEADLINE);
+}
+
+// Score one process and remember its features for later jump checks
+double rescore_process(RescoreScheduler *sched, TrackedProcess *tp, const CompactForest *model) {
+    ProcessBehavior features;
+    if (tp->shards != NULL) process_merge_shards(tp);
+    process_window_features(tp, &features);
+    memcpy(tp->scored_freq, features.syscall_freq, sizeof(tp->scored_freq));
+    uint64_t start = read_tsc();
+    tp->last_score = compact_anomaly_score(model, &features);
+    stage_record(STAGE_SCORING, start);
+    tp->last_scored_tick = sched->tick;
+    sched->scores++;
+    return tp->last_score;
+}
+
+// Advance one tick: queue the slow-sweep share, then score queued processes
+// in priority order within the budget. Returns processes scored.
+int rescore_run_tick(RescoreScheduler *sched, const CompactForest *model,
+                     ScoreCallback on_score, void *ctx) {
+    ProcessTable *table = sched->table;
+    ScoringQueue *queue = &sched->queue;
+    int slow_ticks = sched->triggers.slow_ticks;
+
+    // Sweep capacity / slow_ticks slots per tick (rounded up) so every
+    // process is revisited once per slow_ticks
+    int sweep = (table->capacity + slow_ticks - 1) / slow_ticks;
+    for (int i = 0; i < sweep; i++) {
+        int slot = sched->cursor;
+        TrackedProcess *tp = &table->slots[slot];
+        sched->cursor = (sched->cursor + 1) & (table->capacity - 1);
+        if (tp->pid == 0) continue;
+        // Calls of hot processes reach the window only through merges, and
+        // bypass the triggers: the sweep is what schedules them
+        if (tp->shards != NULL) process_merge_shards(tp);
+        if (tp->window.total_calls < sched->triggers.min_calls) continue;
+        if (tp->last_scored_tick > 0 && sched->tick - tp->last_scored_tick < slow_ticks) continue;
+        if (queue->positions[slot] >= 0) continue;
+        rescore_enqueue(sched, slot, slow_ticks);
+    }
+
+    int scored = 0;
+    ScoreItem item;
+    while ((sched->score_budget == 0 || scored < sched->score_budget) &&
+           scoring_queue_pop(queue, &item)) {
+        TrackedProcess *tp = &table->slots[item.slot];
+        stage_record(STAGE_QUEUEING, item.enqueue_tsc);
+        tp->scored_event_tsc = item.event_tsc;
+        if (item.deadline < sched->tick) {
+            // Late low-priority work is dropped; the sweep will return to it
+            if (item.priority < QUEUE_SHED_PRIORITY) {
+                queue->shed++;
+                continue;
+            }
+            queue->deadline_misses++;
+        }
+        double score = rescore_process(sched, tp, model);
+        if (on_score) on_score(tp, score, ctx);
+        queue->scored++;
+        scored++;
+    }
+    scoring_queue_shed(queue, sched->shed_depth);
+    metric_set(GAUGE_QUEUE_DEPTH, queue->depth);
+
+    sched->tick++;
+    return scored;
+}
+
+void rescore_scheduler_free(RescoreScheduler *sched) {
+    scoring_queue_free(&sched->queue);
+}
+
+// ==================== SYSCALL SAMPLING ====================
+
+// A system call seen by the collector
+typedef struct {
+    int pid;
+    int syscall;
+    uint64_t tsc;                     // When the call was observed
+} SyscallEvent;
+
+// Events handed from the collector to aggregation in one piece
+typedef struct {
+    const SyscallEvent *events;
+    int count;
+    uint64_t sealed_tsc;              // When the batch was handed over
+} EventBatch;
+
+typedef enum {
+    SAMPLING_GLOBAL,                  // One rate for all processes
+    SAMPLING_PER_PID                  // Busy processes are sampled harder
+} SamplingMode;
+
+// Random 1-in-N sampling of system calls. Gaps between samples are drawn
+// uniformly from 1 .. 2N - 1 (mean N), so periodic call patterns cannot
+// alias with the sampler; each call is kept with long-run probability 1/N
+// and recorded with weight N, making the scaled counts unbiased estimates
+// of the true counts. With a CPU budget set, the rate is retuned each tick.
+typedef struct {
+    SamplingMode mode;
+    int period;                       // Global mode: keep 1 in period calls
+    int per_pid_target;               // Per-PID mode: calls kept per process per tick
+    int max_period;
+    long budget_ns;                   // Collection CPU budget per tick, 0 for a fixed rate
+    int skip;                         // Global mode: calls to drop before the next sample
+    int weight;                       // Global mode: weight of the next sample
+    uint64_t rng;                     // xorshift64 state
+    long tick;
+    long seen;                        // Calls offered to the sampler
+    long kept;                        // Calls recorded
+} SyscallSampler;
+
+void sampler_init(SyscallSampler *sampler, SamplingMode mode, long budget_ns) {
+    memset(sampler, 0, sizeof(SyscallSampler));
+    sampler->mode = mode;
+    sampler->period = 1;
+    sampler->per_pid_target = SAMPLING_PID_TARGET;
+    sampler->max_period = SAMPLING_MAX_PERIOD;
+    sampler->budget_ns = budget_ns;
+    sampler->weight = 1;
+    sampler->rng = 0x9E3779B97F4A7C15ull;
+}
+
+// Calls to drop before the next sample when keeping 1 in period
+int sampler_next_skip(SyscallSampler *sampler, int period) {
+    if (period <= 1) return 0;
+    sampler->rng ^= sampler->rng << 13;
+    sampler->rng ^= sampler->rng >> 7;
+    sampler->rng ^= sampler->rng << 17;
+    return (int)(sampler->rng % (uint64_t)(2 * period - 1));
+}
+
+// Global mode: drop up to max calls the sampler would skip anyway, so a
+// collector can step over them without looking at them. Returns the
+// number dropped.
+int sampler_skip_run(SyscallSampler *sampler, int max) {
+    int n = sampler->skip < max ? sampler->skip : max;
+    sampler->skip -= n;
+    sampler->seen += n;
+    return n;
+}
+
+// Global mode: weight to record the next call with, 0 to drop it
+int sampler_take(SyscallSampler *sampler) {
+    sampler->seen++;
+    if (sampler->skip > 0) {
+        sampler->skip--;
+        return 0;
+    }
+    int weight = sampler->weight;
+    sampler->weight = sampler->period;
+    sampler->skip = sampler_next_skip(sampler, sampler->period);
+    sampler->kept++;
+    return weight;
+}
+
+// Per-PID mode: each process keeps about per_pid_target calls per tick,
+// based on its call count in the previous tick it was active
+int sampler_take_pid(SyscallSampler *sampler, TrackedProcess *tp) {
+    sampler->seen++;
+    if (tp->calls_tick != sampler->tick) {
+        int period = (tp->tick_calls + sampler->per_pid_target - 1) / sampler->per_pid_target;
+        tp->sample_period = period < 1 ? 1 : (period > sampler->max_period ? sampler->max_period : period);
+        tp->tick_calls = 0;
+        tp->calls_tick = sampler->tick;
+    }
+    tp->tick_calls++;
+
+    if (tp->sample_skip > 0) {
+        tp->sample_skip--;
+        return 0;
+    }
+    int weight = tp->sample_weight > 0 ? tp->sample_weight : 1;
+    tp->sample_weight = tp->sample_period;
+    tp->sample_skip = sampler_next_skip(sampler, tp->sample_period);
+    sampler->kept++;
+    return weight;
+}
+
+// End of a collection tick: sample harder if spent_ns exceeded the budget,
+// relax once well under it
+void sampler_end_tick(SyscallSampler *sampler, long spent_ns) {
+    sampler->tick++;
+    if (sampler->budget_ns <= 0) return;
+
+    if (spent_ns > sampler->budget_ns) {
+        if (sampler->period < sampler->max_period) sampler->period *= 2;
+        if (sampler->per_pid_target > 1) sampler->per_pid_target /= 2;
+    } else if (spent_ns < sampler->budget_ns / 2) {
+        if (sampler->period > 1) sampler->period -= (sampler->period + 3) / 4;
+        if (sampler->per_pid_target < SAMPLING_MAX_PID_TARGET) sampler->per_pid_target += (sampler->per_pid_target + 3) / 4;
+    }
+}
+
+// Record a batch of events, through the scheduler's triggers if one is
+// given and sampled if a sampler is given. Returns calls recorded.
+int collect_events(ProcessTable *table, RescoreScheduler *sched, SyscallSampler *sampler,
+                   const EventBatch *batch) {
+    const SyscallEvent *events = batch->events;
+    int recorded = 0, dropped = 0;
+    HIDS_PROBE1(batch__start, batch->count);
+    for (int i = 0; i < batch->count; i++) {
+        int weight = 1;
+        if (sampler != NULL && sampler->mode == SAMPLING_GLOBAL) {
+            i += sampler_skip_run(sampler, batch->count - i);
+            if (i == batch->count) break;
+            weight = sampler_take(sampler);
+        }
+        hist_record(&pipeline_latency[STAGE_COLLECTION],
+                    batch->sealed_tsc > events[i].tsc ? batch->sealed_tsc - events[i].tsc : 0);
+
+        int slot = process_table_slot(table, events[i].pid, 1);
+        if (slot < 0) {
+            dropped++;
+            continue;
+        }
+
+        if (sampler != NULL && sampler->mode == SAMPLING_PER_PID) {
+            weight = sampler_take_pid(sampler, &table->slots[slot]);
+            if (weight == 0) continue;
+        }
+
+        // Hot processes are recorded in this thread's shard and merged into
+        // the window by the scorer, so threads calling sharded_record()
+        // directly can record them too
+        TrackedProcess *tp = &table->slots[slot];
+        if (tp->shards != NULL && sharded_record(tp->shards, events[i].syscall, weight) == 0) {
+            recorded++;
+            continue;
+        }
+
+        if (sched != NULL) {
+            sched->event_tsc = events[i].tsc;
+            rescore_on_syscall(sched, slot, events[i].syscall, weight);
+            sched->event_tsc = 0;
+        } else {
+            process_record_syscall(tp, events[i].syscall, weight);
+        }
+        recorded++;
+    }
+    stage_record(STAGE_AGGREGATION, batch->sealed_tsc);
+    metric_add(METRIC_EVENTS_INGESTED, batch->count);
+    metric_add(METRIC_EVENTS_DROPPED, dropped);
+    metric_add(METRIC_EVENTS_SAMPLED_OUT, batch->count - dropped - recorded);
+    metric_set(GAUGE_TRACKED_PIDS, table->count);
+    HIDS_PROBE2(batch__done, batch->count, recorded);
+    return recorded;
+}
+
+// ==================== CPU BUDGET ====================
+
+// Pipeline stages CPU time is charged to
+typedef enum {
+    BUDGET_COLLECTION,
+    BUDGET_SCORING,
+    BUDGET_TRAINING,
+    NUM_BUDGET_STAGES
+} BudgetStage;
+
+const char *budget_stage_names[NUM_BUDGET_STAGES] = {"Collection", "Scoring", "Training"};
+
+// Keeps the detector's own CPU use under a share of what its cgroup may
+// use. Every BUDGET_WINDOW_MS the process CPU time is compared with the
+// budget: above it the shedding level goes up, under half of it the level
+// comes down. Each level halves the work: the slow rescoring sweep runs
+// half as often, half as many processes are scored per tick, one in twice
+// as many syscalls is sampled (uniformly, with weights scaled to match,
+// so windows stay unbiased), and retraining is paused. Without a sampler
+// every event is still collected.
+typedef struct {
+    double cgroup_cpus;               // CPUs the cgroup may use
+    double budget_cpus;               // Share of them the detector may use
+    int level;                        // Shedding level, 0 when nothing is shed
+    RescoreScheduler *sched;          // Knobs adjusted, either may be NULL
+    SyscallSampler *sampler;
+    int base_slow_ticks;              // Scheduler settings at level 0
+    int base_score_budget;            // 0 for unlimited
+    int base_pid_target;
+    uint64_t window_start_ns;
+    uint64_t window_start_cpu_ns;
+    uint64_t stage_ns[NUM_BUDGET_STAGES];  // Thread CPU charged to each stage
+    double usage;                     // CPUs used in the last window
+    long windows;
+    long shedding_windows;            // Windows ended with level > 0
+    int verbose;                      // Print a line when the level changes
+} CpuBudget;
+
+// CPUs the process's cgroup v2 may use: the tightest cpu.max quota on the
+// path to the root, or the CPUs we may run on when there is none
+double cgroup_cpu_limit(void) {
+    cpu_set_t allowed;
+    double limit = sched_getaffinity(0, sizeof(allowed), &allowed) == 0 ? CPU_COUNT(&allowed) : 1.0;
+
+    char line[512], path[1024];
+    FILE *f = fopen("/proc/self/cgroup", "r");
+    if (f == NULL) return limit;
+    char group[512] = "";
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (strncmp(line, "0::", 3) == 0) {
+            snprintf(group, sizeof(group), "%s", line + 3);
+            group[strcspn(group, "\n")] = '\0';
+        }
+    }
+    fclose(f);
+
+    for (;;) {
+        snprintf(path, sizeof(path), "/sys/fs/cgroup%s/cpu.max", strcmp(group, "/") == 0 ? "" : group);
+        f = fopen(path, "r");
+        if (f != NULL) {
+            char quota[32];
+            long period;
+            if (fscanf(f, "%31s %ld", quota, &period) == 2 && strcmp(quota, "max") != 0 && period > 0) {
+                double cpus = atol(quota) / (double)period;
+                if (cpus < limit) limit = cpus;
+            }
+            fclose(f);
+        }
+        char *slash = strrchr(group, '/');
+        if (slash == NULL || slash == group) break;
+        *slash = '\0';
+    }
+    return limit;
+}
+
+// Budget percent of the cgroup's CPUs, adjusting sched and sampler
+void cpu_budget_init(CpuBudget *b, double percent, RescoreScheduler *sched, SyscallSampler *sampler) {
+    memset(b, 0, sizeof(CpuBudget));
+    b->cgroup_cpus = cgroup_cpu_limit();
+    b->budget_cpus = b->cgroup_cpus * percent / 100.0;
+    b->sched = sched;
+    b->sampler = sampler;
+    if (sched != NULL) {
+        b->base_slow_ticks = sched->triggers.slow_ticks;
+        b->base_score_budget = sched->score_budget;
+    }
+    if (sampler != NULL) b->base_pid_target = sampler->per_pid_target;
+    b->window_start_ns = now_ns();
+    b->window_start_cpu_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+// Thread CPU time, to pass to cpu_budget_charge() when a stage ends
+uint64_t cpu_budget_stage_start(void) {
+    return clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void cpu_budget_charge(CpuBudget *b, BudgetStage stage, uint64_t start) {
+    __atomic_fetch_add(&b->stage_ns[stage], clock_ns(CLOCK_THREAD_CPUTIME_ID) - start, __ATOMIC_RELAXED);
+}
+
+// Set the scheduler and sampler for the current level
+void cpu_budget_apply(CpuBudget *b) {
+    if (b->sched != NULL) {
+        b->sched->triggers.slow_ticks = b->base_slow_ticks << b->level;
+        int base = b->base_score_budget > 0 ? b->base_score_budget : BUDGET_SCORE_BATCH;
+        int batch = base >> b->level;
+        b->sched->score_budget = b->level == 0 ? b->base_score_budget : (batch > 0 ? batch : 1);
+    }
+    if (b->sampler != NULL) {
+        // Deep levels may sample past the sampler's own max_period
+        b->sampler->period = 1 << b->level;
+        int target = b->base_pid_target >> b->level;
+        b->sampler->per_pid_target = target > 0 ? target : 1;
+    }
+    metric_set(GAUGE_SHED_LEVEL, b->level);
+}
+
+// Call often (e.g. every tick); once a window has passed, compare CPU use
+// with the budget and move the shedding level. Returns 1 if it changed.
+int cpu_budget_update(CpuBudget *b) {
+    uint64_t now = now_ns();
+    uint64_t elapsed = now - b->window_start_ns;
+    if (elapsed < BUDGET_WINDOW_MS * 1000000ull) return 0;
+
+    uint64_t cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    b->usage = (double)(cpu - b->window_start_cpu_ns) / elapsed;
+    b->window_start_ns = now;
+    b->window_start_cpu_ns = cpu;
+    b->windows++;
+    metric_set(GAUGE_CPU_MILLICORES, (int64_t)(b->usage * 1000));
+
+    int level = b->level;
+    if (b->usage > b->budget_cpus && level < BUDGET_MAX_LEVEL) level++;
+    else if (b->usage < b->budget_cpus / 2 && level > 0) level--;
+    if (level > 0) b->shedding_windows++;
+    if (level == b->level) return 0;
+
+    if (b->verbose) {
+        printf("[BUDGET] %s: using %.1f%% of a CPU, budget %.1f%%, shedding level %d -> %d\n",
+               level > b->level ? "Shedding work" : "Restoring work", b->usage * 100,
+               b->budget_cpus * 100, b->level, level);
+    }
+    b->level = level;
+    cpu_budget_apply(b);
+    return 1;
+}
+
+// Retraining yields to the pipeline: it only runs while nothing is shed
+int cpu_budget_allow_training(const CpuBudget *b) {
+    return __atomic_load_n(&b->level, __ATOMIC_RELAXED) == 0;
+}
+
+// Run the calling thread (e.g. retraining) under SCHED_IDLE, so it only
+// gets CPU nothing else wants
+int cpu_budget_idle_thread(void) {
+    struct sched_param param = {0};
+    return sched_setscheduler(0, SCHED_IDLE, &param);
+}
+
+void cpu_budget_print(const CpuBudget *b) {
+    uint64_t total = 0;
+    for (int s = 0; s < NUM_BUDGET_STAGES; s++) total += b->stage_ns[s];
+    printf("  Cgroup CPUs:  %.2f, budget %.1f%% of a CPU\n", b->cgroup_cpus, b->budget_cpus * 100);
+    printf("  Windows:      %ld, %ld shedding (level %d now)\n", b->windows, b->shedding_windows, b->level);
+    if (b->sampler != NULL && b->sampler->mode == SAMPLING_GLOBAL) {
+        printf("  Sampling:     1 in %d calls\n", b->sampler->period);
+    }
+    for (int s = 0; s < NUM_BUDGET_STAGES; s++) {
+        printf("  %-12s  %8.1f ms CPU (%.1f%%)\n", budget_stage_names[s], b->stage_ns[s] / 1e6,
+               total ? 100.0 * b->stage_ns[s] / total : 0.0);
+    }
+}
+
+// ==================== RESULT SINK ====================
+
+// One scoring result, fixed size so producers just copy it into a ring
+typedef struct {
+    char process_name[48];
+    double score;
+    int pid;                          // 0 for samples without a process
+    unsigned char predicted;          // 1 if classified as INTRUSION
+    unsigned char ground_truth;       // 1 anomaly, 0 normal, SINK_UNLABELLED if unknown
+    unsigned char pad[2];
+} ResultRecord;
+
+typedef enum {
+    SINK_TEXT,                        // Same columns as detect_intrusions()
+    SINK_JSONL,                       // One JSON object per line
+    SINK_BINARY                       // SINK_BINARY_MAGIC, then raw ResultRecords
+} SinkFormat;
+
+// Single-producer single-consumer ring owned by one scoring thread
+typedef struct {
+    ResultRecord *records;
+    pthread_t owner;
+    int released;                     // Owner is done; the ring can go to another thread
+    uint64_t head __attribute__((aligned(64)));    // Next record to write (producer)
+    uint64_t stalls;                  // Pushes that waited for space
+    uint64_t tail __attribute__((aligned(64)));    // Next record to read (writer)
+} SinkProducer;
+
+// Minimal io_uring (raw syscalls, no liburing) used to overlap the
+// writer's formatting with its writes
+typedef struct {
+    int fd;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+} Uring;
+
+// Results are pushed into per-thread rings and a dedicated writer thread
+// formats them into large buffers, written with write(2) or io_uring
+typedef struct {
+    int fd;
+    SinkFormat format;
+    SinkProducer producers[SINK_MAX_PRODUCERS];
+    int num_producers;
+    pthread_mutex_t register_lock;    // Only taken when a thread registers
+    pthread_t writer;
+    int closing;
+    char *buffers[2];                 // Filled alternately while the other is in flight
+    size_t buffer_len;
+    uint64_t buffer_records;          // Records in the active buffer
+    int active;
+    Uring uring;
+    int use_uring;
+    int uring_busy;                   // A write is in flight
+    size_t inflight_len;
+    uint64_t inflight_records;
+    uint64_t written;                 // Records written out
+    uint64_t bytes_written;
+    uint64_t writes;                  // write(2) calls or io_uring submissions
+} ResultSink;
+
+int uring_setup(Uring *ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(Uring));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) return -1;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        if (ring->sq_ring != MAP_FAILED) munmap(ring->sq_ring, ring->sq_ring_size);
+        if (ring->cq_ring != MAP_FAILED) munmap(ring->cq_ring, ring->cq_ring_size);
+        if (ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqes_size);
+        close(ring->fd);
+        return -1;
+    }
+
+    ring->sq_tail = (unsigned*)((char*)ring->sq_ring + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)((char*)ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)((char*)ring->sq_ring + params.sq_off.array);
+    ring->cq_head = (unsigned*)((char*)ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned*)((char*)ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)((char*)ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)((char*)ring->cq_ring + params.cq_off.cqes);
+    return 0;
+}
+
+// Submit one write at the file's current position
+int uring_submit_write(Uring *ring, int fd, const void *buf, size_t len) {
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = (unsigned)len;
+    sqe->off = (uint64_t)-1;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return (int)syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0);
+}
+
+// Wait for one completion; returns its result (bytes written or -errno)
+int uring_wait(Uring *ring) {
+    unsigned head = *ring->cq_head;
+    while (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+            errno != EINTR) {
+            return -errno;
+        }
+    }
+    int res = ring->cqes[head & *ring->cq_mask].res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return res;
+}
+
+void uring_free(Uring *ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Wait for the in-flight io_uring write, finishing a short write inline
+void sink_wait_inflight(ResultSink *sink) {
+    if (!sink->uring_busy) return;
+    int res = uring_wait(&sink->uring);
+    const char *buf = sink->buffers[1 - sink->active];
+    if (res < 0) res = 0;
+    if ((size_t)res < sink->inflight_len) write_all(sink->fd, buf + res, sink->inflight_len - res);
+    __atomic_store_n(&sink->written, sink->written + sink->inflight_records, __ATOMIC_RELEASE);
+    sink->uring_busy = 0;
+}
+
+// Write out the active buffer
+void sink_flush_buffer(ResultSink *sink) {
+    if (sink->buffer_len == 0) return;
+    sink->writes++;
+    sink->bytes_written += sink->buffer_len;
+
+    if (sink->use_uring) {
+        sink_wait_inflight(sink);
+        sink->inflight_len = sink->buffer_len;
+        sink->inflight_records = sink->buffer_records;
+        if (uring_submit_write(&sink->uring, sink->fd, sink->buffers[sink->active], sink->buffer_len) == 1) {
+            sink->uring_busy = 1;
+            sink->active = 1 - sink->active;
+        } else {
+            write_all(sink->fd, sink->buffers[sink->active], sink->buffer_len);
+            __atomic_store_n(&sink->written, sink->written + sink->buffer_records, __ATOMIC_RELEASE);
+        }
+    } else {
+        write_all(sink->fd, sink->buffers[sink->active], sink->buffer_len);
+        __atomic_store_n(&sink->written, sink->written + sink->buffer_records, __ATOMIC_RELEASE);
+    }
+    sink->buffer_len = 0;
+    sink->buffer_records = 0;
+}
+
+// Append a JSON string, escaping quotes, backslashes and control characters
+size_t json_escape(char *out, const char *in, size_t max_in) {
+    size_t n = 0;
+    for (size_t i = 0; i < max_in && in[i] != '\0'; i++) {
+        unsigned char c = (unsigned char)in[i];
+        if (c == '"' || c == '\\') {
+            out[n++] = '\\';
+            out[n++] = c;
+        } else if (c < 0x20) {
+            n += sprintf(out + n, "\\u%04x", c);
+        } else {
+            out[n++] = c;
+        }
+    }
+    return n;
+}
+
+// Append a string left-aligned in a field of at least width characters,
+// like printf's %-*s
+int format_field(char *out, const char *s, int max_len, int width) {
+    int n = 0;
+    while (n < max_len && s[n] != '\0') {
+        out[n] = s[n];
+        n++;
+    }
+    while (n < width) out[n++] = ' ';
+    return n;
+}
+
+// Append a value with four decimals, like printf's %.4f (halfway cases
+// round away from zero, so the last digit can rarely differ from printf)
+int format_fixed4(char *out, double value) {
+    if (!(value >= 0.0 && value < 1e9)) return sprintf(out, "%.4f", value);
+
+    long scaled = (long)(value * 10000.0 + 0.5);
+    char digits[24];
+    int len = 0;
+    long whole = scaled / 10000;
+    do {
+        digits[len++] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole > 0);
+
+    int n = 0;
+    while (len > 0) out[n++] = digits[--len];
+    out[n++] = '.';
+    long frac = scaled % 10000;
+    for (long div = 1000; div > 0; div /= 10) out[n++] = (char)('0' + frac / div % 10);
+    return n;
+}
+
+// Format one record into the active buffer. Text and JSON are formatted by
+// hand: printf-style formatting would make the writer the bottleneck.
+void sink_format(ResultSink *sink, const ResultRecord *r) {
+    if (sink->buffer_len + SINK_MAX_LINE > SINK_BUFFER_SIZE) sink_flush_buffer(sink);
+    char *out = sink->buffers[sink->active] + sink->buffer_len;
+    const char *truth = r->ground_truth == SINK_UNLABELLED ? "" : (r->ground_truth ? "ANOMALY" : "NORMAL");
+    const char *classification = r->predicted ? "INTRUSION" : "NORMAL";
+    int n = 0;
+
+    switch (sink->format) {
+    case SINK_TEXT: {
+        n = format_field(out, r->process_name, sizeof(r->process_name), 20);
+        out[n++] = ' ';
+        int start = n;
+        n += format_fixed4(out + n, r->score);
+        while (n - start < 15) out[n++] = ' ';
+        out[n++] = ' ';
+        n += format_field(out + n, classification, 15, 15);
+        out[n++] = ' ';
+        n += format_field(out + n, truth, 15, 15);
+        out[n++] = '\n';
+        break;
+    }
+    case SINK_JSONL:
+        memcpy(out, "{\"process\":\"", 12);
+        n = 12;
+        n += json_escape(out + n, r->process_name, sizeof(r->process_name));
+        n += sprintf(out + n, "\",\"pid\":%d,\"score\":", r->pid);
+        n += format_fixed4(out + n, r->score);
+        n += sprintf(out + n, ",\"classification\":\"%s\"", classification);
+        if (r->ground_truth != SINK_UNLABELLED) n += sprintf(out + n, ",\"ground_truth\":\"%s\"", truth);
+        out[n++] = '}';
+        out[n++] = '\n';
+        break;
+    case SINK_BINARY:
+        memcpy(out, r, sizeof(ResultRecord));
+        n = sizeof(ResultRecord);
+        break;
+    }
+    sink->buffer_len += n;
+    sink->buffer_records++;
+}
+
+void* result_sink_writer(void *arg) {
+    ResultSink *sink = (ResultSink*)arg;
+    struct timespec idle = {0, SINK_IDLE_NS};
+
+    for (;;) {
+        int closing = __atomic_load_n(&sink->closing, __ATOMIC_ACQUIRE);
+        int num_producers = __atomic_load_n(&sink->num_producers, __ATOMIC_ACQUIRE);
+        uint64_t consumed = 0;
+
+        for (int i = 0; i < num_producers; i++) {
+            SinkProducer *p = &sink->producers[i];
+            uint64_t head = __atomic_load_n(&p->head, __ATOMIC_ACQUIRE);
+            uint64_t start = p->tail, tail = start;
+            for (; tail < head; tail++) {
+                sink_format(sink, &p->records[tail & (SINK_RING_RECORDS - 1)]);
+                // Hand ring space back in chunks so producers rarely stall
+                if ((tail & 255) == 255) __atomic_store_n(&p->tail, tail + 1, __ATOMIC_RELEASE);
+            }
+            consumed += tail - start;
+            __atomic_store_n(&p->tail, tail, __ATOMIC_RELEASE);
+        }
+
+        if (consumed == 0) {
+            sink_flush_buffer(sink);
+            sink_wait_inflight(sink);
+            if (closing) break;
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+// Open a sink writing to fd; use_uring falls back to write(2) if io_uring
+// is unavailable
+ResultSink* result_sink_open(int fd, SinkFormat format, int use_uring) {
+    ResultSink *sink = (ResultSink*)calloc(1, sizeof(ResultSink));
+    if (sink == NULL) return NULL;
+    sink->fd = fd;
+    sink->format = format;
+    sink->buffers[0] = (char*)malloc(SINK_BUFFER_SIZE);
+    sink->buffers[1] = (char*)malloc(SINK_BUFFER_SIZE);
+    if (sink->buffers[0] == NULL || sink->buffers[1] == NULL) {
+        free(sink->buffers[0]);
+        free(sink->buffers[1]);
+        free(sink);
+        return NULL;
+    }
+    pthread_mutex_init(&sink->register_lock, NULL);
+    sink->use_uring = use_uring && uring_setup(&sink->uring, 4) == 0;
+
+    if (format == SINK_BINARY) {
+        memcpy(sink->buffers[0], SINK_BINARY_MAGIC, 8);
+        uint32_t record_size = sizeof(ResultRecord);
+        memcpy(sink->buffers[0] + 8, &record_size, sizeof(record_size));
+        sink->buffer_len = 8 + sizeof(record_size);
+    }
+
+    if (pthread_create(&sink->writer, NULL, result_sink_writer, sink) != 0) {
+        if (sink->use_uring) uring_free(&sink->uring);
+        pthread_mutex_destroy(&sink->register_lock);
+        free(sink->buffers[0]);
+        free(sink->buffers[1]);
+        free(sink);
+        return NULL;
+    }
+    return sink;
+}
+
+// The calling thread's producer ring, created on first use. A ring given
+// back with result_sink_release_producer() is reused before a new one is
+// added; NULL once SINK_MAX_PRODUCERS rings are in use or allocation fails.
+SinkProducer* result_sink_producer(ResultSink *sink) {
+    pthread_t self = pthread_self();
+    int count = __atomic_load_n(&sink->num_producers, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
+        SinkProducer *p = &sink->producers[i];
+        if (!__atomic_load_n(&p->released, __ATOMIC_ACQUIRE) && pthread_equal(p->owner, self)) return p;
+    }
+
+    pthread_mutex_lock(&sink->register_lock);
+    SinkProducer *p = NULL;
+    for (int i = 0; i < sink->num_producers && p == NULL; i++) {
+        // Records still queued in a released ring are written as usual;
+        // the new owner carries on from its head
+        if (__atomic_load_n(&sink->producers[i].released, __ATOMIC_ACQUIRE)) {
+            p = &sink->producers[i];
+            p->owner = self;
+            p->stalls = 0;
+            __atomic_store_n(&p->released, 0, __ATOMIC_RELEASE);
+        }
+    }
+    if (p == NULL && sink->num_producers < SINK_MAX_PRODUCERS) {
+        p = &sink->producers[sink->num_producers];
+        p->records = (ResultRecord*)malloc(SINK_RING_RECORDS * sizeof(ResultRecord));
+        p->owner = self;
+        if (p->records != NULL) __atomic_store_n(&sink->num_producers, sink->num_producers + 1, __ATOMIC_RELEASE);
+        else p = NULL;
+    }
+    pthread_mutex_unlock(&sink->register_lock);
+    return p;
+}
+
+// Give the calling thread's ring back once it has nothing more to push.
+// Queued records are still written; the ring itself is freed on close.
+void result_sink_release_producer(ResultSink *sink, SinkProducer *p) {
+    pthread_mutex_lock(&sink->register_lock);
+    __atomic_store_n(&p->released, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&sink->register_lock);
+}
+
+// Queue a result; waits only if the writer has fallen a full ring behind
+void result_sink_push(SinkProducer *p, const ResultRecord *record) {
+    uint64_t head = p->head;
+    while (head - __atomic_load_n(&p->tail, __ATOMIC_ACQUIRE) >= SINK_RING_RECORDS) {
+        p->stalls++;
+        sched_yield();
+    }
+    p->records[head & (SINK_RING_RECORDS - 1)] = *record;
+    __atomic_store_n(&p->head, head + 1, __ATOMIC_RELEASE);
+}
+
+// Wait until everything pushed so far has been written
+void result_sink_flush(ResultSink *sink) {
+    uint64_t pushed = 0;
+    int count = __atomic_load_n(&sink->num_producers, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) pushed += __atomic_load_n(&sink->producers[i].head, __ATOMIC_ACQUIRE);
+    while (__atomic_load_n(&sink->written, __ATOMIC_ACQUIRE) < pushed) sched_yield();
+}
+
+// Write everything pushed, stop the writer and free the sink along with
+// every producer ring, released or not
+void result_sink_close(ResultSink *sink) {
+    __atomic_store_n(&sink->closing, 1, __ATOMIC_RELEASE);
+    pthread_join(sink->writer, NULL);
+    if (sink->use_uring) uring_free(&sink->uring);
+    for (int i = 0; i < sink->num_producers; i++) {
+        free(sink->producers[i].records);
+        sink->producers[i].records = NULL;
+        sink->producers[i].released = 1;
+    }
+    sink->num_producers = 0;
+    pthread_mutex_destroy(&sink->register_lock);
+    free(sink->buffers[0]);
+    free(sink->buffers[1]);
+    free(sink);
+}
+
+// ==================== ALERT SUPPRESSION ====================
+
+// Outcome of a score after deduplication and rate limiting
+typedef enum {
+    ALERT_NONE,                       // Nothing to report
+    ALERT_RAISE,                      // Process entered INTRUSION, or got a token after
+                                      // being rate limited: emit an alert
+    ALERT_SUMMARY,                    // Process is still in INTRUSION: emit a summary
+    ALERT_SUPPRESSED                  // Process entered INTRUSION but was rate limited
+} AlertAction;
+
+// Token bucket refilled lazily, one token per refill period
+typedef struct {
+    int tokens;
+    long refill_tick;                 // Tick the next token is earned
+} TokenBucket;
+
+// Alert state of one process, indexed like the process table
+typedef struct {
+    int pid;                          // Process the state belongs to, 0 if never used
+    unsigned char alerting;           // In INTRUSION, with hysteresis
+    unsigned char raised;             // This INTRUSION was reported (not rate limited)
+    TokenBucket bucket;
+    int repeats;                      // Scorings in INTRUSION since the last report
+    int suppressed;                   // Rate-limited alerts since the last report
+    double peak_score;                // Highest score since the last report
+    long reported_tick;               // Tick of the last alert, summary or suppression
+} AlertState;
+
+// Alert budget shared by all processes of one executable
+typedef struct {
+    unsigned int exe_hash;            // 0 if the entry is free
+    TokenBucket bucket;
+} ExecutableLimit;
+
+// Turns per-scoring INTRUSION results into one alert per transition.
+// A process enters INTRUSION at raise_threshold and leaves it below
+// clear_threshold. Alerts are rate limited per process and per executable;
+// processes that stay in INTRUSION get a summary every summary_ticks
+// instead of repeated alerts. All updates are O(1).
+typedef struct {
+    ProcessTable *table;
+    AlertState *states;               // One per process table slot
+    ExecutableLimit *executables;     // Open addressing on exe_hash
+    int exe_capacity;                 // Power of two
+    double raise_threshold;
+    double clear_threshold;
+    int pid_burst, pid_refill_ticks;
+    int exe_burst, exe_refill_ticks;
+    int summary_ticks;
+    long raised;                      // Alerts let through
+    long summaries;
+    long suppressed;                  // Alerts dropped by rate limiting
+    long repeats;                     // Scorings deduplicated while in INTRUSION
+} AlertFilter;
+
+// Create a filter for the processes of a table, with default limits
+int alert_filter_init(AlertFilter *f, ProcessTable *table) {
+    memset(f, 0, sizeof(AlertFilter));
+    f->states = (AlertState*)calloc(table->capacity, sizeof(AlertState));
+    f->executables = (ExecutableLimit*)calloc(table->capacity, sizeof(ExecutableLimit));
+    if (f->states == NULL || f->executables == NULL) {
+        free(f->states);
+        free(f->executables);
+        return -1;
+    }
+    f->table = table;
+    f->exe_capacity = table->capacity;
+    f->raise_threshold = ANOMALY_THRESHOLD;
+    f->clear_threshold = ALERT_CLEAR_THRESHOLD;
+    f->pid_burst = ALERT_PID_BURST;
+    f->pid_refill_ticks = ALERT_PID_REFILL_TICKS;
+    f->exe_burst = ALERT_EXE_BURST;
+    f->exe_refill_ticks = ALERT_EXE_REFILL_TICKS;
+    f->summary_ticks = ALERT_SUMMARY_TICKS;
+    return 0;
+}
+
+// Add the tokens earned since the last refill, up to burst
+void token_bucket_refill(TokenBucket *b, int burst, int refill_ticks, long tick) {
+    if (b->tokens >= burst || tick < b->refill_tick) return;
+    long earned = 1 + (tick - b->refill_tick) / refill_ticks;
+    b->tokens = earned >= burst - b->tokens ? burst : b->tokens + (int)earned;
+    b->refill_tick += earned * refill_ticks;
+}
+
+// Take a token; a full bucket starts its refill period now
+void token_bucket_take(TokenBucket *b, int burst, int refill_ticks, long tick) {
+    if (b->tokens == burst) b->refill_tick = tick + refill_ticks;
+    b->tokens--;
+}
+
+// Rate limit entry of an executable, claimed on first use. Returns NULL for
+// unknown executables (or when the table is full).
+ExecutableLimit* alert_filter_executable(AlertFilter *f, unsigned int exe_hash) {
+    if (exe_hash == 0) return NULL;
+    int mask = f->exe_capacity - 1;
+    int index = (int)(exe_hash * 2654435761u) & mask;
+
+    for (int probe = 0; probe < f->exe_capacity; probe++) {
+        ExecutableLimit *exe = &f->executables[index];
+        if (exe->exe_hash == exe_hash) return exe;
+        if (exe->exe_hash == 0) {
+            exe->exe_hash = exe_hash;
+            exe->bucket.tokens = f->exe_burst;
+            return exe;
+        }
+        index = (index + 1) & mask;
+    }
+    return NULL;
+}
+
+AlertState* alert_filter_state(AlertFilter *f, const TrackedProcess *tp) {
+    return &f->states[tp - f->table->slots];
+}
+
+// Spend a process and executable token on reporting an INTRUSION. Returns
+// 0 if either bucket is empty.
+int alert_filter_take(AlertFilter *f, AlertState *st, const TrackedProcess *tp, long tick) {
+    ExecutableLimit *exe = alert_filter_executable(f, tp->exe_hash);
+    token_bucket_refill(&st->bucket, f->pid_burst, f->pid_refill_ticks, tick);
+    if (exe != NULL) token_bucket_refill(&exe->bucket, f->exe_burst, f->exe_refill_ticks, tick);
+    if (st->bucket.tokens == 0 || (exe != NULL && exe->bucket.tokens == 0)) return 0;
+
+    token_bucket_take(&st->bucket, f->pid_burst, f->pid_refill_ticks, tick);
+    if (exe != NULL) token_bucket_take(&exe->bucket, f->exe_burst, f->exe_refill_ticks, tick);
+    return 1;
+}
+
+// Feed one score of a tracked process through the filter. A rate-limited
+// INTRUSION gets no summaries: it is raised once a token is available, or
+// dropped if the process leaves INTRUSION first.
+AlertAction alert_filter_update(AlertFilter *f, const TrackedProcess *tp, double score, long tick) {
+    AlertState *st = alert_filter_state(f, tp);
+
+    // A slot taken over by another process starts from a clean state
+    if (st->pid != tp->pid) {
+        memset(st, 0, sizeof(AlertState));
+        st->pid = tp->pid;
+        st->bucket.tokens = f->pid_burst;
+    }
+
+    if (st->alerting) {
+        if (score < f->clear_threshold) {
+            st->alerting = 0;
+            return ALERT_NONE;
+        }
+        st->repeats++;
+        f->repeats++;
+        if (score > st->peak_score) st->peak_score = score;
+        if (!st->raised) {
+            if (!alert_filter_take(f, st, tp, tick)) return ALERT_NONE;
+            st->raised = 1;
+            st->reported_tick = tick;
+            st->repeats = 0;
+            st->suppressed = 0;
+            f->raised++;
+            return ALERT_RAISE;
+        }
+        if (tick - st->reported_tick < f->summary_ticks) return ALERT_NONE;
+        st->reported_tick = tick;
+        f->summaries++;
+        return ALERT_SUMMARY;
+    }
+
+    if (score < f->raise_threshold) return ALERT_NONE;
+    st->alerting = 1;
+    st->peak_score = score;
+    st->reported_tick = tick;
+
+    if (!alert_filter_take(f, st, tp, tick)) {
+        st->raised = 0;
+        st->suppressed++;
+        f->suppressed++;
+        metric_add(METRIC_ALERTS_SUPPRESSED, 1);
+        return ALERT_SUPPRESSED;
+    }
+    st->raised = 1;
+    st->repeats = 0;
+    st->suppressed = 0;
+    f->raised++;
+    return ALERT_RAISE;
+}
+
+void alert_filter_print_metrics(const AlertFilter *f) {
+    printf("  Alerts raised:     %ld\n", f->raised);
+    printf("  Summaries:         %ld\n", f->summaries);
+    printf("  Suppressed:        %ld\n", f->suppressed);
+    printf("  Repeats absorbed:  %ld\n", f->repeats);
+}
+
+void alert_filter_free(AlertFilter *f) {
+    free(f->states);
+    free(f->executables);
+    f->states = NULL;
+    f->executables = NULL;
+}
+
+// ==================== CHECKPOINT ====================
+
+#define CHECKPOINT_MAGIC 0x43444948u  // "HIDC"
+#define CHECKPOINT_PAGE 4096          // Section alignment, and unit of holes in the file
+#define CHECKPOINT_ALERTS 1u          // Image has alert states and executable limits
+#define CHECKPOINT_WINDOWS 2u         // Image has multi-resolution windows
+
+// Checkpoint image header. The image holds the detector's arrays exactly
+// as they are in memory, each at a page-aligned offset, so a restore maps
+// the file instead of parsing it. Free slots are zero and become holes in
+// the file. An image is only read by a build with the same struct sizes.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sections;                // CHECKPOINT_* flags
+    uint32_t record_size;             // sizeof(TrackedProcess)
+    uint32_t alert_size;              // sizeof(AlertState)
+    uint32_t window_size;             // sizeof(MultiWindow)
+    int64_t capacity;                 // Process table slots
+    int64_t count;                    // Tracked processes
+    int64_t exe_capacity;             // Executable limit entries
+    int64_t tick;                     // Detector tick the state belongs to
+    uint64_t slots_offset;
+    uint64_t states_offset;
+    uint64_t executables_offset;
+    uint64_t windows_offset;
+    uint64_t size;                    // Image size in bytes
+} CheckpointHeader;
+
+// Periodic checkpoints written by a forked child. The child sees a
+// copy-on-write image of the detector at the fork, so the pipeline only
+// stops for the fork itself.
+typedef struct {
+    char path[256];
+    char *buffer;                     // Write buffer, allocated before any fork
+    pid_t writer;                     // Child writing a checkpoint, 0 if none
+    uint64_t started_ns;
+    double pause_us;                  // Time the last fork stopped the caller
+    double write_ms;                  // Time the last completed checkpoint took
+    long written;                     // Completed checkpoints
+    long failed;
+} Checkpointer;
+
+// Mapping that restored arrays live in, see checkpoint_map()
+typedef struct {
+    char *data;
+    size_t size;
+} CheckpointImage;
+
+int checkpoint_init(Checkpointer *ck, const char *path) {
+    memset(ck, 0, sizeof(Checkpointer));
+    snprintf(ck->path, sizeof(ck->path), "%s", path);
+    ck->buffer = (char*)malloc(CHECKPOINT_BUFFER);
+    return ck->buffer != NULL ? 0 : -1;
+}
+
+uint64_t checkpoint_align(uint64_t offset) {
+    return (offset + CHECKPOINT_PAGE - 1) & ~(uint64_t)(CHECKPOINT_PAGE - 1);
+}
+
+// Buffered writes to a file; all-zero pages are skipped, leaving holes.
+// The first error sticks.
+typedef struct {
+    int fd;
+    char *buffer;
+    size_t used;
+    uint64_t offset;                  // File offset of buffer[0]
+    int error;
+} CheckpointWriter;
+
+int checkpoint_page_is_zero(const char *page, size_t size) {
+    const uint64_t *words = (const uint64_t*)page;
+    uint64_t any = 0;
+    for (size_t i = 0; i < size / 8; i++) any |= words[i];
+    return any == 0;
+}
+
+void checkpoint_flush(CheckpointWriter *w) {
+    for (size_t page = 0; page < w->used && !w->error; page += CHECKPOINT_PAGE) {
+        size_t size = w->used - page < CHECKPOINT_PAGE ? w->used - page : CHECKPOINT_PAGE;
+        if (size == CHECKPOINT_PAGE && checkpoint_page_is_zero(w->buffer + page, size)) continue;
+        size_t done = 0;
+        while (done < size && !w->error) {
+            ssize_t n = pwrite(w->fd, w->buffer + page + done, size - done, w->offset + page + done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) w->error = 1;
+            else done += n;
+        }
+    }
+    w->offset += w->used;
+    w->used = 0;
+}
+
+void checkpoint_put(CheckpointWriter *w, const void *data, size_t size) {
+    const char *bytes = (const char*)data;
+    while (size > 0) {
+        size_t room = CHECKPOINT_BUFFER - w->used;
+        size_t n = size < room ? size : room;
+        if (bytes != NULL) memcpy(w->buffer + w->used, bytes, n);
+        else memset(w->buffer + w->used, 0, n);
+        w->used += n;
+        if (bytes != NULL) bytes += n;
+        size -= n;
+        if (w->used == CHECKPOINT_BUFFER) checkpoint_flush(w);
+    }
+}
+
+// Pad with zeros up to a file offset
+void checkpoint_pad(CheckpointWriter *w, uint64_t offset) {
+    checkpoint_put(w, NULL, offset - (w->offset + w->used));
+}
+
+// Write an image of the process table, and of alerts and mr if not NULL,
+// to path (via a temporary file renamed into place). Counts in hot process
+// shards that were not merged yet are not included. Uses only the given
+// buffer, so it is safe in a child forked from a threaded process.
+int checkpoint_write(const char *path, char *buffer, ProcessTable *table, AlertFilter *alerts,
+                     MultiResolution *mr, long tick) {
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return -1;
+
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CHECKPOINT_MAGIC;
+    header.version = CHECKPOINT_VERSION;
+    header.record_size = sizeof(TrackedProcess);
+    header.alert_size = sizeof(AlertState);
+    header.window_size = sizeof(MultiWindow);
+    header.capacity = table->capacity;
+    header.count = table->count;
+    header.tick = tick;
+    header.slots_offset = CHECKPOINT_PAGE;
+    uint64_t end = checkpoint_align(header.slots_offset + table->capacity * sizeof(TrackedProcess));
+    if (alerts != NULL) {
+        header.sections |= CHECKPOINT_ALERTS;
+        header.exe_capacity = alerts->exe_capacity;
+        header.states_offset = end;
+        header.executables_offset = checkpoint_align(end + table->capacity * sizeof(AlertState));
+        end = checkpoint_align(header.executables_offset + alerts->exe_capacity * sizeof(ExecutableLimit));
+    }
+    if (mr != NULL) {
+        header.sections |= CHECKPOINT_WINDOWS;
+        header.windows_offset = end;
+        end = checkpoint_align(end + table->capacity * sizeof(MultiWindow));
+    }
+    header.size = end;
+
+    CheckpointWriter w = {fd, buffer, 0, 0, 0};
+    checkpoint_put(&w, &header, sizeof(header));
+    checkpoint_pad(&w, header.slots_offset);
+    for (int i = 0; i < table->capacity; i++) {
+        TrackedProcess tp;
+        memcpy(&tp, &table->slots[i], sizeof(tp));
+        tp.shards = NULL;
+        checkpoint_put(&w, &tp, sizeof(tp));
+    }
+    if (alerts != NULL) {
+        checkpoint_pad(&w, header.states_offset);
+        checkpoint_put(&w, alerts->states, table->capacity * sizeof(AlertState));
+        checkpoint_pad(&w, header.executables_offset);
+        checkpoint_put(&w, alerts->executables, alerts->exe_capacity * sizeof(ExecutableLimit));
+    }
+    if (mr != NULL) {
+        checkpoint_pad(&w, header.windows_offset);
+        checkpoint_put(&w, mr->windows, table->capacity * sizeof(MultiWindow));
+    }
+    checkpoint_pad(&w, header.size);
+    checkpoint_flush(&w);
+
+    if (!w.error && ftruncate(fd, header.size) != 0) w.error = 1;
+    if (!w.error && fsync(fd) != 0) w.error = 1;
+    if (close(fd) != 0) w.error = 1;
+    if (w.error || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+// Start a checkpoint in a forked child unless one is still being written.
+// Returns 0 if started, 1 if one is in progress, -1 on error.
+int checkpoint_start(Checkpointer *ck, ProcessTable *table, AlertFilter *alerts,
+                     MultiResolution *mr, long tick) {
+    if (ck->writer != 0) return 1;
+
+    uint64_t start = now_ns();
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        int status = checkpoint_write(ck->path, ck->buffer, table, alerts, mr, tick);
+        _exit(status == 0 ? 0 : 1);
+    }
+    uint64_t end = now_ns();
+    ck->writer = pid;
+    ck->started_ns = start;
+    ck->pause_us = (end - start) / 1e3;
+    metric_set(GAUGE_CHECKPOINT_PAUSE_US, (int64_t)ck->pause_us);
+    return 0;
+}
+
+// Collect the child of a finished checkpoint, waiting for it if wait is
+// set. Returns 1 while it is still running, 0 once it succeeded, -1 if it
+// failed (or none was started).
+int checkpoint_poll(Checkpointer *ck, int wait) {
+    if (ck->writer == 0) return -1;
+    int status;
+    pid_t done;
+    do {
+        done = waitpid(ck->writer, &status, wait ? 0 : WNOHANG);
+    } while (done < 0 && errno == EINTR);
+    if (done == 0) return 1;
+
+    ck->writer = 0;
+    if (done < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        ck->failed++;
+        return -1;
+    }
+    ck->write_ms = (now_ns() - ck->started_ns) / 1e6;
+    ck->written++;
+    metric_add(METRIC_CHECKPOINTS, 1);
+    return 0;
+}
+
+void checkpoint_free(Checkpointer *ck) {
+    if (ck->writer != 0) checkpoint_poll(ck, 1);
+    free(ck->buffer);
+    ck->buffer = NULL;
+}
+
+// A section of bytes at offset lies page-aligned after the header page
+// and ends within the image
+int checkpoint_section_valid(const CheckpointHeader *h, uint64_t offset, uint64_t bytes) {
+    return offset >= CHECKPOINT_PAGE && offset % CHECKPOINT_PAGE == 0 && offset <= h->size &&
+           bytes <= h->size - offset;
+}
+
+// Check a header before anything in the image is trusted: struct sizes of
+// this build, a table size the detector can hold, and every section inside
+// a file of header.size bytes
+int checkpoint_header_valid(const CheckpointHeader *h, uint64_t file_size) {
+    if (h->magic != CHECKPOINT_MAGIC || h->version != CHECKPOINT_VERSION ||
+        h->record_size != sizeof(TrackedProcess) || h->alert_size != sizeof(AlertState) ||
+        h->window_size != sizeof(MultiWindow) || h->size != file_size ||
+        (h->sections & ~(CHECKPOINT_ALERTS | CHECKPOINT_WINDOWS)) != 0) {
+        return 0;
+    }
+    if (h->capacity <= 0 || h->capacity > INT_MAX || (h->capacity & (h->capacity - 1)) != 0 ||
+        h->count < 0 || h->count > h->capacity ||
+        h->exe_capacity != ((h->sections & CHECKPOINT_ALERTS) ? h->capacity : 0)) {
+        return 0;
+    }
+    uint64_t capacity = (uint64_t)h->capacity;
+    if (!checkpoint_section_valid(h, h->slots_offset, capacity * sizeof(TrackedProcess))) return 0;
+    if ((h->sections & CHECKPOINT_ALERTS) &&
+        (!checkpoint_section_valid(h, h->states_offset, capacity * sizeof(AlertState)) ||
+         !checkpoint_section_valid(h, h->executables_offset, capacity * sizeof(ExecutableLimit)))) {
+        return 0;
+    }
+    if ((h->sections & CHECKPOINT_WINDOWS) &&
+        !checkpoint_section_valid(h, h->windows_offset, capacity * sizeof(MultiWindow))) {
+        return 0;
+    }
+    return 1;
+}
+
+// Restore a detector from a checkpoint image. The process table, and the
+// alert filter and windows when both the image and the caller have them,
+// are set up with their arrays in a private mapping of the image: pages
+// are read on first use and copied on first write, so startup does not
+// wait for the whole image. Free them with checkpoint_unmap().
+// Returns the number of processes restored, or -1 (also for an image
+// failing checkpoint_header_valid()).
+long checkpoint_map(const char *path, CheckpointImage *image, ProcessTable *table,
+                    AlertFilter *alerts, MultiResolution *mr, long *tick) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    CheckpointHeader header;
+    struct stat st;
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) || fstat(fd, &st) != 0 ||
+        !checkpoint_header_valid(&header, (uint64_t)st.st_size)) {
+        close(fd);
+        return -1;
+    }
+    char *data = (char*)mmap(NULL, header.size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+
+    table->slots = (TrackedProcess*)(data + header.slots_offset);
+    table->capacity = (int)header.capacity;
+    table->count = (int)header.count;
+    int failed = 0;
+    if (alerts != NULL && (header.sections & CHECKPOINT_ALERTS)) {
+        // Set up a one-slot filter for its defaults, then adopt the image's arrays
+        ProcessTable one = {NULL, 1, 0};
+        failed |= alert_filter_init(alerts, &one);
+        if (!failed) {
+            free(alerts->states);
+            free(alerts->executables);
+            alerts->table = table;
+            alerts->exe_capacity = table->capacity;
+            alerts->states = (AlertState*)(data + header.states_offset);
+            alerts->executables = (ExecutableLimit*)(data + header.executables_offset);
+        }
+    } else if (alerts != NULL) {
+        failed |= alert_filter_init(alerts, table);
+    }
+    if (mr != NULL) {
+        failed |= multires_init(mr, table);
+        if (!failed && (header.sections & CHECKPOINT_WINDOWS)) {
+            free(mr->windows);
+            mr->windows = (MultiWindow*)(data + header.windows_offset);
+        }
+    }
+    image->data = data;
+    image->size = header.size;
+    if (failed) {
+        munmap(data, header.size);
+        return -1;
+    }
+    metric_set(GAUGE_TRACKED_PIDS, table->count);
+    metric_gauge_add(GAUGE_TABLE_BYTES, table->capacity * sizeof(TrackedProcess));
+    *tick = header.tick;
+    return header.count;
+}
+
+// Free a detector restored by checkpoint_map()
+void checkpoint_unmap(CheckpointImage *image, ProcessTable *table, AlertFilter *alerts,
+                      MultiResolution *mr) {
+    metric_gauge_add(GAUGE_TABLE_BYTES, -(int64_t)(table->capacity * sizeof(TrackedProcess)));
+    for (int i = 0; i < table->capacity; i++) sharded_free(table->slots[i].shards);
+    if (alerts != NULL) {
+        char *states = (char*)alerts->states;
+        if (states >= image->data && states < image->data + image->size) {
+            alerts->states = NULL;
+            alerts->executables = NULL;
+        }
+        alert_filter_free(alerts);
+    }
+    if (mr != NULL) {
+        char *windows = (char*)mr->windows;
+        if (windows >= image->data && windows < image->data + image->size) mr->windows = NULL;
+        multires_free(mr);
+    }
+    munmap(image->data, image->size);
+    image->data = NULL;
+    table->slots = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+// ==================== SHARDED TRAINING ====================
+
+// A coordinator trains one forest from workers that each hold a shard of
+// the data. Workers connect and report their shard size; the coordinator
+// gives each a share of the trees proportional to it, so every row has the
+// same chance of landing in a tree's subsample as when one process draws
+// from all the data. Workers train in parallel and send back serialized
+// forests, which are pooled tree by tree with hids_merge().
+//
+// Every worker uses the same subsample size, so each tree's path length is
+// normalized by the same c(subsample_size): the merged score is
+// 2^(-mean path over all trees / c(subsample_size)), exactly the formula
+// for a forest trained in one process.
+
+#define SHARD_MAGIC 0x57444948u       // "HIDW"
+
+// Worker to coordinator, on connecting
+typedef struct {
+    uint32_t magic;
+    uint32_t num_features;
+    uint64_t rows;                    // Rows in the worker's shard
+    uint64_t load_ns;                 // Time spent loading the shard
+} ShardHello;
+
+// Coordinator to worker
+typedef struct {
+    hids_train_options options;       // num_trees may be 0: nothing to do
+} ShardJob;
+
+// Worker to coordinator, followed by size bytes of hids_serialize() output
+typedef struct {
+    int32_t status;                   // hids_status
+    uint32_t reserved;
+    uint64_t size;
+    uint64_t train_ns;
+} ShardResult;
+
+// What the coordinator saw of one worker
+typedef struct {
+    uint64_t rows;
+    uint32_t trees;
+    uint64_t load_ns;
+    uint64_t train_ns;
+} ShardWorkerStats;
+
+// Read exactly len bytes, or fail at EOF
+int read_all(int fd, void *buf, size_t len) {
+    char *p = (char*)buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Rows of MAX_SYSCALLS int32 counts, read until EOF
+int32_t* read_rows(int fd, size_t *count) {
+    size_t capacity = 1024, bytes = 0;
+    char *buffer = (char*)malloc(capacity * MAX_SYSCALLS * sizeof(int32_t));
+    ssize_t r;
+    while (buffer != NULL &&
+           (r = read(fd, buffer + bytes, capacity * MAX_SYSCALLS * sizeof(int32_t) - bytes)) > 0) {
+        bytes += r;
+        if (bytes == capacity * MAX_SYSCALLS * sizeof(int32_t)) {
+            capacity *= 2;
+            char *grown = (char*)realloc(buffer, capacity * MAX_SYSCALLS * sizeof(int32_t));
+            if (grown == NULL) free(buffer);
+            buffer = grown;
+        }
+    }
+    *count = bytes / (MAX_SYSCALLS * sizeof(int32_t));
+    return (int32_t*)buffer;
+}
+
+int shard_socket_address(struct sockaddr_un *addr, const char *path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) return -1;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+// Listen for workers before any are started
+int shard_listen(const char *path) {
+    struct sockaddr_un addr;
+    if (shard_socket_address(&addr, path) != 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SHARD_MAX_WORKERS) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Wait up to SHARD_TIMEOUT_MS for fd to become readable
+int shard_wait(int fd) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    int ready;
+    do {
+        ready = poll(&pfd, 1, SHARD_TIMEOUT_MS);
+    } while (ready < 0 && errno == EINTR);
+    return ready > 0 ? 0 : -1;
+}
+
+// Train a forest of options->num_trees trees across num_workers workers
+// connecting to listen_fd. stats, if not NULL, receives one entry per
+// worker in connection order.
+hids_status shard_coordinate(int listen_fd, int num_workers, const hids_train_options *options,
+                             hids_model **out, ShardWorkerStats *stats) {
+    if (num_workers < 1 || num_workers > SHARD_MAX_WORKERS) return HIDS_ERR_ARGUMENT;
+    int fds[SHARD_MAX_WORKERS];
+    ShardHello hellos[SHARD_MAX_WORKERS];
+    hids_model *models[SHARD_MAX_WORKERS];
+    int connected = 0, num_models = 0;
+    hids_status status = HIDS_OK;
+
+    for (; connected < num_workers; connected++) {
+        if (shard_wait(listen_fd) != 0 || (fds[connected] = accept(listen_fd, NULL, NULL)) < 0) {
+            status = HIDS_ERR_IO;
+            break;
+        }
+        if (shard_wait(fds[connected]) != 0 || read_all(fds[connected], &hellos[connected], sizeof(ShardHello)) != 0 ||
+            hellos[connected].magic != SHARD_MAGIC || hellos[connected].num_features != options->num_features) {
+            close(fds[connected]);
+            status = HIDS_ERR_FORMAT;
+            break;
+        }
+    }
+
+    // A shard smaller than the subsample would train with a smaller
+    // c(subsample_size), which hids_merge() rejects, so it gets no trees
+    uint64_t total_rows = 0;
+    for (int w = 0; status == HIDS_OK && w < num_workers; w++) {
+        if (hellos[w].rows >= options->subsample_size) total_rows += hellos[w].rows;
+    }
+    if (status == HIDS_OK && total_rows == 0) status = HIDS_ERR_ARGUMENT;
+
+    // Trees proportional to shard size, remainders to the largest shards
+    uint32_t trees[SHARD_MAX_WORKERS];
+    uint32_t assigned = 0;
+    for (int w = 0; status == HIDS_OK && w < num_workers; w++) {
+        trees[w] = hellos[w].rows >= options->subsample_size ?
+            (uint32_t)(options->num_trees * hellos[w].rows / total_rows) : 0;
+        assigned += trees[w];
+    }
+    while (status == HIDS_OK && assigned < options->num_trees) {
+        int best = -1;
+        for (int w = 0; w < num_workers; w++) {
+            if (hellos[w].rows < options->subsample_size) continue;
+            if (best < 0 || hellos[w].rows * (trees[best] + 1) > hellos[best].rows * (trees[w] + 1)) best = w;
+        }
+        trees[best]++;
+        assigned++;
+    }
+
+    // Worker seeds all derive from one base, so no two shards draw the same
+    // sequence; without a seed the base comes from the clock
+    uint64_t base_seed = options->seed;
+    if (base_seed == 0) base_seed = (uint64_t)time(NULL) * 0x9E3779B97F4A7C15ull ^ now_ns();
+
+    // Send every job first so workers train in parallel
+    for (int w = 0; status == HIDS_OK && w < num_workers; w++) {
+        ShardJob job = {*options};
+        job.options.num_trees = trees[w];
+        job.options.seed = base_seed + (w + 1) * 0x9E3779B97F4A7C15ull;
+        if (job.options.seed == 0) job.options.seed = 1;
+        if (write_all(fds[w], (const char*)&job, sizeof(job)) != 0) status = HIDS_ERR_IO;
+    }
+    for (int w = 0; status == HIDS_OK && w < num_workers; w++) {
+        ShardResult result;
+        if (shard_wait(fds[w]) != 0 || read_all(fds[w], &result, sizeof(result)) != 0) {
+            status = HIDS_ERR_IO;
+            break;
+        }
+        if (result.status != HIDS_OK) {
+            status = (hids_status)result.status;
+            break;
+        }
+        if (stats != NULL) stats[w] = (ShardWorkerStats){hellos[w].rows, trees[w], hellos[w].load_ns, result.train_ns};
+        if (result.size == 0) continue;
+        void *data = malloc(result.size);
+        if (data == NULL) {
+            status = HIDS_ERR_NOMEM;
+            break;
+        }
+        if (read_all(fds[w], data, result.size) != 0) status = HIDS_ERR_IO;
+        else status = hids_deserialize(data, result.size, &models[num_models]);
+        free(data);
+        if (status == HIDS_OK) num_models++;
+    }
+    for (int w = 0; w < connected; w++) close(fds[w]);
+
+    if (status == HIDS_OK) status = hids_merge((const hids_model *const *)models, num_models, out);
+    for (int m = 0; m < num_models; m++) hids_model_free(models[m]);
+    return status;
+}
+
+// Load a shard of int32 rows, connect to the coordinator and train the
+// trees it asks for
+hids_status shard_work(const char *socket_path, const char *shard_path) {
+    uint64_t start = now_ns();
+    int shard = open(shard_path, O_RDONLY);
+    struct stat st;
+    if (shard < 0 || fstat(shard, &st) != 0) {
+        if (shard >= 0) close(shard);
+        return HIDS_ERR_IO;
+    }
+    size_t n = st.st_size / (MAX_SYSCALLS * sizeof(int32_t));
+    int32_t *rows = (int32_t*)malloc(n > 0 ? n * MAX_SYSCALLS * sizeof(int32_t) : 1);
+    int loaded = rows != NULL && read_all(shard, rows, n * MAX_SYSCALLS * sizeof(int32_t)) == 0;
+    close(shard);
+    if (!loaded) {
+        hids_status status = rows == NULL ? HIDS_ERR_NOMEM : HIDS_ERR_IO;
+        free(rows);
+        return status;
+    }
+    ShardHello hello = {SHARD_MAGIC, MAX_SYSCALLS, n, now_ns() - start};
+
+    // The coordinator may still be starting
+    struct sockaddr_un addr;
+    int fd = -1;
+    if (shard_socket_address(&addr, socket_path) == 0) {
+        for (int waited = 0; waited < SHARD_TIMEOUT_MS; waited += 10) {
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) break;
+            close(fd);
+            fd = -1;
+            usleep(10000);
+        }
+    }
+    ShardJob job;
+    if (fd < 0 || write_all(fd, (const char*)&hello, sizeof(hello)) != 0 || shard_wait(fd) != 0 ||
+        read_all(fd, &job, sizeof(job)) != 0) {
+        if (fd >= 0) close(fd);
+        free(rows);
+        return HIDS_ERR_IO;
+    }
+
+    start = now_ns();
+    hids_model *model = NULL;
+    ShardResult result = {HIDS_OK, 0, 0, 0};
+    if (job.options.num_trees > 0) {
+        result.status = hids_train(rows, n, MAX_SYSCALLS, &job.options, &model);
+    }
+    void *data = NULL;
+    if (model != NULL) {
+        result.size = hids_model_size(model);
+        data = malloc(result.size);
+        if (data == NULL) result.status = HIDS_ERR_NOMEM;
+        else hids_serialize(model, data, result.size);
+    }
+    if (result.status != HIDS_OK) result.size = 0;
+    result.train_ns = now_ns() - start;
+    int sent = write_all(fd, (const char*)&result, sizeof(result)) == 0 &&
+               (result.size == 0 || write_all(fd, (const char*)data, result.size) == 0);
+    close(fd);
+    free(data);
+    hids_model_free(model);
+    free(rows);
+    return !sent ? HIDS_ERR_IO : (hids_status)result.status;
+}
+
+// ==================== INTRUSION DETECTION ====================
+
+// Write an INTRUSION line for a tracked process, recording alert and
+// end-to-end latency
+void emit_alert(FILE *out, const TrackedProcess *tp, double score) {
+    uint64_t start = read_tsc();
+    HIDS_PROBE2(alert, tp->window.process_name, (long)(score * 1e6));
+    fprintf(out, "%-20s %-15.4f %-15s\n", tp->window.process_name, score, "INTRUSION");
+    metric_add(METRIC_ALERTS, 1);
+    stage_record(STAGE_ALERT, start);
+    if (tp->scored_event_tsc) stage_record(STAGE_END_TO_END, tp->scored_event_tsc);
+}
+
+// Write a SUMMARY line for a process that stayed in INTRUSION, and start
+// counting towards the next one
+void emit_alert_summary(FILE *out, const TrackedProcess *tp, AlertState *st) {
+    fprintf(out, "%-20s %-15.4f %-15s repeats=%d suppressed=%d\n", tp->window.process_name,
+            st->peak_score, "SUMMARY", st->repeats, st->suppressed);
+    metric_add(METRIC_ALERT_SUMMARIES, 1);
+    st->repeats = 0;
+    st->suppressed = 0;
+    st->peak_score = 0.0;
+}
+
+// Report a score of a tracked process through an alert filter, writing an
+// INTRUSION or SUMMARY line if the filter lets one through
+AlertAction report_score(AlertFilter *f, FILE *out, TrackedProcess *tp, double score, long tick) {
+    AlertAction action = alert_filter_update(f, tp, score, tick);
+    if (action == ALERT_RAISE) emit_alert(out, tp, score);
+    else if (action == ALERT_SUMMARY) emit_alert_summary(out, tp, alert_filter_state(f, tp));
+    return action;
+}
+
+// Detect intrusions in test data, scored with the autotuner's plan (forest
+// is only used by KERNEL_RECURSIVE and KERNEL_LIBHIDS). Result rows are printed directly, or
+// handed to the sink's writer thread if a sink is given. Scored samples
+// are fed to drift, if given; its report follows the metrics once it has
+// HIDS_DRIFT_MIN_SAMPLES samples.
+void detect_intrusions(IsolationForest *forest, const CompactForest *model, const ScoringPlan *plan,
+                       ProcessBehavior *test_data, int n, ResultSink *sink, hids_drift *drift) {
+    printf("\n[DETECTION] Running intrusion detection...\n");
+    printf("%-20s %-15s %-15s %-15s\n", "Process", "Anomaly Score", "Classification", "Ground Truth");
+    printf("================================================================\n");
+    
+    SinkProducer *results = NULL;
+    if (sink != NULL) {
+        fflush(stdout);
+        results = result_sink_producer(sink);
+        if (results == NULL) {
+            fprintf(stderr, "[SINK] No producer ring available (%d in use or out of memory); "
+                    "printing results directly\n", SINK_MAX_PRODUCERS);
+        }
+    }
+    
+    int true_positive = 0, true_negative = 0;
+    int false_positive = 0, false_negative = 0;
+    double *scores = (double*)malloc(n * sizeof(double));
+    if (scores == NULL) {
+        fprintf(stderr, "[DETECTION] Out of memory\n");
+        return;
+    }
+    score_with_plan(plan, forest, model, test_data, n, scores);
+    if (drift != NULL) hids_drift_observe(drift, &test_data[0].syscall_freq[0], n, BEHAVIOR_STRIDE, scores);
+    
+    for (int i = 0; i < n; i++) {
+        double score = scores[i];
+        int predicted_anomaly = (score >= ANOMALY_THRESHOLD) ? 1 : 0;
+        if (predicted_anomaly) {
+            HIDS_PROBE2(alert, test_data[i].process_name, (long)(score * 1e6));
+            metric_add(METRIC_ALERTS, 1);
+        }
+        
+        // Confusion matrix
+        if (predicted_anomaly == 1 && test_data[i].is_anomaly == 1) true_positive++;
+        else if (predicted_anomaly == 0 && test_data[i].is_anomaly == 0) true_negative++;
+        else if (predicted_anomaly == 1 && test_data[i].is_anomaly == 0) false_positive++;
+        else if (predicted_anomaly == 0 && test_data[i].is_anomaly == 1) false_negative++;
+        
+        if (results != NULL) {
+            ResultRecord record = {{0}, score, 0, (unsigned char)predicted_anomaly,
+                                   (unsigned char)test_data[i].is_anomaly, {0}};
+            strncpy(record.process_name, test_data[i].process_name, sizeof(record.process_name) - 1);
+            result_sink_push(results, &record);
+            continue;
+        }
+        
+        printf("%-20s %-15.4f %-15s %-15s\n", 
+               test_data[i].process_name,
+               score,
+               predicted_anomaly ? "INTRUSION" : "NORMAL",
+               test_data[i].is_anomaly ? "ANOMALY" : "NORMAL");
+    }
+    if (results != NULL) {
+        result_sink_flush(sink);
+        result_sink_release_producer(sink, results);
+    }
+    free(scores);
+    
+    // Performance metrics
+    printf("\n[METRICS] Detection Performance:\n");
+    printf("  True Positives:  %d\n", true_positive);
+    printf("  True Negatives:  %d\n", true_negative);
+    printf("  False Positives: %d\n", false_positive);
+    printf("  False Negatives: %d\n", false_negative);
+    
+    double accuracy = (double)(true_positive + true_negative) / n;
+    printf("  Accuracy: %.2f%%\n", accuracy * 100);
+    
+    if (true_positive + false_positive > 0) {
+        double precision = (double)true_positive / (true_positive + false_positive);
+        printf("  Precision: %.2f%%\n", precision * 100);
+    }
+    
+    if (true_positive + false_negative > 0) {
+        double recall = (double)true_positive / (true_positive + false_negative);
+        printf("  Recall: %.2f%%\n", recall * 100);
+    }
+    
+    // Drift is only reported once enough samples are seen to judge it
+    hids_drift_report report;
+    if (drift != NULL) hids_drift_check(drift, &report);
+    if (drift != NULL && report.samples >= HIDS_DRIFT_MIN_SAMPLES) {
+        printf("\n[DRIFT] %llu samples: score PSI %.3f, worst syscall %u PSI %.3f (mean moved %.1f sd)%s\n",
+               (unsigned long long)report.samples, report.score_psi, report.worst_feature, report.max_feature_psi,
+               report.worst_feature_shift, report.retrain ? ", retrain recommended" : "");
+    }
+}
+
+// ==================== BENCHMARKS ====================
+
+#define BENCH_TRAIN_SIZE 256         // Training samples used by benchmarks
+#define RT_BENCH_PROCS 1000           // Tracked processes in the latency benchmark
+#define RT_BENCH_CALLS 1000000        // Timed rt_score() calls
+#define NOISE_BUFFER_SIZE (64 << 20)  // Memory each noisy neighbor thrashes
+#define SIM_PROCS 1000                // Processes in the simulated syscall stream
+#define SIM_TICKS 3000                // Length of the simulation
+#define SIM_MAX_EVENTS 6              // Most syscalls a process makes per tick
+#define SIM_ATTACK_PERCENT 10         // Processes that turn malicious mid-run
+#define QUEUE_BENCH_BUDGET 6          // Scorings per tick, below the offered load
+#define QUEUE_BENCH_SHED_DEPTH 256    // Queue depth kept under overload
+#define SAMPLING_BENCH_TICKS 1000     // Length of the sampling benchmark
+#define SAMPLING_BENCH_SCORE_TICKS 50 // Every process is scored this often
+#define SAMPLING_BENCH_BUSY_EVERY 10  // One in this many processes is busy
+#define SAMPLING_BENCH_BUSY_EVENTS 60 // Most syscalls a busy process makes per tick
+#define METRICS_BENCH_SAMPLES 10000   // Distinct samples scored in the metrics benchmark
+#define METRICS_BENCH_REPEAT 100      // Passes over the samples per run
+#define METRICS_BENCH_RUNS 3          // Runs with counters on and off
+#define SINK_BENCH_RESULTS 10000000   // Results written per writer
+#define SINK_BENCH_DISTINCT 1024      // Distinct results cycled through
+#define ALERT_BENCH_EXECUTABLES 100   // Executables shared by the simulated processes
+#define ATTRIBUTION_BENCH_SAMPLES 10000  // Distinct samples scored in the attribution benchmark
+#define ATTRIBUTION_BENCH_REPEAT 50   // Passes over the samples per run
+#define ATTRIBUTION_BENCH_RUNS 3      // Runs of each scorer
+#define TREE_BENCH_FAMILIES 100       // Process families: a long-lived parent and its workers
+#define TREE_BENCH_TICKS 1000         // Length of the aggregation simulation
+#define TREE_BENCH_SPAWN_TICKS 5      // A family starts a new worker this often
+#define TREE_BENCH_WORKER_CALLS 30    // Calls a worker makes before going idle
+#define TREE_BENCH_SCALE_PROCS 100000 // Processes in the scale test
+#define TREE_BENCH_SCALE_CGROUPS 1000 // Cgroups in the scale test
+#define TREE_BENCH_SCALE_EVENTS 2000000  // Calls ingested in the scale test
+#define MR_BENCH_TICKS 3000           // Length of the multi-resolution simulation
+#define MR_BENCH_SCORE_TICKS 4        // Every process is scored this often
+#define MR_BENCH_BURST_TICKS 4        // Length of a burst attack
+#define MR_BENCH_BURST_CALLS 12       // Attack calls per tick during a burst
+#define MR_BENCH_SLOW_EVERY 3         // Slow attacks add one attack call every this many ticks
+#define MR_BENCH_EVENTS 4000000       // Calls in the update cost test
+#define MR_BENCH_TRAIN_SNAPSHOTS 8    // Training windows taken from each normal process
+#define SHARD_BENCH_UPDATES 16000000  // Updates per run, split over the writer threads
+#define SHARD_BENCH_SNAPSHOT_US 100   // Interval between the scorer's snapshots
+#define POOL_BENCH_RATE 50000         // Process creations per second
+#define POOL_BENCH_SECONDS 2          // Length of the churn run
+#define POOL_BENCH_LIFETIME_MS 200    // Time from creation to exit
+#define POOL_BENCH_CALLS 20           // Syscalls recorded per new process
+#define POOL_BENCH_SCORERS 2          // Threads scanning and scoring the directory
+#define POOL_BENCH_SCAN_CHUNK 256     // Directory entries scanned per critical section
+#define POOL_BENCH_ALLOCS 1000        // Records allocated per round of the allocator test
+#define POOL_BENCH_ROUNDS 2000        // Rounds of the allocator test
+#define CKPT_BENCH_PROCS 1000000      // Tracked processes in the checkpoint test
+#define CKPT_BENCH_PATH "/tmp/hids_bench.ckpt"
+#define NUMA_BENCH_SAMPLES 65536      // Samples ingested per node and round
+#define NUMA_BENCH_ROUNDS 20          // Rounds per placement
+#define HUGE_BENCH_SAMPLES (1 << 21)  // Dataset size, ~270 MB of ProcessBehavior
+#define HUGE_BENCH_SUBSAMPLE 65536    // Random samples per tree in the build test
+#define HUGE_BENCH_TREES 20           // Trees built per run
+#define BUDGET_BENCH_TICK_MS 10       // Pipeline tick
+#define BUDGET_BENCH_PROCS 20000      // Processes in the synthetic stream
+#define BUDGET_BENCH_EVENTS (1 << 20) // Pre-generated events, replayed in a loop
+#define BUDGET_BENCH_LIGHT 500        // Events per tick before the overload
+#define BUDGET_BENCH_HEAVY 60000      // Events per tick during the overload
+#define BUDGET_BENCH_LIGHT_MS 1000    // Light phase, then overload
+#define BUDGET_BENCH_MS 6000          // Total run time
+#define LIBHIDS_BENCH_MODEL "/tmp/hids_bench_libhids.model"
+#define LIBHIDS_BENCH_SAMPLES 4096    // Samples scored in-process per batch size
+#define LIBHIDS_BENCH_SPAWNS 100      // Subprocess batches per batch size
+#define SHARD_BENCH_ROWS (1 << 22)    // Rows split across the workers' shards
+#define SHARD_BENCH_TREES 1024
+#define SHARD_BENCH_SUBSAMPLE 256
+#define SHARD_BENCH_TEST 4096         // Held-out samples scored by each forest
+#define SHARD_BENCH_PATH "/tmp/hids_bench_shard"  // Socket, and shard files with a suffix
+#define MERGE_BENCH_HOSTS 4
+#define MERGE_BENCH_TEST 8192         // Held-out samples, one in ten anomalous
+#define DRIFT_BENCH_WINDOW 10000      // Samples per drift check
+#define DRIFT_BENCH_WINDOWS 8         // Half steady, then behavior drifts a little more each window
+#define DRIFT_BENCH_ROUNDS 20         // Overhead: timed passes over one window
+
+volatile int bench_stop = 0;          // Tells background load threads to exit
+
+int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Value at percentile p (0-100) of a sorted array
+uint64_t percentile_u64(const uint64_t *sorted, int n, double p) {
+    int index = (int)ceil(p / 100.0 * n) - 1;
+    if (index < 0) index = 0;
+    if (index >= n) index = n - 1;
+    return sorted[index];
+}
+
+// Generate n normal behaviors and train a forest on them
+IsolationForest* bench_train_forest(ProcessBehavior *data, int n) {
+    for (int i = 0; i < n; i++) {
+        char name[50];
+        sprintf(name, "train_proc_%d", i);
+        generate_normal_behavior(&data[i], name);
+    }
+    return train_isolation_forest(data, n);
+}
+
+// Background load: stream through a large buffer to evict caches and
+// compete for memory bandwidth
+void* noisy_neighbor(void *arg) {
+    (void)arg;
+    char *buffer = (char*)malloc(NOISE_BUFFER_SIZE);
+    if (buffer == NULL) return NULL;
+    memset(buffer, 0, NOISE_BUFFER_SIZE);
+
+    while (!bench_stop) {
+        for (size_t i = 0; i < NOISE_BUFFER_SIZE && !bench_stop; i += 64) {
+            buffer[i]++;
+        }
+    }
+    free(buffer);
+    return NULL;
+}
+
+// Worst-case latency of rt_score() with noisy neighbors on every CPU
+int bench_rt_latency(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+
+    RealtimeScorer *rt = rt_scorer_create(forest, RT_BENCH_PROCS);
+    if (rt == NULL) {
+        printf("[RT] Failed to allocate real-time scorer\n");
+        return 1;
+    }
+    printf("\n[RT] Model: %d nodes, worst-case path %d nodes\n",
+           rt->model.num_nodes, (MAX_TREE_DEPTH + 1) * rt->model.num_trees);
+    printf("[RT] Memory %s\n", rt->locked ? "locked" : "NOT locked (raise RLIMIT_MEMLOCK)");
+
+    // Fill the table: 10% of processes follow an anomalous profile
+    int slots[RT_BENCH_PROCS];
+    int mismatches = 0;
+    for (int p = 0; p < RT_BENCH_PROCS; p++) {
+        ProcessBehavior profile;
+        if (p % 10 == 0) generate_anomalous_behavior(&profile, "profile");
+        else generate_normal_behavior(&profile, "profile");
+
+        slots[p] = process_table_slot(&rt->table, 1000 + p, 1);
+        for (int e = 0; e < 2 * STREAM_WINDOW_CALLS; e++) {
+            process_record_syscall(&rt->table.slots[slots[p]], sample_syscall(&profile), 1);
+        }
+
+        // Compact scoring must agree with the pointer-based trees
+        ProcessBehavior features;
+        process_window_features(&rt->table.slots[slots[p]], &features);
+        if (rt_score(rt, slots[p]) != anomaly_score(forest, &features)) mismatches++;
+    }
+    printf("[RT] Score mismatches vs anomaly_score(): %d\n", mismatches);
+
+    uint64_t *latencies = (uint64_t*)malloc(RT_BENCH_CALLS * sizeof(uint64_t));
+    memset(latencies, 0, RT_BENCH_CALLS * sizeof(uint64_t));
+
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int num_noise = num_cpus > 1 ? (int)num_cpus : 2;
+    pthread_t noise[num_noise];
+    bench_stop = 0;
+    for (int i = 0; i < num_noise; i++) {
+        pthread_create(&noise[i], NULL, noisy_neighbor, NULL);
+    }
+
+    double checksum = 0.0;
+    for (int i = 0; i < RT_BENCH_CALLS; i++) {
+        uint64_t start = now_ns();
+        checksum += rt_score(rt, slots[i % RT_BENCH_PROCS]);
+        latencies[i] = now_ns() - start;
+    }
+
+    bench_stop = 1;
+    for (int i = 0; i < num_noise; i++) {
+        pthread_join(noise[i], NULL);
+    }
+
+    qsort(latencies, RT_BENCH_CALLS, sizeof(uint64_t), compare_u64);
+    printf("\n[RT] rt_score() latency over %d calls, %d noisy neighbors (ns):\n",
+           RT_BENCH_CALLS, num_noise);
+    printf("  min:     %llu\n", (unsigned long long)latencies[0]);
+    printf("  p50:     %llu\n", (unsigned long long)percentile_u64(latencies, RT_BENCH_CALLS, 50.0));
+    printf("  p99:     %llu\n", (unsigned long long)percentile_u64(latencies, RT_BENCH_CALLS, 99.0));
+    printf("  p99.99:  %llu\n", (unsigned long long)percentile_u64(latencies, RT_BENCH_CALLS, 99.99));
+    printf("  max:     %llu\n", (unsigned long long)latencies[RT_BENCH_CALLS - 1]);
+    printf("  (checksum %.4f)\n", checksum);
+
+    free(latencies);
+    rt_scorer_free(rt);
+    free_forest(forest);
+    free(training_data);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Simulated process for stream benchmarks
+typedef struct {
+    int pid;
+    ProcessBehavior normal_profile;
+    ProcessBehavior attack_profile;
+    int max_events;                   // Most syscalls made per tick
+    int attack_tick;                  // -1 if the process stays normal
+    int detected_tick;                // First tick flagged at or after attack_tick
+    int false_alerts;                 // Times flagged while behaving normally
+} SimProcess;
+
+// Create n processes; SIM_ATTACK_PERCENT of them turn malicious at a random
+// tick in the middle half of the run
+void sim_init(SimProcess *procs, int n, int num_ticks) {
+    for (int p = 0; p < n; p++) {
+        procs[p].pid = 1000 + p;
+        generate_normal_behavior(&procs[p].normal_profile, "profile");
+        generate_anomalous_behavior(&procs[p].attack_profile, "profile");
+        procs[p].attack_tick = (p % (100 / SIM_ATTACK_PERCENT) == 0) ?
+            num_ticks / 4 + rand() % (num_ticks / 2) : -1;
+        procs[p].max_events = SIM_MAX_EVENTS;
+        procs[p].detected_tick = -1;
+        procs[p].false_alerts = 0;
+    }
+}
+
+// Next system call of a simulated process at the given tick
+int sim_syscall(const SimProcess *sp, int tick) {
+    int attacking = sp->attack_tick >= 0 && tick >= sp->attack_tick;
+    return sample_syscall(attacking ? &sp->attack_profile : &sp->normal_profile);
+}
+
+// Record a score against the simulated ground truth
+void sim_observe(SimProcess *sp, double score, long tick) {
+    if (score < ANOMALY_THRESHOLD) return;
+    if (sp->attack_tick >= 0 && tick >= sp->attack_tick) {
+        if (sp->detected_tick < 0) sp->detected_tick = (int)tick;
+    } else {
+        sp->false_alerts++;
+    }
+}
+
+// Print detection results of a simulation run
+void sim_report(const char *label, SimProcess *procs, int n, long scores, uint64_t ingest_ns, uint64_t score_ns) {
+    int attacks = 0, detected = 0, false_alerts = 0;
+    double total_delay = 0.0;
+    for (int p = 0; p < n; p++) {
+        false_alerts += procs[p].false_alerts;
+        if (procs[p].attack_tick < 0) continue;
+        attacks++;
+        if (procs[p].detected_tick >= 0) {
+            detected++;
+            total_delay += procs[p].detected_tick - procs[p].attack_tick;
+        }
+    }
+    printf("  %-16s %10ld %12.2f %12.2f %9d/%-4d %12.1f %8d\n", label, scores,
+           ingest_ns / 1e6, score_ns / 1e6, detected, attacks,
+           detected ? total_delay / detected : 0.0, false_alerts);
+}
+
+typedef struct {
+    SimProcess *procs;
+    long tick;
+} SimContext;
+
+void sim_on_score(TrackedProcess *tp, double score, void *ctx) {
+    SimContext *sc = (SimContext*)ctx;
+    sim_observe(&sc->procs[tp->pid - 1000], score, sc->tick);
+}
+
+// Feed one tick of simulated syscalls into the table, through the
+// scheduler's triggers if one is given
+void sim_feed_tick(SimProcess *procs, int n, int tick, ProcessTable *table, RescoreScheduler *sched) {
+    for (int p = 0; p < n; p++) {
+        int slot = process_table_slot(table, procs[p].pid, 1);
+        int events = rand() % (procs[p].max_events + 1);
+        for (int e = 0; e < events; e++) {
+            int syscall = sim_syscall(&procs[p], tick);
+            if (sched == NULL) process_record_syscall(&table->slots[slot], syscall, 1);
+            else rescore_on_syscall(sched, slot, syscall, 1);
+        }
+    }
+}
+
+// Event-driven rescoring vs scoring every process at a fixed interval
+int bench_rescore(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    CompactForest model;
+    compact_forest_build(&model, forest);
+
+    RescoreTriggers triggers;
+    rescore_triggers_from_training(&triggers, training_data, BENCH_TRAIN_SIZE);
+    printf("\n[RESCORE] Rare syscalls:");
+    for (int s = 0; s < MAX_SYSCALLS; s++) {
+        if (triggers.rare_mask & (1u << s)) printf(" %d", s);
+    }
+    printf("\n[RESCORE] %d processes, %d ticks, slow cadence %d ticks\n\n",
+           SIM_PROCS, SIM_TICKS, triggers.slow_ticks);
+    printf("  %-16s %10s %12s %12s %14s %12s %8s\n", "Strategy", "Scorings",
+           "Ingest ms", "Score ms", "Detected", "Mean delay", "FP");
+
+    SimProcess *procs = (SimProcess*)malloc(SIM_PROCS * sizeof(SimProcess));
+    unsigned int seed = (unsigned int)rand();
+
+    // Scoring intervals in ticks; 0 selects the event-driven scheduler
+    int intervals[] = {10, 100, 0};
+    int num_strategies = sizeof(intervals) / sizeof(intervals[0]);
+
+    for (int strategy = 0; strategy < num_strategies; strategy++) {
+        int interval = intervals[strategy];
+        // Same seed, so both strategies see the same syscall stream
+        srand(seed);
+        sim_init(procs, SIM_PROCS, SIM_TICKS);
+
+        ProcessTable table;
+        RescoreScheduler sched;
+        process_table_init(&table, SIM_PROCS);
+        rescore_scheduler_init(&sched, &table, &triggers);
+        SimContext ctx = {procs, 0};
+        long scores = 0;
+        uint64_t ingest_ns = 0, score_ns = 0;
+
+        for (int tick = 0; tick < SIM_TICKS; tick++) {
+            uint64_t start = now_ns();
+            sim_feed_tick(procs, SIM_PROCS, tick, &table, interval > 0 ? NULL : &sched);
+            uint64_t mid = now_ns();
+
+            ctx.tick = tick;
+            if (interval > 0 && tick % interval == 0) {
+                for (int i = 0; i < table.capacity; i++) {
+                    TrackedProcess *tp = &table.slots[i];
+                    if (tp->pid == 0 || tp->window.total_calls < RESCORE_MIN_CALLS) continue;
+                    ProcessBehavior features;
+                    process_window_features(tp, &features);
+                    sim_on_score(tp, compact_anomaly_score(&model, &features), &ctx);
+                    scores++;
+                }
+            } else if (interval == 0) {
+                rescore_run_tick(&sched, &model, sim_on_score, &ctx);
+                scores = sched.scores;
+            }
+            uint64_t end = now_ns();
+            ingest_ns += mid - start;
+            score_ns += end - mid;
+        }
+
+        char label[32];
+        if (interval > 0) snprintf(label, sizeof(label), "every %d ticks", interval);
+        else snprintf(label, sizeof(label), "event-driven");
+        sim_report(label, procs, SIM_PROCS, scores, ingest_ns, score_ns);
+        rescore_scheduler_free(&sched);
+        process_table_free(&table);
+    }
+
+    free(procs);
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    return 0;
+}
+
+// Risk-ordered vs FIFO draining of an overloaded scoring queue
+int bench_queue(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    CompactForest model;
+    compact_forest_build(&model, forest);
+    RescoreTriggers triggers;
+    rescore_triggers_from_training(&triggers, training_data, BENCH_TRAIN_SIZE);
+
+    SimProcess *procs = (SimProcess*)malloc(SIM_PROCS * sizeof(SimProcess));
+    unsigned int seed = (unsigned int)rand();
+    printf("\n[QUEUE] %d processes, %d ticks, budget %d scorings/tick\n",
+           SIM_PROCS, SIM_TICKS, QUEUE_BENCH_BUDGET);
+
+    for (int order = QUEUE_ORDER_RISK; order <= QUEUE_ORDER_FIFO; order++) {
+        srand(seed);
+        sim_init(procs, SIM_PROCS, SIM_TICKS);
+
+        ProcessTable table;
+        RescoreScheduler sched;
+        process_table_init(&table, SIM_PROCS);
+        rescore_scheduler_init(&sched, &table, &triggers);
+        sched.queue.order = (QueueOrder)order;
+        sched.score_budget = QUEUE_BENCH_BUDGET;
+        sched.shed_depth = QUEUE_BENCH_SHED_DEPTH;
+        SimContext ctx = {procs, 0};
+        uint64_t ingest_ns = 0, score_ns = 0;
+
+        for (int tick = 0; tick < SIM_TICKS; tick++) {
+            uint64_t start = now_ns();
+            sim_feed_tick(procs, SIM_PROCS, tick, &table, &sched);
+            uint64_t mid = now_ns();
+            ctx.tick = tick;
+            rescore_run_tick(&sched, &model, sim_on_score, &ctx);
+            score_ns += now_ns() - mid;
+            ingest_ns += mid - start;
+        }
+
+        printf("\n[QUEUE] %s order:\n", order == QUEUE_ORDER_RISK ? "Risk" : "FIFO");
+        scoring_queue_print_metrics(&sched.queue);
+        printf("  %-16s %10s %12s %12s %14s %12s %8s\n", "Order", "Scorings",
+               "Ingest ms", "Score ms", "Detected", "Mean delay", "FP");
+        sim_report(order == QUEUE_ORDER_RISK ? "risk" : "fifo", procs, SIM_PROCS,
+                   sched.scores, ingest_ns, score_ns);
+        rescore_scheduler_free(&sched);
+        process_table_free(&table);
+    }
+
+    free(procs);
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    return 0;
+}
+
+// Generate one tick of simulated syscalls as an event batch; returns the
+// number of events written
+int sim_generate_tick(SimProcess *procs, int n, int tick, SyscallEvent *events) {
+    int count = 0;
+    for (int p = 0; p < n; p++) {
+        int calls = rand() % (procs[p].max_events + 1);
+        for (int e = 0; e < calls; e++) {
+            events[count].pid = procs[p].pid;
+            events[count].syscall = sim_syscall(&procs[p], tick);
+            events[count].tsc = read_tsc();
+            count++;
+        }
+    }
+    return count;
+}
+
+typedef struct {
+    double score;
+    int label;                        // 1 if the sample is anomalous
+} ScoredSample;
+
+int compare_scored_sample(const void *a, const void *b) {
+    double x = ((const ScoredSample*)a)->score, y = ((const ScoredSample*)b)->score;
+    return (x > y) - (x < y);
+}
+
+// Area under the ROC curve (Mann-Whitney U, ties get average rank)
+double compute_auc(ScoredSample *samples, int n) {
+    qsort(samples, n, sizeof(ScoredSample), compare_scored_sample);
+    double rank_sum = 0.0;
+    long positives = 0;
+    for (int i = 0; i < n; ) {
+        int j = i;
+        while (j < n && samples[j].score == samples[i].score) j++;
+        double rank = (i + j + 1) / 2.0;
+        for (int k = i; k < j; k++) {
+            if (samples[k].label) {
+                rank_sum += rank;
+                positives++;
+            }
+        }
+        i = j;
+    }
+    long negatives = n - positives;
+    if (positives == 0 || negatives == 0) return 0.5;
+    return (rank_sum - positives * (positives + 1) / 2.0) / ((double)positives * negatives);
+}
+
+// Detection quality vs collection cost for fixed, per-PID and adaptive
+// syscall sampling
+int bench_sampling(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    CompactForest model;
+    compact_forest_build(&model, forest);
+
+    SimProcess *procs = (SimProcess*)malloc(SIM_PROCS * sizeof(SimProcess));
+    SyscallEvent *events = (SyscallEvent*)malloc(SIM_PROCS * SAMPLING_BENCH_BUSY_EVENTS * sizeof(SyscallEvent));
+    int max_samples = SIM_PROCS * (SAMPLING_BENCH_TICKS / SAMPLING_BENCH_SCORE_TICKS + 1);
+    ScoredSample *samples = (ScoredSample*)malloc(max_samples * sizeof(ScoredSample));
+    unsigned int seed = (unsigned int)rand();
+
+    // Configurations: mode, fixed period or per-PID target, budget as a
+    // percentage of the unsampled collection cost (0 for a fixed rate)
+    struct { const char *label; SamplingMode mode; int rate; int budget_percent; } configs[] = {
+        {"all calls", SAMPLING_GLOBAL, 1, 0},
+        {"1 in 4", SAMPLING_GLOBAL, 4, 0},
+        {"1 in 16", SAMPLING_GLOBAL, 16, 0},
+        {"1 in 64", SAMPLING_GLOBAL, 64, 0},
+        {"per-PID 8", SAMPLING_PER_PID, 8, 0},
+        {"per-PID 2", SAMPLING_PER_PID, 2, 0},
+        {"adaptive 50%", SAMPLING_GLOBAL, 1, 50},
+        {"adaptive-PID 50%", SAMPLING_PER_PID, SAMPLING_PID_TARGET, 50},
+    };
+    int num_configs = sizeof(configs) / sizeof(configs[0]);
+    long full_cost_ns = 0;
+
+    printf("\n[SAMPLING] %d processes (%d%% busy), %d ticks, scored every %d ticks\n\n",
+           SIM_PROCS, 100 / SAMPLING_BENCH_BUSY_EVERY, SAMPLING_BENCH_TICKS, SAMPLING_BENCH_SCORE_TICKS);
+    printf("  %-18s %10s %12s %12s %10s %8s\n", "Sampling", "Kept %", "Collect ms",
+           "ns/call", "Period", "AUC");
+
+    for (int c = 0; c < num_configs; c++) {
+        srand(seed);
+        sim_init(procs, SIM_PROCS, SAMPLING_BENCH_TICKS);
+        for (int p = 0; p < SIM_PROCS; p++) {
+            if (p % SAMPLING_BENCH_BUSY_EVERY == SAMPLING_BENCH_BUSY_EVERY / 2) {
+                procs[p].max_events = SAMPLING_BENCH_BUSY_EVENTS;
+            }
+        }
+
+        ProcessTable table;
+        process_table_init(&table, SIM_PROCS);
+        SyscallSampler sampler;
+        long budget_ns = configs[c].budget_percent * full_cost_ns / SAMPLING_BENCH_TICKS / 100;
+        sampler_init(&sampler, configs[c].mode, budget_ns);
+        if (configs[c].mode == SAMPLING_GLOBAL) sampler.period = configs[c].rate;
+        else sampler.per_pid_target = configs[c].rate;
+
+        int num_samples = 0;
+        uint64_t collect_ns = 0;
+        for (int tick = 0; tick < SAMPLING_BENCH_TICKS; tick++) {
+            EventBatch batch = {events, sim_generate_tick(procs, SIM_PROCS, tick, events), read_tsc()};
+            uint64_t start = now_ns();
+            collect_events(&table, NULL, &sampler, &batch);
+            uint64_t spent = now_ns() - start;
+            collect_ns += spent;
+            sampler_end_tick(&sampler, (long)spent);
+
+            if (tick % SAMPLING_BENCH_SCORE_TICKS != SAMPLING_BENCH_SCORE_TICKS - 1) continue;
+            for (int p = 0; p < SIM_PROCS; p++) {
+                int slot = process_table_slot(&table, procs[p].pid, 0);
+                if (slot < 0 || table.slots[slot].window.total_calls < RESCORE_MIN_CALLS) continue;
+                ProcessBehavior features;
+                process_window_features(&table.slots[slot], &features);
+                samples[num_samples].score = compact_anomaly_score(&model, &features);
+                samples[num_samples].label = procs[p].attack_tick >= 0 && tick >= procs[p].attack_tick;
+                num_samples++;
+            }
+        }
+        if (c == 0) full_cost_ns = (long)collect_ns;
+
+        char period[16];
+        if (configs[c].mode == SAMPLING_GLOBAL) snprintf(period, sizeof(period), "%d", sampler.period);
+        else snprintf(period, sizeof(period), "t=%d", sampler.per_pid_target);
+        printf("  %-18s %10.2f %12.2f %12.2f %10s %8.4f\n", configs[c].label,
+               100.0 * sampler.kept / sampler.seen, collect_ns / 1e6,
+               (double)collect_ns / sampler.seen, period, compute_auc(samples, num_samples));
+        process_table_free(&table);
+    }
+
+    free(samples);
+    free(events);
+    free(procs);
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    return 0;
+}
+
+typedef struct {
+    FILE *alerts;
+    long count;
+} AlertContext;
+
+void alert_on_score(TrackedProcess *tp, double score, void *ctx) {
+    AlertContext *ac = (AlertContext*)ctx;
+    if (score < ANOMALY_THRESHOLD) return;
+    emit_alert(ac->alerts, tp, score);
+    ac->count++;
+}
+
+// Per-stage latency of the streaming pipeline, from syscall to alert
+int bench_latency(void) {
+    srand(42);
+    tsc_calibrate();
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    CompactForest model;
+    compact_forest_build(&model, forest);
+    RescoreTriggers triggers;
+    rescore_triggers_from_training(&triggers, training_data, BENCH_TRAIN_SIZE);
+
+    SimProcess *procs = (SimProcess*)malloc(SIM_PROCS * sizeof(SimProcess));
+    SyscallEvent *events = (SyscallEvent*)malloc(SIM_PROCS * SIM_MAX_EVENTS * sizeof(SyscallEvent));
+    sim_init(procs, SIM_PROCS, SIM_TICKS);
+    ProcessTable table;
+    RescoreScheduler sched;
+    process_table_init(&table, SIM_PROCS);
+    rescore_scheduler_init(&sched, &table, &triggers);
+    memset(pipeline_latency, 0, sizeof(pipeline_latency));
+
+    AlertContext ctx = {fopen("/dev/null", "w"), 0};
+    LatencyDumper dumper;
+    latency_dumper_start(&dumper, stdout, LATENCY_DUMP_MS);
+    printf("\n[LATENCY] %d processes, %d ticks, TSC %.3f ticks/ns; send SIGUSR1 to pid %d for a dump\n",
+           SIM_PROCS, SIM_TICKS, tsc_per_ns, (int)getpid());
+
+    for (int tick = 0; tick < SIM_TICKS; tick++) {
+        EventBatch batch = {events, sim_generate_tick(procs, SIM_PROCS, tick, events), read_tsc()};
+        collect_events(&table, &sched, NULL, &batch);
+        rescore_run_tick(&sched, &model, alert_on_score, &ctx);
+    }
+
+    latency_dumper_stop(&dumper);
+    printf("\n[LATENCY] Final, %ld alerts:\n", ctx.count);
+    latency_dump(stdout);
+
+    fclose(ctx.alerts);
+    rescore_scheduler_free(&sched);
+    process_table_free(&table);
+    free(events);
+    free(procs);
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    return 0;
+}
+
+// Scoring throughput with and without counters, then a scrape of the
+// metrics socket
+int bench_metrics(void) {
+    srand(42);
+    metrics_register_thread();
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    CompactForest model;
+    compact_forest_build(&model, forest);
+
+    ProcessBehavior *samples = (ProcessBehavior*)malloc(METRICS_BENCH_SAMPLES * sizeof(ProcessBehavior));
+    for (int i = 0; i < METRICS_BENCH_SAMPLES; i++) {
+        if (i % 10 == 0) generate_anomalous_behavior(&samples[i], "sample");
+        else generate_normal_behavior(&samples[i], "sample");
+    }
+
+    // Alternate runs so frequency scaling and noise hit both sides alike;
+    // keep the best time of each
+    uint64_t best[2] = {UINT64_MAX, UINT64_MAX};
+    double checksum = 0.0;
+    for (int run = 0; run < 2 * METRICS_BENCH_RUNS; run++) {
+        metrics_enabled = run % 2;
+        uint64_t start = now_ns();
+        for (int r = 0; r < METRICS_BENCH_REPEAT; r++) {
+            for (int i = 0; i < METRICS_BENCH_SAMPLES; i++) {
+                checksum += compact_anomaly_score(&model, &samples[i]);
+            }
+        }
+        uint64_t elapsed = now_ns() - start;
+        if (elapsed < best[run % 2]) best[run % 2] = elapsed;
+    }
+    metrics_enabled = 1;
+
+    long scores = (long)METRICS_BENCH_SAMPLES * METRICS_BENCH_REPEAT;
+    printf("\n[METRICS] %ld scores per run, best of %d runs:\n", scores, METRICS_BENCH_RUNS);
+    printf("  Counters off: %8.2f ns/score (%.2fM scores/s)\n", (double)best[0] / scores, scores * 1e3 / best[0]);
+    printf("  Counters on:  %8.2f ns/score (%.2fM scores/s)\n", (double)best[1] / scores, scores * 1e3 / best[1]);
+    printf("  Overhead:     %8.2f%%\n", 100.0 * ((double)best[1] - best[0]) / best[0]);
+    printf("  (checksum %.4f)\n", checksum);
+
+    char path[108];
+    snprintf(path, sizeof(path), "/tmp/hids-metrics-%d.sock", (int)getpid());
+    MetricsServer server;
+    if (metrics_server_start(&server, path) != 0) {
+        printf("[METRICS] Could not listen on %s\n", path);
+    } else {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+            const char *request = "GET /metrics HTTP/1.0\r\n\r\n";
+            if (write(fd, request, strlen(request)) > 0) {
+                printf("\n[METRICS] Scrape of %s:\n", path);
+                char buffer[4096];
+                ssize_t n;
+                while ((n = read(fd, buffer, sizeof(buffer))) > 0) fwrite(buffer, 1, n, stdout);
+            }
+        }
+        close(fd);
+        metrics_server_stop(&server);
+    }
+
+    free(samples);
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    return 0;
+}
+
+// Writing results with fprintf on the scoring thread vs the async sink
+int bench_sink(void) {
+    srand(42);
+    ResultRecord *records = (ResultRecord*)calloc(SINK_BENCH_DISTINCT, sizeof(ResultRecord));
+    for (int i = 0; i < SINK_BENCH_DISTINCT; i++) {
+        snprintf(records[i].process_name, sizeof(records[i].process_name), "test_proc_%d", i);
+        records[i].score = 0.4 + (rand() % 3000) / 10000.0;
+        records[i].predicted = records[i].score >= ANOMALY_THRESHOLD;
+        records[i].ground_truth = i % 10 == 0;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/hids-sink-%d.out", (int)getpid());
+    printf("\n[SINK] Writing %d results to %s\n\n", SINK_BENCH_RESULTS, path);
+    printf("  %-18s %14s %12s %10s %10s %8s\n", "Writer", "Scoring ns/op", "Total ms", "MB", "Writes", "Stalls");
+
+    // fprintf on the scoring thread, as detect_intrusions() does
+    FILE *out = fopen(path, "w");
+    uint64_t start = now_ns();
+    for (int i = 0; i < SINK_BENCH_RESULTS; i++) {
+        const ResultRecord *r = &records[i % SINK_BENCH_DISTINCT];
+        fprintf(out, "%-20s %-15.4f %-15s %-15s\n", r->process_name, r->score,
+                r->predicted ? "INTRUSION" : "NORMAL", r->ground_truth ? "ANOMALY" : "NORMAL");
+    }
+    fclose(out);
+    uint64_t elapsed = now_ns() - start;
+    struct stat st;
+    stat(path, &st);
+    printf("  %-18s %14.2f %12.2f %10.1f %10s %8s\n", "fprintf", (double)elapsed / SINK_BENCH_RESULTS,
+           elapsed / 1e6, st.st_size / 1e6, "-", "-");
+
+    struct { const char *label; SinkFormat format; int use_uring; } configs[] = {
+        {"sink text", SINK_TEXT, 0},
+        {"sink text uring", SINK_TEXT, 1},
+        {"sink jsonl", SINK_JSONL, 0},
+        {"sink binary", SINK_BINARY, 0},
+    };
+    for (int c = 0; c < (int)(sizeof(configs) / sizeof(configs[0])); c++) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        start = now_ns();
+        ResultSink *sink = result_sink_open(fd, configs[c].format, configs[c].use_uring);
+        SinkProducer *producer = sink != NULL ? result_sink_producer(sink) : NULL;
+        if (producer == NULL) {
+            fprintf(stderr, "[SINK] Could not open %s\n", configs[c].label);
+            if (sink != NULL) result_sink_close(sink);
+            close(fd);
+            continue;
+        }
+        for (int i = 0; i < SINK_BENCH_RESULTS; i++) {
+            result_sink_push(producer, &records[i % SINK_BENCH_DISTINCT]);
+        }
+        uint64_t pushed = now_ns() - start;
+        result_sink_flush(sink);
+        uint64_t stalls = producer->stalls;
+        uint64_t writes = __atomic_load_n(&sink->writes, __ATOMIC_RELAXED);
+        int uring = sink->use_uring;
+        result_sink_release_producer(sink, producer);
+        result_sink_close(sink);
+        elapsed = now_ns() - start;
+        fstat(fd, &st);
+        close(fd);
+
+        char label[32];
+        snprintf(label, sizeof(label), "%s%s", configs[c].label,
+                 configs[c].use_uring && !uring ? " (no uring)" : "");
+        printf("  %-18s %14.2f %12.2f %10.1f %10llu %8llu\n", label, (double)pushed / SINK_BENCH_RESULTS,
+               elapsed / 1e6, st.st_size / 1e6, (unsigned long long)writes, (unsigned long long)stalls);
+    }
+
+    unlink(path);
+    free(records);
+    return 0;
+}
+
+typedef struct {
+    SimProcess *procs;
+    AlertFilter *filter;              // NULL to alert on every INTRUSION score
+    FILE *out;
+    long tick;
+    long lines;                       // Alert and summary lines written
+    long false_lines;                 // Lines about processes behaving normally
+    int *first_line;                  // Tick of each process's first line, -1 if none
+    uint64_t ns;                      // Time spent deciding and writing
+} AlertBenchContext;
+
+void alert_bench_on_score(TrackedProcess *tp, double score, void *ctx) {
+    AlertBenchContext *ac = (AlertBenchContext*)ctx;
+    uint64_t start = now_ns();
+    int wrote;
+    if (ac->filter == NULL) {
+        wrote = score >= ANOMALY_THRESHOLD;
+        if (wrote) emit_alert(ac->out, tp, score);
+    } else {
+        AlertAction action = report_score(ac->filter, ac->out, tp, score, ac->tick);
+        wrote = action == ALERT_RAISE || action == ALERT_SUMMARY;
+    }
+    ac->ns += now_ns() - start;
+    if (!wrote) return;
+
+    int p = tp->pid - 1000;
+    SimProcess *sp = &ac->procs[p];
+    ac->lines++;
+    if (sp->attack_tick < 0 || ac->tick < sp->attack_tick) ac->false_lines++;
+    if (ac->first_line[p] < 0) ac->first_line[p] = (int)ac->tick;
+}
+
+// Alert lines written with and without deduplication and rate limiting
+int bench_alerts(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    CompactForest model;
+    compact_forest_build(&model, forest);
+    RescoreTriggers triggers;
+    rescore_triggers_from_training(&triggers, training_data, BENCH_TRAIN_SIZE);
+
+    SimProcess *procs = (SimProcess*)malloc(SIM_PROCS * sizeof(SimProcess));
+    int *first_line = (int*)malloc(SIM_PROCS * sizeof(int));
+    FILE *out = fopen("/dev/null", "w");
+    unsigned int seed = (unsigned int)rand();
+    printf("\n[ALERTS] %d processes of %d executables, %d ticks, event-driven rescoring\n\n",
+           SIM_PROCS, ALERT_BENCH_EXECUTABLES, SIM_TICKS);
+    printf("  %-10s %10s %10s %8s %14s %12s %12s\n", "Alerts", "Scorings", "Lines",
+           "FP lines", "Alerted", "Mean delay", "ns/score");
+
+    for (int filtered = 0; filtered <= 1; filtered++) {
+        srand(seed);
+        sim_init(procs, SIM_PROCS, SIM_TICKS);
+        ProcessTable table;
+        RescoreScheduler sched;
+        AlertFilter filter;
+        process_table_init(&table, SIM_PROCS);
+        rescore_scheduler_init(&sched, &table, &triggers);
+        alert_filter_init(&filter, &table);
+        for (int p = 0; p < SIM_PROCS; p++) {
+            char exe[32];
+            snprintf(exe, sizeof(exe), "exe_%d", p % ALERT_BENCH_EXECUTABLES);
+            process_set_executable(&table.slots[process_table_slot(&table, procs[p].pid, 1)], exe);
+            first_line[p] = -1;
+        }
+
+        AlertBenchContext ctx = {procs, filtered ? &filter : NULL, out, 0, 0, 0, first_line, 0};
+        for (int tick = 0; tick < SIM_TICKS; tick++) {
+            sim_feed_tick(procs, SIM_PROCS, tick, &table, &sched);
+            ctx.tick = tick;
+            rescore_run_tick(&sched, &model, alert_bench_on_score, &ctx);
+        }
+
+        int attacks = 0, alerted = 0;
+        double total_delay = 0.0;
+        for (int p = 0; p < SIM_PROCS; p++) {
+            if (procs[p].attack_tick < 0) continue;
+            attacks++;
+            // First line at or after the attack; earlier lines were false alerts
+            if (first_line[p] >= procs[p].attack_tick) {
+                alerted++;
+                total_delay += first_line[p] - procs[p].attack_tick;
+            }
+        }
+        printf("  %-10s %10ld %10ld %8ld %9d/%-4d %12.1f %12.1f\n", filtered ? "filtered" : "raw",
+               sched.scores, ctx.lines, ctx.false_lines, alerted, attacks,
+               alerted ? total_delay / alerted : 0.0, (double)ctx.ns / sched.scores);
+        if (filtered) {
+            printf("\n[ALERTS] Filter:\n");
+            alert_filter_print_metrics(&filter);
+        }
+
+        alert_filter_free(&filter);
+        rescore_scheduler_free(&sched);
+        process_table_free(&table);
+    }
+
+    fclose(out);
+    free(first_line);
+    free(procs);
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    return 0;
+}
+
+// Cost of top-k attribution over plain scoring, and how often it names the
+// syscalls the synthetic attacks actually change
+int bench_attribution(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    CompactForest model;
+    compact_forest_build(&model, forest);
+
+    ProcessBehavior *samples = (ProcessBehavior*)malloc(ATTRIBUTION_BENCH_SAMPLES * sizeof(ProcessBehavior));
+    for (int i = 0; i < ATTRIBUTION_BENCH_SAMPLES; i++) {
+        if (i % 10 == 0) generate_anomalous_behavior(&samples[i], "sample");
+        else generate_normal_behavior(&samples[i], "sample");
+    }
+
+    // Scorers: compact and pointer forest, each plain and explained. Runs
+    // alternate so noise hits all of them alike; keep the best time of each.
+    const char *labels[4] = {"compact", "compact + top-k", "pointer", "pointer + top-k"};
+    uint64_t best[4] = {UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX};
+    SyscallAttribution top[ATTRIBUTION_TOP_K];
+    int num_top;
+    double checksum = 0.0;
+    for (int run = 0; run < 4 * ATTRIBUTION_BENCH_RUNS; run++) {
+        int scorer = run % 4;
+        uint64_t start = now_ns();
+        for (int r = 0; r < ATTRIBUTION_BENCH_REPEAT; r++) {
+            for (int i = 0; i < ATTRIBUTION_BENCH_SAMPLES; i++) {
+                switch (scorer) {
+                case 0: checksum += compact_anomaly_score(&model, &samples[i]); break;
+                case 1: checksum += compact_anomaly_score_explained(&model, &samples[i], ANOMALY_THRESHOLD,
+                                                                     ATTRIBUTION_TOP_K, top, &num_top); break;
+                case 2: checksum += anomaly_score(forest, &samples[i]); break;
+                case 3: checksum += anomaly_score_explained(forest, &samples[i], ANOMALY_THRESHOLD,
+                                                            ATTRIBUTION_TOP_K, top, &num_top); break;
+                }
+            }
+        }
+        uint64_t elapsed = now_ns() - start;
+        if (elapsed < best[scorer]) best[scorer] = elapsed;
+    }
+
+    long scores = (long)ATTRIBUTION_BENCH_SAMPLES * ATTRIBUTION_BENCH_REPEAT;
+    printf("\n[ATTRIBUTION] %ld scores per run, top-%d for scores >= %.2f, best of %d runs:\n",
+           scores, ATTRIBUTION_TOP_K, ANOMALY_THRESHOLD, ATTRIBUTION_BENCH_RUNS);
+    for (int scorer = 0; scorer < 4; scorer++) {
+        printf("  %-16s %8.2f ns/score", labels[scorer], (double)best[scorer] / scores);
+        if (scorer % 2 == 1) printf("  (+%.1f%%)", 100.0 * ((double)best[scorer] - best[scorer - 1]) / best[scorer - 1]);
+        printf("\n");
+    }
+    printf("  (checksum %.4f)\n", checksum);
+
+    // Explained scores must match plain ones. Attacks raise syscalls 10+
+    // and cut 0-4, so the top syscall of a flagged attack should be one of those.
+    int mismatches = 0, flagged = 0, hits = 0, shown = 0;
+    for (int i = 0; i < ATTRIBUTION_BENCH_SAMPLES; i++) {
+        double score = anomaly_score_explained(forest, &samples[i], 0.0, ATTRIBUTION_TOP_K, top, &num_top);
+        if (score != anomaly_score(forest, &samples[i]) ||
+            compact_anomaly_score_explained(&model, &samples[i], 0.0, ATTRIBUTION_TOP_K, top, &num_top) != score) {
+            mismatches++;
+        }
+        if (!samples[i].is_anomaly || score < ANOMALY_THRESHOLD || num_top == 0) continue;
+        flagged++;
+        if (top[0].syscall < 5 || top[0].syscall >= 10) hits++;
+        if (shown++ < 3) {
+            printf("  sample %-5d score %.4f:", i, score);
+            for (int j = 0; j < num_top; j++) printf("  syscall %d (%.0f%%)", top[j].syscall, top[j].share * 100);
+            printf("\n");
+        }
+    }
+    printf("\n[ATTRIBUTION] Score mismatches: %d\n", mismatches);
+    printf("[ATTRIBUTION] Flagged attacks with an attack syscall on top: %d/%d\n", hits, flagged);
+
+    free(samples);
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// A family of processes for the aggregation benchmark. Attacking families
+// spread the attack over short-lived workers; some of them detach their
+// workers from the tree, so only their cgroup sees the whole attack.
+typedef struct {
+    int parent_slot;
+    uint64_t cgroup;
+    int attack_tick;                  // -1 if the family stays normal
+    int orphans;                      // Workers are not linked to the parent
+    int flagged[3];                   // First tick flagged per process, subtree, cgroup
+    int false_flags[3];               // Flags before the attack started
+} TreeFamily;
+
+typedef struct {
+    int slot;
+    int family;
+    int calls_left;
+} TreeWorker;
+
+typedef struct {
+    TreeFamily *families;
+    ProcessTable *table;
+    int *family_of_slot;
+    long tick;
+} TreeContext;
+
+// Record a flag for a family, by process (0), subtree (1) or cgroup (2)
+void tree_flag(TreeContext *tc, int family, int level, double score) {
+    if (family < 0 || score < ANOMALY_THRESHOLD) return;
+    TreeFamily *f = &tc->families[family];
+    if (f->attack_tick < 0 || tc->tick < f->attack_tick) f->false_flags[level]++;
+    else if (f->flagged[level] < 0) f->flagged[level] = (int)tc->tick;
+}
+
+void tree_on_process_score(TrackedProcess *tp, double score, void *ctx) {
+    TreeContext *tc = (TreeContext*)ctx;
+    tree_flag(tc, tc->family_of_slot[tp - tc->table->slots], 0, score);
+}
+
+void tree_on_aggregate_score(const AggregateRef *agg, double score, void *ctx) {
+    TreeContext *tc = (TreeContext*)ctx;
+    if (agg->slot >= 0) tree_flag(tc, tc->family_of_slot[agg->slot], 1, score);
+    else tree_flag(tc, (int)agg->cgroup - 1, 2, score);
+}
+
+// Attacks spread over short-lived workers, detected per process vs by
+// process-tree and cgroup aggregates; then ingest cost on a 100k-process tree
+int bench_tree(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    CompactForest model;
+    compact_forest_build(&model, forest);
+    RescoreTriggers triggers;
+    rescore_triggers_from_training(&triggers, training_data, BENCH_TRAIN_SIZE);
+
+    ProcessBehavior normal, attack;
+    generate_normal_behavior(&normal, "profile");
+    generate_anomalous_behavior(&attack, "profile");
+
+    int max_workers = TREE_BENCH_FAMILIES * (TREE_BENCH_TICKS / TREE_BENCH_SPAWN_TICKS + 1);
+    ProcessTable table;
+    RescoreScheduler sched;
+    ProcessAggregates agg;
+    process_table_init(&table, TREE_BENCH_FAMILIES + max_workers);
+    rescore_scheduler_init(&sched, &table, &triggers);
+    aggregates_init(&agg, &table);
+    sched.aggregates = &agg;
+
+    TreeFamily *families = (TreeFamily*)calloc(TREE_BENCH_FAMILIES, sizeof(TreeFamily));
+    TreeWorker *workers = (TreeWorker*)malloc(max_workers * sizeof(TreeWorker));
+    int *family_of_slot = (int*)malloc(table.capacity * sizeof(int));
+    for (int i = 0; i < table.capacity; i++) family_of_slot[i] = -1;
+    int next_pid = 1000, num_workers = 0;
+
+    for (int f = 0; f < TREE_BENCH_FAMILIES; f++) {
+        TreeFamily *fam = &families[f];
+        fam->parent_slot = process_table_slot(&table, next_pid++, 1);
+        fam->cgroup = f + 1;
+        fam->attack_tick = f % 10 == 0 ? TREE_BENCH_TICKS / 4 + rand() % (TREE_BENCH_TICKS / 2) : -1;
+        fam->orphans = f % 20 == 10;
+        for (int level = 0; level < 3; level++) fam->flagged[level] = -1;
+        family_of_slot[fam->parent_slot] = f;
+        aggregates_set_cgroup(&agg, fam->parent_slot, fam->cgroup);
+    }
+    TreeContext ctx = {families, &table, family_of_slot, 0};
+    long aggregate_scores = 0;
+    uint64_t ingest_ns = 0, aggregate_ns = 0;
+    for (int tick = 0; tick < TREE_BENCH_TICKS; tick++) {
+        ctx.tick = tick;
+        uint64_t start = now_ns();
+        for (int f = 0; f < TREE_BENCH_FAMILIES; f++) {
+            TreeFamily *fam = &families[f];
+            if (tick % TREE_BENCH_SPAWN_TICKS == 0) {
+                int slot = process_table_slot(&table, next_pid++, 1);
+                family_of_slot[slot] = f;
+                if (!fam->orphans) aggregates_link(&agg, slot, fam->parent_slot);
+                aggregates_set_cgroup(&agg, slot, fam->cgroup);
+                workers[num_workers++] = (TreeWorker){slot, f, TREE_BENCH_WORKER_CALLS};
+            }
+            int calls = rand() % (SIM_MAX_EVENTS + 1);
+            for (int c = 0; c < calls; c++) rescore_on_syscall(&sched, fam->parent_slot, sample_syscall(&normal), 1);
+        }
+        for (int w = 0; w < num_workers; w++) {
+            TreeWorker *worker = &workers[w];
+            if (worker->calls_left == 0) continue;
+            const TreeFamily *fam = &families[worker->family];
+            int attacking = fam->attack_tick >= 0 && tick >= fam->attack_tick;
+            int calls = rand() % (SIM_MAX_EVENTS + 1);
+            if (calls > worker->calls_left) calls = worker->calls_left;
+            worker->calls_left -= calls;
+            for (int c = 0; c < calls; c++) {
+                rescore_on_syscall(&sched, worker->slot, sample_syscall(attacking ? &attack : &normal), 1);
+            }
+        }
+        uint64_t mid = now_ns();
+        rescore_run_tick(&sched, &model, tree_on_process_score, &ctx);
+        uint64_t scored = now_ns();
+        aggregate_scores += aggregates_score(&agg, &model, tree_on_aggregate_score, &ctx);
+        aggregate_ns += now_ns() - scored;
+        ingest_ns += mid - start;
+    }
+
+    printf("\n[TREE] %d families, %d processes, %d ticks; workers make %d calls (< %d needed to score one)\n\n",
+           TREE_BENCH_FAMILIES, table.count, TREE_BENCH_TICKS, TREE_BENCH_WORKER_CALLS, RESCORE_MIN_CALLS);
+    printf("  %-12s %14s %12s %12s\n", "Scored as", "Detected", "Mean delay", "FP flags");
+    const char *levels[3] = {"process", "subtree", "cgroup"};
+    for (int level = 0; level < 3; level++) {
+        int attacks = 0, detected = 0, false_flags = 0;
+        double total_delay = 0.0;
+        for (int f = 0; f < TREE_BENCH_FAMILIES; f++) {
+            false_flags += families[f].false_flags[level];
+            if (families[f].attack_tick < 0) continue;
+            attacks++;
+            if (families[f].flagged[level] >= 0) {
+                detected++;
+                total_delay += families[f].flagged[level] - families[f].attack_tick;
+            }
+        }
+        printf("  %-12s %9d/%-4d %12.1f %12d\n", levels[level], detected, attacks,
+               detected ? total_delay / detected : 0.0, false_flags);
+    }
+    printf("\n  Process scorings: %ld, aggregate scorings: %ld\n", sched.scores, aggregate_scores);
+    printf("  Ingest: %.2f ms, aggregate scoring: %.2f ms\n", ingest_ns / 1e6, aggregate_ns / 1e6);
+
+    aggregates_free(&agg);
+    rescore_scheduler_free(&sched);
+    process_table_free(&table);
+    free(family_of_slot);
+    free(workers);
+    free(families);
+
+    // Scale: a random recursive tree (each process forks from a random
+    // earlier one), spread over cgroups
+    process_table_init(&table, TREE_BENCH_SCALE_PROCS);
+    aggregates_init(&agg, &table);
+    int *slots = (int*)malloc(TREE_BENCH_SCALE_PROCS * sizeof(int));
+    int max_depth = 0;
+    int *depths = (int*)calloc(TREE_BENCH_SCALE_PROCS, sizeof(int));
+    for (int i = 0; i < TREE_BENCH_SCALE_PROCS; i++) {
+        slots[i] = process_table_slot(&table, i + 1, 1);
+        aggregates_set_cgroup(&agg, slots[i], 1 + i % TREE_BENCH_SCALE_CGROUPS);
+        if (i == 0) continue;
+        int parent = rand() % i;
+        aggregates_link(&agg, slots[i], slots[parent]);
+        depths[i] = depths[parent] + 1;
+        if (depths[i] > max_depth) max_depth = depths[i];
+    }
+
+    int *event_slots = (int*)malloc(TREE_BENCH_SCALE_EVENTS * sizeof(int));
+    int *event_calls = (int*)malloc(TREE_BENCH_SCALE_EVENTS * sizeof(int));
+    for (int e = 0; e < TREE_BENCH_SCALE_EVENTS; e++) {
+        event_slots[e] = slots[rand() % TREE_BENCH_SCALE_PROCS];
+        event_calls[e] = sample_syscall(&normal);
+    }
+
+    uint64_t start = now_ns();
+    for (int e = 0; e < TREE_BENCH_SCALE_EVENTS; e++) {
+        process_record_syscall(&table.slots[event_slots[e]], event_calls[e], 1);
+    }
+    uint64_t plain_ns = now_ns() - start;
+    start = now_ns();
+    for (int e = 0; e < TREE_BENCH_SCALE_EVENTS; e++) {
+        process_record_syscall(&table.slots[event_slots[e]], event_calls[e], 1);
+        aggregates_record(&agg, event_slots[e], event_calls[e], 1);
+    }
+    uint64_t rollup_ns = now_ns() - start;
+    int dirty = agg.num_dirty;
+    start = now_ns();
+    int scored = aggregates_score(&agg, &model, NULL, NULL);
+    uint64_t score_ns = now_ns() - start;
+
+    printf("\n[TREE] Scale: %d processes, depth up to %d, %d cgroups, %d calls\n",
+           TREE_BENCH_SCALE_PROCS, max_depth, agg.num_cgroups, TREE_BENCH_SCALE_EVENTS);
+    printf("  Record only:       %8.1f ns/call\n", (double)plain_ns / TREE_BENCH_SCALE_EVENTS);
+    printf("  Record + roll-up:  %8.1f ns/call\n", (double)rollup_ns / TREE_BENCH_SCALE_EVENTS);
+    printf("  Scoring pass:      %d dirty, %d scored in %.2f ms\n", dirty, scored, score_ns / 1e6);
+    printf("  Memory:            %.1f MB table + %.1f MB aggregates\n",
+           table.capacity * sizeof(TrackedProcess) / 1e6, aggregates_bytes(&agg) / 1e6);
+
+    free(event_calls);
+    free(event_slots);
+    free(depths);
+    free(slots);
+    aggregates_free(&agg);
+    process_table_free(&table);
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    return 0;
+}
+
+// Calls a simulated process makes at a tick: its normal calls, plus a short
+// dense burst (attack_type 1) or a trickle (attack_type 2) of attack calls
+int multires_sim_calls(const SimProcess *sp, int attack_type, int tick, int *calls) {
+    int n = rand() % (sp->max_events + 1);
+    for (int c = 0; c < n; c++) calls[c] = sample_syscall(&sp->normal_profile);
+    if (sp->attack_tick < 0 || tick < sp->attack_tick) return n;
+
+    int attack_calls = 0;
+    if (attack_type == 1 && tick < sp->attack_tick + MR_BENCH_BURST_TICKS) attack_calls = MR_BENCH_BURST_CALLS;
+    if (attack_type == 2 && tick % MR_BENCH_SLOW_EVERY == 0) attack_calls = 1;
+    for (int c = 0; c < attack_calls; c++) calls[n++] = sample_syscall(&sp->attack_profile);
+    return n;
+}
+
+// Burst and slow attacks against one window vs windows of several sizes
+// with window-specific forests; then memory and per-call update cost
+int bench_windows(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    CompactForest model;
+    compact_forest_build(&model, forest);
+
+    // Window-specific forests, trained on windows of normal simulated
+    // processes, sampled every widest-window span once the widest has filled
+    SimProcess *procs = (SimProcess*)malloc(SIM_PROCS * sizeof(SimProcess));
+    sim_init(procs, BENCH_TRAIN_SIZE, MR_BENCH_TICKS);
+    ProcessTable table;
+    MultiResolution mr;
+    process_table_init(&table, SIM_PROCS);
+    multires_init(&mr, &table);
+    int calls[SIM_MAX_EVENTS + MR_BENCH_BURST_CALLS];
+    long widest = multires_span(MR_LEVELS);
+    int num_windows = BENCH_TRAIN_SIZE * MR_BENCH_TRAIN_SNAPSHOTS;
+    ProcessBehavior *windows = (ProcessBehavior*)malloc(MR_LEVELS * num_windows * sizeof(ProcessBehavior));
+    int snapshot = 0;
+    for (int tick = 1; snapshot < MR_BENCH_TRAIN_SNAPSHOTS; tick++) {
+        for (int p = 0; p < BENCH_TRAIN_SIZE; p++) {
+            procs[p].attack_tick = -1;
+            int n = multires_sim_calls(&procs[p], 0, tick, calls);
+            for (int c = 0; c < n; c++) multires_record(&mr.windows[p], calls[c], 1, tick);
+        }
+        if (tick < widest || tick % widest != 0) continue;
+        for (int p = 0; p < BENCH_TRAIN_SIZE; p++) {
+            multires_advance(&mr.windows[p], tick + 1);
+            for (int level = 0; level < MR_LEVELS; level++) {
+                multires_features(&mr.windows[p], level,
+                                  &windows[level * num_windows + snapshot * BENCH_TRAIN_SIZE + p]);
+            }
+        }
+        snapshot++;
+    }
+    IsolationForest *level_forests[MR_LEVELS];
+    CompactForest level_models[MR_LEVELS];
+    double thresholds[MR_LEVELS];
+    for (int level = 0; level < MR_LEVELS; level++) {
+        level_forests[level] = train_isolation_forest(&windows[level * num_windows], num_windows);
+        compact_forest_build(&level_models[level], level_forests[level]);
+        mr.models[level] = &level_models[level];
+        multires_calibrate(&mr, level, &windows[level * num_windows], num_windows);
+        thresholds[level] = mr.thresholds[level];
+    }
+    free(windows);
+    multires_free(&mr);
+    process_table_free(&table);
+
+    printf("\n[WINDOWS] %d processes, %d ticks, scored every %d ticks; windows of", SIM_PROCS,
+           MR_BENCH_TICKS, MR_BENCH_SCORE_TICKS);
+    for (int level = 0; level < MR_LEVELS; level++) printf(" %ld", multires_span(level + 1));
+    printf(" ticks\n[WINDOWS] Calibrated thresholds:");
+    for (int level = 0; level < MR_LEVELS; level++) printf(" %.4f", thresholds[level]);
+    printf("\n\n");
+    printf("  %-14s %14s %12s %14s %12s %10s %10s\n", "Windows", "Bursts", "Mean delay",
+           "Slow", "Mean delay", "FP rate", "Score ms");
+
+    unsigned int seed = (unsigned int)rand();
+    int *slots = (int*)malloc(SIM_PROCS * sizeof(int));
+    int *attack_type = (int*)malloc(SIM_PROCS * sizeof(int));
+    int *flagged = (int*)malloc(SIM_PROCS * sizeof(int));
+    double *scores = (double*)malloc(SIM_PROCS * MR_LEVELS * sizeof(double));
+
+    for (int multi = 0; multi <= 1; multi++) {
+        srand(seed);
+        sim_init(procs, SIM_PROCS, MR_BENCH_TICKS);
+        process_table_init(&table, SIM_PROCS);
+        multires_init(&mr, &table);
+        for (int level = 0; level < MR_LEVELS; level++) {
+            mr.models[level] = &level_models[level];
+            mr.thresholds[level] = thresholds[level];
+        }
+        for (int p = 0; p < SIM_PROCS; p++) {
+            slots[p] = process_table_slot(&table, procs[p].pid, 1);
+            // sim_init makes every 10th process an attacker; alternate the kind
+            attack_type[p] = procs[p].attack_tick < 0 ? 0 : 1 + (p / 10) % 2;
+            flagged[p] = -1;
+        }
+
+        uint64_t score_ns = 0;
+        long normal_scorings = 0, false_flags = 0;
+        for (int tick = 0; tick < MR_BENCH_TICKS; tick++) {
+            for (int p = 0; p < SIM_PROCS; p++) {
+                int n = multires_sim_calls(&procs[p], attack_type[p], tick, calls);
+                for (int c = 0; c < n; c++) {
+                    if (multi) multires_record(&mr.windows[slots[p]], calls[c], 1, tick);
+                    else process_record_syscall(&table.slots[slots[p]], calls[c], 1);
+                }
+            }
+            if (tick % MR_BENCH_SCORE_TICKS != 0) continue;
+
+            uint64_t start = now_ns();
+            if (multi) {
+                multires_score(&mr, slots, SIM_PROCS, tick, scores);
+            } else {
+                for (int p = 0; p < SIM_PROCS; p++) {
+                    ProcessBehavior features;
+                    process_window_features(&table.slots[slots[p]], &features);
+                    scores[p * MR_LEVELS] = table.slots[slots[p]].window.total_calls >= MR_MIN_CALLS ?
+                        compact_anomaly_score(&model, &features) : -1.0;
+                }
+            }
+            score_ns += now_ns() - start;
+
+            for (int p = 0; p < SIM_PROCS; p++) {
+                int attacking = procs[p].attack_tick >= 0 && tick >= procs[p].attack_tick;
+                int flag = multi ? multires_flags(&mr, &scores[p * MR_LEVELS]) != 0 :
+                                   scores[p * MR_LEVELS] >= ANOMALY_THRESHOLD;
+                if (!attacking) {
+                    normal_scorings++;
+                    false_flags += flag;
+                } else if (flag && flagged[p] < 0) {
+                    flagged[p] = tick;
+                }
+            }
+        }
+
+        int attacks[3] = {0}, detected[3] = {0};
+        double delay[3] = {0.0};
+        for (int p = 0; p < SIM_PROCS; p++) {
+            attacks[attack_type[p]]++;
+            if (flagged[p] >= 0) {
+                detected[attack_type[p]]++;
+                delay[attack_type[p]] += flagged[p] - procs[p].attack_tick;
+            }
+        }
+        printf("  %-14s %9d/%-4d %12.1f %9d/%-4d %12.1f %9.3f%% %10.2f\n",
+               multi ? "multi-res" : "single", detected[1], attacks[1],
+               detected[1] ? delay[1] / detected[1] : 0.0, detected[2], attacks[2],
+               detected[2] ? delay[2] / detected[2] : 0.0, 100.0 * false_flags / normal_scorings, score_ns / 1e6);
+        multires_free(&mr);
+        process_table_free(&table);
+    }
+
+    // Update cost: a dense call stream spread over the widest window
+    process_table_init(&table, SIM_PROCS);
+    multires_init(&mr, &table);
+    int *event_slots = (int*)malloc(MR_BENCH_EVENTS * sizeof(int));
+    int *event_calls = (int*)malloc(MR_BENCH_EVENTS * sizeof(int));
+    for (int p = 0; p < SIM_PROCS; p++) slots[p] = process_table_slot(&table, procs[p].pid, 1);
+    for (int e = 0; e < MR_BENCH_EVENTS; e++) {
+        event_slots[e] = slots[rand() % SIM_PROCS];
+        event_calls[e] = sample_syscall(&procs[0].normal_profile);
+    }
+    long events_per_tick = MR_BENCH_EVENTS / (4 * multires_span(MR_LEVELS));
+    uint64_t start = now_ns();
+    for (int e = 0; e < MR_BENCH_EVENTS; e++) {
+        process_record_syscall(&table.slots[event_slots[e]], event_calls[e], 1);
+    }
+    uint64_t single_ns = now_ns() - start;
+    start = now_ns();
+    for (int e = 0; e < MR_BENCH_EVENTS; e++) {
+        multires_record(&mr.windows[event_slots[e]], event_calls[e], 1, e / events_per_tick);
+    }
+    uint64_t multi_ns = now_ns() - start;
+
+    printf("\n[WINDOWS] Per process: %zu bytes single window, %zu bytes for %d windows\n",
+           sizeof(ProcessBehavior), sizeof(MultiWindow), MR_LEVELS);
+    printf("[WINDOWS] Update: %.1f ns/call single, %.1f ns/call multi-res (%ld calls per tick)\n",
+           (double)single_ns / MR_BENCH_EVENTS, (double)multi_ns / MR_BENCH_EVENTS, events_per_tick);
+
+    free(event_calls);
+    free(event_slots);
+    multires_free(&mr);
+    process_table_free(&table);
+    free(scores);
+    free(flagged);
+    free(attack_type);
+    free(slots);
+    free(procs);
+    for (int level = 0; level < MR_LEVELS; level++) {
+        compact_forest_free(&level_models[level]);
+        free_forest(level_forests[level]);
+    }
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    return 0;
+}
+
+typedef struct {
+    int sharded;                      // 1: per-thread shards, 0: shared atomic counters
+    uint64_t *shared;
+    ShardedBehavior *shards;
+    const int *syscalls;              // Syscall sequence, SHARD_BENCH_UPDATES long
+    long updates;
+    long offset;
+} ShardWriter;
+
+void* shard_bench_writer(void *arg) {
+    ShardWriter *w = (ShardWriter*)arg;
+    const int *syscalls = w->syscalls + w->offset;
+    if (w->sharded) {
+        for (long i = 0; i < w->updates; i++) sharded_record(w->shards, syscalls[i], 1);
+        shard_writer_release();
+    } else {
+        for (long i = 0; i < w->updates; i++) __atomic_fetch_add(&w->shared[syscalls[i]], 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+typedef struct {
+    ShardWriter *config;
+    volatile int stop;
+    long snapshots;
+} ShardScorer;
+
+// Take snapshots the way the scorer would while writers run
+void* shard_bench_scorer(void *arg) {
+    ShardScorer *sc = (ShardScorer*)arg;
+    struct timespec interval = {0, SHARD_BENCH_SNAPSHOT_US * 1000};
+    uint64_t snapshot[MAX_SYSCALLS];
+    while (!sc->stop) {
+        if (sc->config->sharded) {
+            sharded_snapshot(sc->config->shards, snapshot);
+        } else {
+            for (int s = 0; s < MAX_SYSCALLS; s++) {
+                snapshot[s] = __atomic_load_n(&sc->config->shared[s], __ATOMIC_RELAXED);
+            }
+        }
+        sc->snapshots++;
+        nanosleep(&interval, NULL);
+    }
+    return NULL;
+}
+
+// Concurrent updates of one hot process: shared atomic counters vs
+// per-thread shards, with a scorer taking snapshots throughout
+int bench_shards(void) {
+    srand(42);
+    ProcessBehavior profile;
+    generate_normal_behavior(&profile, "profile");
+    int *syscalls = (int*)malloc(SHARD_BENCH_UPDATES * sizeof(int));
+    for (long i = 0; i < SHARD_BENCH_UPDATES; i++) syscalls[i] = sample_syscall(&profile);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("\n[SHARDS] %d updates to one process per run, %ld CPUs, snapshot every %d us\n\n",
+           SHARD_BENCH_UPDATES, cpus, SHARD_BENCH_SNAPSHOT_US);
+    printf("  %-8s %-10s %14s %12s %10s %8s\n", "Threads", "Counters", "M updates/s",
+           "Snapshots", "Retries", "Exact");
+
+    int thread_counts[] = {1, 2, 4, 8, 16, 32, 64};
+    int failures = 0;
+    for (int c = 0; c < (int)(sizeof(thread_counts) / sizeof(thread_counts[0])); c++) {
+        int threads = thread_counts[c];
+        for (int sharded = 0; sharded <= 1; sharded++) {
+            uint64_t shared[MAX_SYSCALLS] __attribute__((aligned(64))) = {0};
+            ShardedBehavior *shards = sharded_create();
+            ShardWriter *writers = (ShardWriter*)malloc(threads * sizeof(ShardWriter));
+            pthread_t *tids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+            ShardWriter config = {sharded, shared, shards, syscalls, 0, 0};
+            ShardScorer scorer = {&config, 0, 0};
+            pthread_t scorer_tid;
+            pthread_create(&scorer_tid, NULL, shard_bench_scorer, &scorer);
+
+            uint64_t start = now_ns();
+            for (int t = 0; t < threads; t++) {
+                writers[t] = config;
+                writers[t].updates = SHARD_BENCH_UPDATES / threads;
+                writers[t].offset = t * writers[t].updates;
+                pthread_create(&tids[t], NULL, shard_bench_writer, &writers[t]);
+            }
+            for (int t = 0; t < threads; t++) pthread_join(tids[t], NULL);
+            uint64_t elapsed = now_ns() - start;
+            scorer.stop = 1;
+            pthread_join(scorer_tid, NULL);
+
+            // Every update must show up in the final snapshot
+            uint64_t snapshot[MAX_SYSCALLS], total = 0;
+            if (sharded) sharded_snapshot(shards, snapshot);
+            else memcpy(snapshot, shared, sizeof(snapshot));
+            for (int s = 0; s < MAX_SYSCALLS; s++) total += snapshot[s];
+            long expected = (long)(SHARD_BENCH_UPDATES / threads) * threads;
+            int exact = total == (uint64_t)expected;
+            failures += !exact;
+
+            printf("  %-8d %-10s %14.2f %12ld %10ld %8s\n", threads, sharded ? "sharded" : "atomic",
+                   expected * 1e3 / elapsed, scorer.snapshots, sharded ? shards->retries : 0L,
+                   exact ? "yes" : "NO");
+            free(tids);
+            free(writers);
+            sharded_free(shards);
+        }
+    }
+
+    free(syscalls);
+    return failures == 0 ? 0 : 1;
+}
+
+typedef struct {
+    ProcessDirectory *dir;
+    const CompactForest *model;
+    volatile int stop;
+    long scored;
+    long scans;
+    long mismatches;                  // Records that changed identity under a reader
+    long flagged;                     // Scores at or above ANOMALY_THRESHOLD
+} PoolScorer;
+
+// Scan the directory in chunks, each inside its own critical section, and
+// score every live record. Scorers only read records: results stay in the
+// scorer. A record recycled under the reader would show a changed pid or
+// a tag (first_seen_tick) that does not match it.
+void* pool_bench_scorer(void *arg) {
+    PoolScorer *sc = (PoolScorer*)arg;
+    ProcessBehavior features;
+    metrics_register_thread();
+    while (!sc->stop) {
+        int start = 0, capacity;
+        do {
+            epoch_enter();
+            DirectoryTable *t = __atomic_load_n(&sc->dir->table, __ATOMIC_ACQUIRE);
+            capacity = t->capacity;
+            int end = start + POOL_BENCH_SCAN_CHUNK < capacity ? start + POOL_BENCH_SCAN_CHUNK : capacity;
+            for (int i = start; i < end; i++) {
+                TrackedProcess *tp = __atomic_load_n(&t->entries[i], __ATOMIC_ACQUIRE);
+                if (tp == NULL || tp == DIRECTORY_REMOVED) continue;
+                int pid = __atomic_load_n(&tp->pid, __ATOMIC_ACQUIRE);
+                long tag = __atomic_load_n(&tp->first_seen_tick, __ATOMIC_ACQUIRE);
+                process_window_features(tp, &features);
+                if (compact_anomaly_score(sc->model, &features) >= ANOMALY_THRESHOLD) sc->flagged++;
+                if (pid <= 0 || tag != pid ||
+                    __atomic_load_n(&tp->pid, __ATOMIC_ACQUIRE) != pid) {
+                    sc->mismatches++;
+                }
+                sc->scored++;
+            }
+            epoch_exit();
+            start = end;
+        } while (start < capacity && !sc->stop);
+        sc->scans++;
+    }
+    epoch_thread_release();
+    process_pool_flush_cache();
+    return NULL;
+}
+
+typedef struct {
+    ProcessDirectory *dir;
+    const ProcessBehavior *profile;
+    long created;
+    long exited;
+    long failed;
+    uint64_t elapsed_ns;              // Time to make all creations
+    uint64_t *create_ns;              // Latency of each creation
+    uint64_t *exit_ns;                // Latency of each exit
+} PoolChurn;
+
+// Create processes at POOL_BENCH_RATE, record their first syscalls and
+// remove each one POOL_BENCH_LIFETIME_MS later
+void* pool_bench_churn(void *arg) {
+    PoolChurn *ch = (PoolChurn*)arg;
+    long total = (long)POOL_BENCH_RATE * POOL_BENCH_SECONDS;
+    uint64_t interval = 1000000000ull / POOL_BENCH_RATE;
+    uint64_t lifetime = POOL_BENCH_LIFETIME_MS * 1000000ull;
+    int *pids = (int*)malloc(total * sizeof(int));
+    uint64_t *born = (uint64_t*)malloc(total * sizeof(uint64_t));
+    struct timespec pause = {0, 200000};
+
+    uint64_t start = now_ns();
+    long next_exit = 0;
+    while (ch->created < total || next_exit < ch->created) {
+        uint64_t now = now_ns();
+        long due = (long)((now - start) / interval) + 1;
+        if (due > total) due = total;
+        while (ch->created < due) {
+            int pid = (int)(ch->created + 1);
+            uint64_t t0 = now_ns();
+            // Set the record up completely before scorers can see it
+            TrackedProcess *tp = directory_create(ch->dir, pid);
+            if (tp != NULL) {
+                for (int c = 0; c < POOL_BENCH_CALLS; c++) process_record_syscall(tp, sample_syscall(ch->profile), 1);
+                tp->first_seen_tick = pid;
+                if (directory_publish(ch->dir, tp) != 0) tp = NULL;
+            }
+            if (tp == NULL) ch->failed++;
+            uint64_t t1 = now_ns();
+            ch->create_ns[ch->created] = t1 - t0;
+            pids[ch->created] = tp != NULL ? pid : 0;
+            born[ch->created] = t1;
+            ch->created++;
+            if (ch->created == total) ch->elapsed_ns = t1 - start;
+        }
+        now = now_ns();
+        while (next_exit < ch->created && (now - born[next_exit] >= lifetime || ch->created == total)) {
+            if (pids[next_exit] != 0) {
+                uint64_t t0 = now_ns();
+                directory_remove(ch->dir, pids[next_exit]);
+                ch->exit_ns[ch->exited++] = now_ns() - t0;
+            }
+            next_exit++;
+            if (ch->created == total && now - born[next_exit - 1] < lifetime) break;
+        }
+        nanosleep(&pause, NULL);
+    }
+
+    epoch_reclaim();
+    epoch_thread_release();
+    process_pool_flush_cache();
+    free(pids);
+    free(born);
+    return NULL;
+}
+
+void pool_bench_print_latency(const char *name, uint64_t *ns, long n) {
+    if (n == 0) return;
+    qsort(ns, n, sizeof(uint64_t), compare_u64);
+    printf("  %-12s p50 %6llu ns   p99 %6llu ns   p99.9 %7llu ns   max %8llu ns\n", name,
+           (unsigned long long)percentile_u64(ns, (int)n, 50.0),
+           (unsigned long long)percentile_u64(ns, (int)n, 99.0),
+           (unsigned long long)percentile_u64(ns, (int)n, 99.9),
+           (unsigned long long)ns[n - 1]);
+}
+
+// Process churn at 50k creations/s: pooled records in a pid directory,
+// scanned and scored concurrently with epoch-protected reads
+int bench_pool(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    CompactForest model;
+    compact_forest_build(&model, forest);
+    ProcessBehavior profile;
+    generate_normal_behavior(&profile, "profile");
+
+    long total = (long)POOL_BENCH_RATE * POOL_BENCH_SECONDS;
+    long live = (long)POOL_BENCH_RATE * POOL_BENCH_LIFETIME_MS / 1000;
+    ProcessPool pool;
+    ProcessDirectory dir;
+    if (process_pool_init(&pool, 4 * live) != 0 || directory_init(&dir, &pool) != 0) {
+        fprintf(stderr, "Failed to allocate process pool\n");
+        return 1;
+    }
+
+    printf("\n[POOL] %d creations/s for %d s, lifetime %d ms (~%ld live), %d scorer threads\n\n",
+           POOL_BENCH_RATE, POOL_BENCH_SECONDS, POOL_BENCH_LIFETIME_MS, live, POOL_BENCH_SCORERS);
+
+    PoolChurn churn = {&dir, &profile, 0, 0, 0, 0, NULL, NULL};
+    churn.create_ns = (uint64_t*)malloc(total * sizeof(uint64_t));
+    churn.exit_ns = (uint64_t*)malloc(total * sizeof(uint64_t));
+    PoolScorer scorers[POOL_BENCH_SCORERS];
+    pthread_t scorer_tids[POOL_BENCH_SCORERS], churn_tid;
+    for (int i = 0; i < POOL_BENCH_SCORERS; i++) {
+        scorers[i] = (PoolScorer){&dir, &model, 0, 0, 0, 0, 0};
+        pthread_create(&scorer_tids[i], NULL, pool_bench_scorer, &scorers[i]);
+    }
+    pthread_create(&churn_tid, NULL, pool_bench_churn, &churn);
+    pthread_join(churn_tid, NULL);
+    long scored = 0, scans = 0, mismatches = 0, flagged = 0;
+    for (int i = 0; i < POOL_BENCH_SCORERS; i++) {
+        scorers[i].stop = 1;
+        pthread_join(scorer_tids[i], NULL);
+        scored += scorers[i].scored;
+        scans += scorers[i].scans;
+        mismatches += scorers[i].mismatches;
+        flagged += scorers[i].flagged;
+    }
+
+    printf("  Created:      %ld (%.0f/s), %ld failed\n", churn.created,
+           churn.created * 1e9 / churn.elapsed_ns, churn.failed);
+    printf("  Exited:       %ld\n", churn.exited);
+    printf("  Scored:       %ld records in %ld scans, %ld flagged\n", scored, scans, flagged);
+    printf("  Mismatches:   %ld\n\n", mismatches);
+    pool_bench_print_latency("Create", churn.create_ns, churn.created);
+    pool_bench_print_latency("Exit", churn.exit_ns, churn.exited);
+    printf("\n");
+    process_pool_print_stats(&pool);
+
+    // Allocator cost alone: rounds of allocating and freeing a batch
+    TrackedProcess **batch = (TrackedProcess**)malloc(POOL_BENCH_ALLOCS * sizeof(TrackedProcess*));
+    uint64_t start = now_ns();
+    for (int round = 0; round < POOL_BENCH_ROUNDS; round++) {
+        for (int i = 0; i < POOL_BENCH_ALLOCS; i++) batch[i] = process_pool_alloc(&pool);
+        for (int i = 0; i < POOL_BENCH_ALLOCS; i++) process_pool_free(&pool, batch[i]);
+    }
+    double pool_ns = (double)(now_ns() - start) / ((double)POOL_BENCH_ROUNDS * POOL_BENCH_ALLOCS);
+    start = now_ns();
+    for (int round = 0; round < POOL_BENCH_ROUNDS; round++) {
+        for (int i = 0; i < POOL_BENCH_ALLOCS; i++) batch[i] = (TrackedProcess*)calloc(1, sizeof(TrackedProcess));
+        for (int i = 0; i < POOL_BENCH_ALLOCS; i++) free(batch[i]);
+    }
+    double malloc_ns = (double)(now_ns() - start) / ((double)POOL_BENCH_ROUNDS * POOL_BENCH_ALLOCS);
+    printf("\n  Alloc+free:   pool %.1f ns, calloc/free %.1f ns per record\n", pool_ns, malloc_ns);
+
+    free(batch);
+    free(churn.create_ns);
+    free(churn.exit_ns);
+    epoch_drain();
+    directory_free(&dir);
+    process_pool_flush_cache();
+    process_pool_free_all(&pool);
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    return mismatches == 0 && churn.failed == 0 ? 0 : 1;
+}
+
+// Order-independent hash of all checkpointed state, to compare a restored
+// detector with the original
+uint64_t checkpoint_bench_digest(ProcessTable *table, AlertFilter *alerts, MultiResolution *mr) {
+    uint64_t digest = 0;
+    for (int i = 0; i < table->capacity; i++) {
+        if (table->slots[i].pid <= 0) continue;
+        const void *parts[3] = {&table->slots[i], &alerts->states[i], &mr->windows[i]};
+        size_t sizes[3] = {sizeof(TrackedProcess), sizeof(AlertState), sizeof(MultiWindow)};
+        uint64_t hash = 14695981039346656037ull;  // FNV-1a
+        for (int p = 0; p < 3; p++) {
+            const unsigned char *bytes = (const unsigned char*)parts[p];
+            for (size_t b = 0; b < sizes[p]; b++) hash = (hash ^ bytes[b]) * 1099511628211ull;
+        }
+        digest += hash;
+    }
+    return digest;
+}
+
+// Checkpoint 1M tracked processes from a forked child while the pipeline
+// keeps updating them, then restore into a fresh detector
+int bench_checkpoint(void) {
+    srand(42);
+    ProcessBehavior profile;
+    generate_normal_behavior(&profile, "profile");
+    const char *executables[] = {"nginx", "postgres", "sshd", "cron", "bash", "python3", "java", "node"};
+
+    ProcessTable table;
+    AlertFilter alerts;
+    MultiResolution mr;
+    Checkpointer ck;
+    if (process_table_init(&table, CKPT_BENCH_PROCS) != 0 || alert_filter_init(&alerts, &table) != 0 ||
+        multires_init(&mr, &table) != 0 || checkpoint_init(&ck, CKPT_BENCH_PATH) != 0) {
+        fprintf(stderr, "Failed to allocate detector state\n");
+        return 1;
+    }
+
+    long tick = 0;
+    for (int i = 0; i < CKPT_BENCH_PROCS; i++) {
+        tick = i / 256;
+        TrackedProcess *tp = &table.slots[process_table_slot(&table, i + 1, 1)];
+        process_set_executable(tp, executables[i % 8]);
+        tp->first_seen_tick = tick;
+        for (int c = 0; c < 16; c++) {
+            int syscall = sample_syscall(&profile);
+            process_record_syscall(tp, syscall, 1);
+            multires_record(&mr.windows[tp - table.slots], syscall, 1, tick);
+        }
+        alert_filter_update(&alerts, tp, 0.4 + 0.4 * rand() / RAND_MAX, tick);
+    }
+    uint64_t digest = checkpoint_bench_digest(&table, &alerts, &mr);
+
+    printf("\n[CHECKPOINT] %d tracked processes, table of %d slots\n\n", CKPT_BENCH_PROCS, table.capacity);
+    if (checkpoint_start(&ck, &table, &alerts, &mr, tick) != 0) {
+        fprintf(stderr, "Failed to start checkpoint: %s\n", strerror(errno));
+        return 1;
+    }
+    // The pipeline keeps going while the child writes
+    long updates = 0;
+    while (checkpoint_poll(&ck, 0) == 1) {
+        for (int n = 0; n < 1000; n++, updates++) {
+            int slot = process_table_slot(&table, 1 + rand() % CKPT_BENCH_PROCS, 0);
+            int syscall = sample_syscall(&profile);
+            process_record_syscall(&table.slots[slot], syscall, 1);
+            multires_record(&mr.windows[slot], syscall, 1, tick);
+        }
+    }
+    if (ck.written != 1) {
+        fprintf(stderr, "Checkpoint failed\n");
+        return 1;
+    }
+    struct stat st;
+    stat(CKPT_BENCH_PATH, &st);
+    printf("  Image:        %.1f MB, %.1f MB on disk (%.0f bytes per process)\n", st.st_size / 1e6,
+           st.st_blocks * 512 / 1e6, st.st_blocks * 512.0 / CKPT_BENCH_PROCS);
+    printf("  Pause:        %.2f ms (fork)\n", ck.pause_us / 1e3);
+    printf("  Write:        %.0f ms in the child, %ld updates applied meanwhile\n", ck.write_ms, updates);
+
+    // Restart: drop everything and restore from the image
+    checkpoint_free(&ck);
+    multires_free(&mr);
+    alert_filter_free(&alerts);
+    process_table_free(&table);
+
+    CheckpointImage image;
+    long restored_tick = 0;
+    uint64_t start = now_ns();
+    long restored = checkpoint_map(CKPT_BENCH_PATH, &image, &table, &alerts, &mr, &restored_tick);
+    double restore_ms = (now_ns() - start) / 1e6;
+    if (restored < 0) {
+        fprintf(stderr, "Restore failed\n");
+        unlink(CKPT_BENCH_PATH);
+        return 1;
+    }
+    printf("  Restore:      %.2f ms for %ld processes\n", restore_ms, restored);
+
+    // Pages are read in as they are used; time one pass over all of them
+    start = now_ns();
+    int exact = restored == CKPT_BENCH_PROCS && restored_tick == tick &&
+                checkpoint_bench_digest(&table, &alerts, &mr) == digest;
+    printf("  First scan:   %.0f ms to touch every restored process\n", (now_ns() - start) / 1e6);
+    printf("  Exact:        %s\n", exact ? "yes (matches the state at the fork)" : "NO");
+
+    unlink(CKPT_BENCH_PATH);
+    checkpoint_unmap(&image, &table, &alerts, &mr);
+    return exact ? 0 : 1;
+}
+
+typedef struct {
+    NumaScorer *ns;
+    const NumaTopology *topo;         // Topology the ingest thread runs on
+    int node;
+    int queue;                        // Node whose workers score the samples
+    const ProcessBehavior *source;
+    ProcessBehavior *samples;         // Node-local copy of source
+    double *scores;
+} NumaIngest;
+
+// Copy the samples into memory first touched on the node, as a collector
+// on that node would produce them
+void* numa_bench_prepare(void *arg) {
+    NumaIngest *in = (NumaIngest*)arg;
+    numa_run_on_node(in->topo, in->node);
+    in->samples = (ProcessBehavior*)malloc(NUMA_BENCH_SAMPLES * sizeof(ProcessBehavior));
+    in->scores = (double*)malloc(NUMA_BENCH_SAMPLES * sizeof(double));
+    memcpy(in->samples, in->source, NUMA_BENCH_SAMPLES * sizeof(ProcessBehavior));
+    memset(in->scores, 0, NUMA_BENCH_SAMPLES * sizeof(double));
+    return NULL;
+}
+
+void* numa_bench_ingest(void *arg) {
+    NumaIngest *in = (NumaIngest*)arg;
+    numa_run_on_node(in->topo, in->node);
+    numa_scorer_submit(in->ns, in->queue, in->samples, NUMA_BENCH_SAMPLES, in->scores);
+    return NULL;
+}
+
+// Scoring throughput with one shared forest, with per-node replicas read
+// by their own node, and with replicas read from the next node over
+int bench_numa(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    CompactForest model;
+    compact_forest_build(&model, forest);
+
+    NumaTopology topo;
+    numa_detect(&topo);
+    int real_nodes = topo.num_nodes;
+    if (topo.num_nodes < 2) numa_fake(&topo, 2);
+    NumaTopology shared = topo;
+    shared.num_nodes = 1;
+    shared.fake = 1;
+    for (int node = 1; node < topo.num_nodes; node++) CPU_OR(&shared.cpus[0], &shared.cpus[0], &topo.cpus[node]);
+    shared.num_cpus[0] = CPU_COUNT(&shared.cpus[0]);
+
+    printf("\n[NUMA] %d node(s) detected", real_nodes);
+    if (topo.fake) printf(", split into %d fake nodes (same memory, so only overhead shows)", topo.num_nodes);
+    printf("\n[NUMA] %d samples per node per round, %d rounds\n\n", NUMA_BENCH_SAMPLES, NUMA_BENCH_ROUNDS);
+    for (int node = 0; node < topo.num_nodes; node++) {
+        printf("  Node %d: %d CPUs\n", node, topo.num_cpus[node]);
+    }
+    printf("\n  %-22s %10s %14s %14s\n", "Placement", "Workers", "M samples/s", "Score sum");
+
+    ProcessBehavior *source = (ProcessBehavior*)malloc(NUMA_BENCH_SAMPLES * sizeof(ProcessBehavior));
+    for (int i = 0; i < NUMA_BENCH_SAMPLES; i++) {
+        if (i % 20 == 0) generate_anomalous_behavior(&source[i], "sample");
+        else generate_normal_behavior(&source[i], "sample");
+    }
+    NumaIngest ingest[NUMA_MAX_NODES];
+    pthread_t tids[NUMA_MAX_NODES];
+    for (int node = 0; node < topo.num_nodes; node++) {
+        ingest[node] = (NumaIngest){NULL, &topo, node, node, source, NULL, NULL};
+        pthread_create(&tids[node], NULL, numa_bench_prepare, &ingest[node]);
+    }
+    for (int node = 0; node < topo.num_nodes; node++) pthread_join(tids[node], NULL);
+
+    const char *names[] = {"shared forest", "local replica", "remote replica"};
+    double sums[3] = {0};
+    for (int mode = 0; mode < 3; mode++) {
+        const NumaTopology *placement = mode == 0 ? &shared : &topo;
+        int workers = 0;
+        for (int node = 0; node < placement->num_nodes; node++) workers += placement->num_cpus[node];
+        NumaScorer ns;
+        int per_node = workers / placement->num_nodes > 0 ? workers / placement->num_nodes : 1;
+        if (numa_scorer_start(&ns, placement, &model, per_node, mode == 2) != 0) {
+            fprintf(stderr, "Failed to replicate the model\n");
+            return 1;
+        }
+
+        uint64_t start = now_ns();
+        for (int round = 0; round < NUMA_BENCH_ROUNDS; round++) {
+            for (int node = 0; node < topo.num_nodes; node++) {
+                ingest[node].ns = &ns;
+                ingest[node].queue = mode == 0 ? 0 : node;
+                pthread_create(&tids[node], NULL, numa_bench_ingest, &ingest[node]);
+            }
+            for (int node = 0; node < topo.num_nodes; node++) pthread_join(tids[node], NULL);
+        }
+        numa_scorer_stop(&ns);
+        uint64_t elapsed = now_ns() - start;
+
+        for (int node = 0; node < topo.num_nodes; node++) {
+            for (int i = 0; i < NUMA_BENCH_SAMPLES; i++) sums[mode] += ingest[node].scores[i];
+        }
+        double total = (double)NUMA_BENCH_SAMPLES * topo.num_nodes * NUMA_BENCH_ROUNDS;
+        printf("  %-22s %10d %14.2f %14.4f\n", names[mode], ns.num_workers, total * 1e3 / elapsed, sums[mode]);
+    }
+
+    for (int node = 0; node < topo.num_nodes; node++) {
+        free(ingest[node].samples);
+        free(ingest[node].scores);
+    }
+    free(source);
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    return sums[0] == sums[1] && sums[1] == sums[2] ? 0 : 1;
+}
+
+// Count data TLB read misses of the calling thread; -1 if the kernel or
+// hypervisor does not expose the counter
+int tlb_counter_open(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void tlb_counter_start(int fd) {
+    if (fd < 0) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+// Misses since tlb_counter_start(), or -1
+long tlb_counter_stop(int fd) {
+    if (fd < 0) return -1;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    long long count;
+    return read(fd, &count, sizeof(count)) == (ssize_t)sizeof(count) ? (long)count : -1;
+}
+
+void huge_bench_print(const char *stage, const char *backing, double ms, long misses, long ops) {
+    char rate[32] = "n/a";
+    if (misses >= 0) snprintf(rate, sizeof(rate), "%.3f", (double)misses / ops);
+    printf("  %-8s %-24s %10.1f %16s\n", stage, backing, ms, rate);
+}
+
+// Tree building and scoring over a large dataset, with the dataset and
+// model on normal pages and on the largest huge pages available
+int bench_hugepages(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    ProcessBehavior base[4096];
+    for (int i = 0; i < 4096; i++) {
+        if (i % 20 == 0) generate_anomalous_behavior(&base[i], "sample");
+        else generate_normal_behavior(&base[i], "sample");
+    }
+    int *order = (int*)malloc(HUGE_BENCH_SAMPLES * sizeof(int));
+    for (int i = 0; i < HUGE_BENCH_SAMPLES; i++) order[i] = i;
+    for (int i = HUGE_BENCH_SAMPLES - 1; i > 0; i--) {
+        int j = rand() % (i + 1), t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    int tlb = tlb_counter_open();
+
+    printf("\n[HUGEPAGES] %d samples (%.0f MB), %d trees of %d random samples, scoring in random order\n",
+           HUGE_BENCH_SAMPLES, HUGE_BENCH_SAMPLES * sizeof(ProcessBehavior) / 1e6, HUGE_BENCH_TREES,
+           HUGE_BENCH_SUBSAMPLE);
+    if (tlb < 0) printf("[HUGEPAGES] dTLB miss counter unavailable (%s)\n", strerror(errno));
+    printf("\n  %-8s %-24s %10s %16s\n", "Stage", "Backing", "ms", "dTLB misses/op");
+
+    PageBacking requested[] = {PAGES_DEFAULT, PAGES_HUGE_1GB};
+    double checksums[2] = {0};
+    PageBacking model_backing[2];
+    for (int run = 0; run < 2; run++) {
+        HugeRegion region;
+        if (huge_region_alloc(&region, HUGE_BENCH_SAMPLES * sizeof(ProcessBehavior), requested[run]) != 0) {
+            fprintf(stderr, "Failed to map the dataset\n");
+            return 1;
+        }
+        ProcessBehavior *data = (ProcessBehavior*)region.base;
+        for (int i = 0; i < HUGE_BENCH_SAMPLES; i++) data[i] = base[i % 4096];
+        char backing[64];
+        snprintf(backing, sizeof(backing), "%s", page_backing_names[region.backing]);
+        if (region.backing == PAGES_THP) {
+            long thp = huge_region_thp_bytes(&region);
+            if (thp >= 0) snprintf(backing, sizeof(backing), "THP (%.0f%% huge)", 100.0 * thp / region.size);
+        }
+
+        // Tree building: each split scans the node's samples at random rows
+        hids_train_options options;
+        hids_train_options_default(&options);
+        options.num_features = MAX_SYSCALLS;
+        options.num_trees = HUGE_BENCH_TREES;
+        options.subsample_size = HUGE_BENCH_SUBSAMPLE;
+        options.max_depth = MAX_TREE_DEPTH;
+        options.seed = 7;
+        hids_model *trees = NULL;
+        tlb_counter_start(tlb);
+        uint64_t start = now_ns();
+        hids_train(&data[0].syscall_freq[0], HUGE_BENCH_SAMPLES, BEHAVIOR_STRIDE, &options, &trees);
+        double build_ms = (now_ns() - start) / 1e6;
+        huge_bench_print("Build", backing, build_ms, tlb_counter_stop(tlb),
+                         (long)HUGE_BENCH_TREES * HUGE_BENCH_SUBSAMPLE);
+        hids_model_free(trees);
+
+        // Scoring: the model follows the dataset's page request
+        model_pages = requested[run];
+        CompactForest model;
+        compact_forest_build(&model, forest);
+        model_pages = PAGES_DEFAULT;
+        tlb_counter_start(tlb);
+        start = now_ns();
+        for (int i = 0; i < HUGE_BENCH_SAMPLES; i++) checksums[run] += compact_anomaly_score(&model, &data[order[i]]);
+        double score_ms = (now_ns() - start) / 1e6;
+        huge_bench_print("Score", backing, score_ms, tlb_counter_stop(tlb), HUGE_BENCH_SAMPLES);
+        model_backing[run] = model.region.base != NULL ? model.region.backing : PAGES_DEFAULT;
+
+        compact_forest_free(&model);
+        huge_region_free(&region);
+    }
+
+    printf("\n  Model arena: %s, then %s\n", page_backing_names[model_backing[0]],
+           page_backing_names[model_backing[1]]);
+    if (tlb >= 0) close(tlb);
+    free(order);
+    free_forest(forest);
+    free(training_data);
+    return checksums[0] == checksums[1] ? 0 : 1;
+}
+
+typedef struct {
+    CpuBudget *budget;
+    ProcessBehavior *data;
+    volatile int stop;
+    long trees;
+    int idle;                         // SCHED_IDLE was granted
+} BudgetTrainer;
+
+// Background retraining: builds trees at idle priority whenever the
+// budget allows it
+void* budget_bench_trainer(void *arg) {
+    BudgetTrainer *tr = (BudgetTrainer*)arg;
+    tr->idle = cpu_budget_idle_thread() == 0;
+    hids_train_options options;
+    hids_train_options_default(&options);
+    options.num_features = MAX_SYSCALLS;
+    options.num_trees = 1;
+    options.subsample_size = BENCH_TRAIN_SIZE;
+    options.max_depth = MAX_TREE_DEPTH;
+    struct timespec pause = {0, BUDGET_BENCH_TICK_MS * 1000000L};
+    while (!tr->stop) {
+        if (!cpu_budget_allow_training(tr->budget)) {
+            nanosleep(&pause, NULL);
+            continue;
+        }
+        uint64_t start = cpu_budget_stage_start();
+        hids_model *tree = NULL;
+        options.seed = tr->trees + 1;
+        hids_train(&tr->data[0].syscall_freq[0], BENCH_TRAIN_SIZE, BEHAVIOR_STRIDE, &options, &tree);
+        hids_model_free(tree);
+        cpu_budget_charge(tr->budget, BUDGET_TRAINING, start);
+        tr->trees++;
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+// Synthetic overload against a 5% CPU budget: a light stream, then one
+// that would need more than a whole CPU to process in full
+int bench_budget(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    CompactForest model;
+    compact_forest_build(&model, forest);
+    RescoreTriggers triggers;
+    rescore_triggers_from_training(&triggers, training_data, BENCH_TRAIN_SIZE);
+
+    ProcessBehavior profiles[2];
+    generate_normal_behavior(&profiles[0], "normal");
+    generate_anomalous_behavior(&profiles[1], "anomalous");
+    SyscallEvent *events = (SyscallEvent*)malloc(BUDGET_BENCH_EVENTS * sizeof(SyscallEvent));
+    for (int i = 0; i < BUDGET_BENCH_EVENTS; i++) {
+        events[i].pid = 1 + rand() % BUDGET_BENCH_PROCS;
+        events[i].syscall = sample_syscall(&profiles[events[i].pid % 50 == 0]);
+    }
+
+    ProcessTable table;
+    RescoreScheduler sched;
+    SyscallSampler sampler;
+    CpuBudget budget;
+    process_table_init(&table, BUDGET_BENCH_PROCS);
+    rescore_scheduler_init(&sched, &table, &triggers);
+    sampler_init(&sampler, SAMPLING_GLOBAL, 0);
+    cpu_budget_init(&budget, CPU_BUDGET_PERCENT, &sched, &sampler);
+    budget.verbose = 1;
+
+    printf("\n[BUDGET] %.1f%% of %.2f CPUs; %d events/tick for %d ms, then %d events/tick; %d ms ticks\n\n",
+           CPU_BUDGET_PERCENT, budget.cgroup_cpus, BUDGET_BENCH_LIGHT, BUDGET_BENCH_LIGHT_MS,
+           BUDGET_BENCH_HEAVY, BUDGET_BENCH_TICK_MS);
+
+    BudgetTrainer trainer = {&budget, training_data, 0, 0, 0};
+    pthread_t trainer_tid;
+    pthread_create(&trainer_tid, NULL, budget_bench_trainer, &trainer);
+
+    uint64_t start = now_ns(), next_tick = start;
+    long cursor = 0, offered = 0, recorded = 0, scored = 0;
+    double overload_usage = 0, peak_usage = 0;
+    int overload_windows = 0;
+    for (;;) {
+        uint64_t now = now_ns();
+        long ms = (long)((now - start) / 1000000);
+        if (ms >= BUDGET_BENCH_MS) break;
+        int count = ms < BUDGET_BENCH_LIGHT_MS ? BUDGET_BENCH_LIGHT : BUDGET_BENCH_HEAVY;
+        offered += count;
+
+        // Events are offered whether or not they are kept; replay them
+        // from the pre-generated stream in slices
+        uint64_t stage = cpu_budget_stage_start();
+        for (int done = 0; done < count; ) {
+            int n = count - done < BUDGET_BENCH_EVENTS - (int)cursor ? count - done : BUDGET_BENCH_EVENTS - (int)cursor;
+            EventBatch batch = {events + cursor, n, read_tsc()};
+            recorded += collect_events(&table, &sched, &sampler, &batch);
+            cursor = (cursor + n) % BUDGET_BENCH_EVENTS;
+            done += n;
+        }
+        cpu_budget_charge(&budget, BUDGET_COLLECTION, stage);
+
+        stage = cpu_budget_stage_start();
+        scored += rescore_run_tick(&sched, &model, NULL, NULL);
+        cpu_budget_charge(&budget, BUDGET_SCORING, stage);
+
+        long windows = budget.windows;
+        cpu_budget_update(&budget);
+        if (budget.windows != windows && ms >= BUDGET_BENCH_LIGHT_MS + 1000) {
+            overload_usage += budget.usage;
+            if (budget.usage > peak_usage) peak_usage = budget.usage;
+            overload_windows++;
+        }
+
+        next_tick += BUDGET_BENCH_TICK_MS * 1000000ull;
+        struct timespec until = {(time_t)(next_tick / 1000000000ull), (long)(next_tick % 1000000000ull)};
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL);
+    }
+    trainer.stop = 1;
+    pthread_join(trainer_tid, NULL);
+
+    printf("\n  Offered:      %ld events, %ld recorded (1 in %d sampled at the end)\n", offered, recorded,
+           sampler.period);
+    printf("  Scored:       %ld, slow sweep every %d ticks, %d per tick at the end\n", scored,
+           sched.triggers.slow_ticks, sched.score_budget);
+    printf("  Retraining:   %ld trees%s\n", trainer.trees, trainer.idle ? " at SCHED_IDLE" : "");
+    cpu_budget_print(&budget);
+    double mean = overload_windows ? overload_usage / overload_windows : 0;
+    printf("  Overload:     mean %.2f%% of a CPU, peak window %.2f%% (from 1 s into the overload)\n",
+           mean * 100, peak_usage * 100);
+
+    rescore_scheduler_free(&sched);
+    process_table_free(&table);
+    free(events);
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    return mean <= budget.budget_cpus * 1.1 ? 0 : 1;
+}
+
+// Startup calibration of the scoring kernel, cold and from the cache
+int bench_autotune(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    IsolationForest *forest = bench_train_forest(training_data, BENCH_TRAIN_SIZE);
+    CompactForest model;
+    compact_forest_build(&model, forest);
+    char cache[512];
+    autotune_cache_path(cache, sizeof(cache), "hids_bench_autotune");
+    unlink(cache);
+
+    printf("\n[AUTOTUNE] %d synthetic samples, fastest of %d rounds per candidate\n\n",
+           AUTOTUNE_SAMPLES, AUTOTUNE_ROUNDS);
+    ScoringPlan results[NUM_KERNELS + 8];
+    int num_results;
+    uint64_t start = now_ns();
+    ScoringPlan cold = autotune_scoring(forest, &model, cache, results, &num_results);
+    double cold_ms = (now_ns() - start) / 1e6;
+    start = now_ns();
+    ScoringPlan warm = autotune_scoring(forest, &model, cache, NULL, NULL);
+    double warm_ms = (now_ns() - start) / 1e6;
+
+    printf("\n  %-12s %8s %14s\n", "Kernel", "Batch", "ns/sample");
+    for (int i = 0; i < num_results; i++) {
+        printf("  %-12s %8d %14.1f%s\n", score_kernel_names[results[i].kernel], results[i].batch,
+               results[i].ns_per_sample, results[i].kernel == cold.kernel && results[i].batch == cold.batch ?
+               "  <- picked" : "");
+    }
+    printf("\n  Calibration:  %.1f ms cold, %.2f ms from the cache\n", cold_ms, warm_ms);
+
+    // Every kernel must agree on the scores
+    ProcessBehavior *samples = (ProcessBehavior*)malloc(AUTOTUNE_SAMPLES * sizeof(ProcessBehavior));
+    double *expected = (double*)malloc(AUTOTUNE_SAMPLES * sizeof(double));
+    double *scores = (double*)malloc(AUTOTUNE_SAMPLES * sizeof(double));
+    autotune_samples(samples, AUTOTUNE_SAMPLES);
+    ScoringPlan reference = {KERNEL_LIBHIDS, 1, 0, 0};
+    score_with_plan(&reference, forest, &model, samples, AUTOTUNE_SAMPLES, expected);
+    double max_diff = 0;
+    for (int i = 0; i < num_results; i++) {
+        score_with_plan(&results[i], forest, &model, samples, AUTOTUNE_SAMPLES, scores);
+        for (int j = 0; j < AUTOTUNE_SAMPLES; j++) {
+            if (fabs(scores[j] - expected[j]) > max_diff) max_diff = fabs(scores[j] - expected[j]);
+        }
+    }
+    printf("  Agreement:    max score difference %.2e across kernels\n", max_diff);
+
+    unlink(cache);
+    free(samples);
+    free(expected);
+    free(scores);
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    return warm.cached && warm.kernel == cold.kernel && warm.batch == cold.batch && max_diff < 1e-9 ? 0 : 1;
+}
+
+// Score one batch by spawning "hids --score", as agents did before libhids
+int score_subprocess(const char *model_path, const int32_t *rows, size_t n, double *scores) {
+    int to_child[2], from_child[2];
+    if (pipe(to_child) != 0) return -1;
+    if (pipe(from_child) != 0) {
+        close(to_child[0]);
+        close(to_child[1]);
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(to_child[0], STDIN_FILENO);
+        dup2(from_child[1], STDOUT_FILENO);
+        close(to_child[0]);
+        close(to_child[1]);
+        close(from_child[0]);
+        close(from_child[1]);
+        execl("/proc/self/exe", "hids", "--score", model_path, (char*)NULL);
+        _exit(127);
+    }
+    close(to_child[0]);
+    close(from_child[1]);
+
+    // The child reads all of stdin before writing, so the pipes cannot deadlock
+    int ok = pid > 0;
+    size_t bytes = n * MAX_SYSCALLS * sizeof(int32_t);
+    for (size_t done = 0; ok && done < bytes;) {
+        ssize_t w = write(to_child[1], (const char*)rows + done, bytes - done);
+        if (w <= 0) ok = 0;
+        else done += w;
+    }
+    close(to_child[1]);
+    bytes = n * sizeof(double);
+    size_t done = 0;
+    while (ok && done < bytes) {
+        ssize_t r = read(from_child[0], (char*)scores + done, bytes - done);
+        if (r <= 0) ok = 0;
+        else done += r;
+    }
+    close(from_child[0]);
+    int status = 0;
+    if (pid > 0) waitpid(pid, &status, 0);
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+// libhids scoring linked in-process vs one subprocess per batch
+int bench_libhids(void) {
+    srand(42);
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(BENCH_TRAIN_SIZE * sizeof(ProcessBehavior));
+    for (int i = 0; i < BENCH_TRAIN_SIZE; i++) generate_normal_behavior(&training_data[i], "train");
+    hids_train_options options;
+    hids_train_options_default(&options);
+    options.num_features = MAX_SYSCALLS;
+    options.num_trees = NUM_TREES;
+    options.subsample_size = SUBSAMPLE_SIZE;
+    options.max_depth = MAX_TREE_DEPTH;
+    options.seed = 42;
+    hids_model *model = NULL;
+    hids_status status = hids_train(&training_data[0].syscall_freq[0], BENCH_TRAIN_SIZE,
+                                    BEHAVIOR_STRIDE, &options, &model);
+    if (status == HIDS_OK) status = hids_save(model, LIBHIDS_BENCH_MODEL);
+    if (status != HIDS_OK) {
+        fprintf(stderr, "[LIBHIDS] model: %s\n", hids_strerror(status));
+        hids_model_free(model);
+        free(training_data);
+        return 1;
+    }
+
+    // Agents send dense rows of counts
+    ProcessBehavior *samples = (ProcessBehavior*)malloc(LIBHIDS_BENCH_SAMPLES * sizeof(ProcessBehavior));
+    int32_t *rows = (int32_t*)malloc(LIBHIDS_BENCH_SAMPLES * MAX_SYSCALLS * sizeof(int32_t));
+    double *expected = (double*)malloc(LIBHIDS_BENCH_SAMPLES * sizeof(double));
+    double *scores = (double*)malloc(LIBHIDS_BENCH_SAMPLES * sizeof(double));
+    autotune_samples(samples, LIBHIDS_BENCH_SAMPLES);
+    for (int i = 0; i < LIBHIDS_BENCH_SAMPLES; i++) {
+        memcpy(&rows[i * MAX_SYSCALLS], samples[i].syscall_freq, MAX_SYSCALLS * sizeof(int32_t));
+    }
+    hids_score_batch(model, rows, LIBHIDS_BENCH_SAMPLES, MAX_SYSCALLS, expected);
+
+    printf("\n[LIBHIDS] %d trees, %d samples in-process, %d subprocess batches per size\n\n",
+           NUM_TREES, LIBHIDS_BENCH_SAMPLES, LIBHIDS_BENCH_SPAWNS);
+    printf("  %8s %18s %18s %10s\n", "Batch", "In-process ns/smp", "Subprocess ns/smp", "Speedup");
+    int batch_sizes[] = {1, 16, 64, 256, 1024};
+    int failures = 0;
+    for (size_t b = 0; b < sizeof(batch_sizes) / sizeof(batch_sizes[0]); b++) {
+        int batch = batch_sizes[b];
+        uint64_t start = now_ns();
+        for (int i = 0; i < LIBHIDS_BENCH_SAMPLES; i += batch) {
+            hids_score_batch(model, &rows[i * MAX_SYSCALLS], batch, MAX_SYSCALLS, &scores[i]);
+        }
+        double inproc = (double)(now_ns() - start) / LIBHIDS_BENCH_SAMPLES;
+
+        // Subprocess batches cycle through the samples
+        int scored = 0;
+        start = now_ns();
+        for (int k = 0; k < LIBHIDS_BENCH_SPAWNS; k++) {
+            int offset = (k * batch) % LIBHIDS_BENCH_SAMPLES;
+            if (score_subprocess(LIBHIDS_BENCH_MODEL, &rows[offset * MAX_SYSCALLS], batch, &scores[offset]) != 0) {
+                failures++;
+            }
+            scored += batch;
+        }
+        double spawned = (double)(now_ns() - start) / scored;
+        for (int i = 0; i < LIBHIDS_BENCH_SAMPLES; i++) {
+            if (scores[i] != expected[i]) failures++;
+        }
+        printf("  %8d %18.1f %18.1f %9.0fx\n", batch, inproc, spawned, spawned / inproc);
+    }
+    printf("\n  Agreement:    %d mismatched or failed batches\n", failures);
+
+    unlink(LIBHIDS_BENCH_MODEL);
+    hids_model_free(model);
+    free(samples);
+    free(rows);
+    free(expected);
+    free(scores);
+    free(training_data);
+    return failures == 0 ? 0 : 1;
+}
+
+// Mean score of the normal and anomalous held-out rows
+void shard_bench_scores(const hids_model *model, const int32_t *rows, const int *is_anomaly, double *normal,
+                        double *anomalous) {
+    double scores[SHARD_BENCH_TEST];
+    hids_score_batch(model, rows, SHARD_BENCH_TEST, MAX_SYSCALLS, scores);
+    int counts[2] = {0, 0};
+    double sums[2] = {0, 0};
+    for (int i = 0; i < SHARD_BENCH_TEST; i++) {
+        sums[is_anomaly[i]] += scores[i];
+        counts[is_anomaly[i]]++;
+    }
+    *normal = counts[0] ? sums[0] / counts[0] : 0;
+    *anomalous = counts[1] ? sums[1] / counts[1] : 0;
+}
+
+// Training time with 1 to 8 worker processes, each loading its own shard
+int bench_sharded(void) {
+    srand(42);
+    int32_t *rows = (int32_t*)malloc((size_t)SHARD_BENCH_ROWS * MAX_SYSCALLS * sizeof(int32_t));
+    int32_t *test = (int32_t*)malloc(SHARD_BENCH_TEST * MAX_SYSCALLS * sizeof(int32_t));
+    int *is_anomaly = (int*)malloc(SHARD_BENCH_TEST * sizeof(int));
+    ProcessBehavior p;
+    for (int i = 0; i < SHARD_BENCH_ROWS; i++) {
+        generate_normal_behavior(&p, "train");
+        memcpy(&rows[(size_t)i * MAX_SYSCALLS], p.syscall_freq, MAX_SYSCALLS * sizeof(int32_t));
+    }
+    for (int i = 0; i < SHARD_BENCH_TEST; i++) {
+        is_anomaly[i] = i % 10 == 0;
+        if (is_anomaly[i]) generate_anomalous_behavior(&p, "test");
+        else generate_normal_behavior(&p, "test");
+        memcpy(&test[i * MAX_SYSCALLS], p.syscall_freq, MAX_SYSCALLS * sizeof(int32_t));
+    }
+
+    hids_train_options options;
+    hids_train_options_default(&options);
+    options.num_features = MAX_SYSCALLS;
+    options.num_trees = SHARD_BENCH_TREES;
+    options.subsample_size = SHARD_BENCH_SUBSAMPLE;
+    options.max_depth = MAX_TREE_DEPTH;
+    options.seed = 42;
+
+    printf("\n[SHARDED] %d rows (%zu MB), %d trees of %d samples, %ld CPUs\n\n", SHARD_BENCH_ROWS,
+           (size_t)SHARD_BENCH_ROWS * MAX_SYSCALLS * sizeof(int32_t) >> 20, SHARD_BENCH_TREES,
+           SHARD_BENCH_SUBSAMPLE, sysconf(_SC_NPROCESSORS_ONLN));
+    hids_model *central = NULL;
+    uint64_t start = now_ns();
+    hids_train(rows, SHARD_BENCH_ROWS, MAX_SYSCALLS, &options, &central);
+    double central_ms = (now_ns() - start) / 1e6;
+    double normal, anomalous;
+    shard_bench_scores(central, test, is_anomaly, &normal, &anomalous);
+    printf("  %-9s %10s %12s %12s %8s %14s %14s\n", "Workers", "Wall ms", "Max load ms", "Max train ms", "Trees",
+           "Normal score", "Attack score");
+    printf("  %-9s %10.1f %12s %12.1f %8u %14.4f %14.4f\n", "in-memory", central_ms, "-", central_ms,
+           hids_model_trees(central), normal, anomalous);
+
+    int failures = 0;
+    int worker_counts[] = {1, 2, 4, 8};
+    char socket_path[64], shard_path[64];
+    snprintf(socket_path, sizeof(socket_path), "%s.sock", SHARD_BENCH_PATH);
+    for (size_t c = 0; c < sizeof(worker_counts) / sizeof(worker_counts[0]); c++) {
+        int workers = worker_counts[c];
+
+        // Even shards; each worker starts by reading its own from disk
+        for (int w = 0; w < workers; w++) {
+            size_t first = (size_t)SHARD_BENCH_ROWS * w / workers, last = (size_t)SHARD_BENCH_ROWS * (w + 1) / workers;
+            snprintf(shard_path, sizeof(shard_path), "%s.%d", SHARD_BENCH_PATH, w);
+            int fd = open(shard_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+            if (fd < 0 || write_all(fd, (const char*)&rows[first * MAX_SYSCALLS],
+                                    (last - first) * MAX_SYSCALLS * sizeof(int32_t)) != 0) {
+                failures++;
+            }
+            if (fd >= 0) close(fd);
+        }
+
+        int listen_fd = shard_listen(socket_path);
+        pid_t pids[SHARD_MAX_WORKERS];
+        start = now_ns();
+        for (int w = 0; w < workers; w++) {
+            snprintf(shard_path, sizeof(shard_path), "%s.%d", SHARD_BENCH_PATH, w);
+            pids[w] = fork();
+            if (pids[w] == 0) {
+                execl("/proc/self/exe", "hids", "--train-worker", socket_path, shard_path, (char*)NULL);
+                _exit(127);
+            }
+        }
+        ShardWorkerStats stats[SHARD_MAX_WORKERS];
+        hids_model *merged = NULL;
+        hids_status status = listen_fd >= 0 ? shard_coordinate(listen_fd, workers, &options, &merged, stats) :
+                             HIDS_ERR_IO;
+        double wall_ms = (now_ns() - start) / 1e6;
+        for (int w = 0; w < workers; w++) {
+            int code;
+            if (pids[w] > 0) waitpid(pids[w], &code, 0);
+            snprintf(shard_path, sizeof(shard_path), "%s.%d", SHARD_BENCH_PATH, w);
+            unlink(shard_path);
+        }
+        if (listen_fd >= 0) close(listen_fd);
+        unlink(socket_path);
+        if (status != HIDS_OK || hids_model_trees(merged) != SHARD_BENCH_TREES) {
+            printf("  %-9d failed: %s\n", workers, hids_strerror(status));
+            failures++;
+            hids_model_free(merged);
+            continue;
+        }
+
+        uint64_t max_load = 0, max_train = 0;
+        for (int w = 0; w < workers; w++) {
+            if (stats[w].load_ns > max_load) max_load = stats[w].load_ns;
+            if (stats[w].train_ns > max_train) max_train = stats[w].train_ns;
+        }
+        shard_bench_scores(merged, test, is_anomaly, &normal, &anomalous);
+        printf("  %-9d %10.1f %12.1f %12.1f %8u %14.4f %14.4f\n", workers, wall_ms, max_load / 1e6,
+               max_train / 1e6, hids_model_trees(merged), normal, anomalous);
+        hids_model_free(merged);
+    }
+    printf("\n  Wall time covers spawning the workers, loading shards, training and merging.\n");
+
+    hids_model_free(central);
+    free(rows);
+    free(test);
+    free(is_anomaly);
+    return failures == 0 ? 0 : 1;
+}
+
+// Score the held-out rows with one model and print a row of the merge table
+void merge_bench_row(const char *name, const hids_model *model, const int32_t *test, const int *is_anomaly,
+                     const double *reference, double *scores) {
+    uint64_t start = now_ns();
+    hids_score_batch(model, test, MERGE_BENCH_TEST, MAX_SYSCALLS, scores);
+    double ns = (double)(now_ns() - start) / MERGE_BENCH_TEST;
+
+    ScoredSample samples[MERGE_BENCH_TEST];
+    double diff = 0;
+    for (int i = 0; i < MERGE_BENCH_TEST; i++) {
+        samples[i] = (ScoredSample){scores[i], is_anomaly[i]};
+        if (reference != NULL) diff += fabs(scores[i] - reference[i]);
+    }
+    printf("  %-22s %6u %10.1f %8.4f", name, hids_model_trees(model), ns, compute_auc(samples, MERGE_BENCH_TEST));
+    if (reference != NULL) printf(" %14.4f\n", diff / MERGE_BENCH_TEST);
+    else printf(" %14s\n", "-");
+}
+
+// Host forests with different subsample sizes merged by tree union and by
+// weighted ensemble, against a forest trained centrally on all the data
+int bench_merge(void) {
+    srand(42);
+    static const struct {
+        const char *host;
+        int rows;
+        uint32_t subsample;
+        uint32_t trees;
+    } hosts[MERGE_BENCH_HOSTS] = {
+        {"web-01", 20000, 64, 100},
+        {"web-02", 50000, 128, 100},
+        {"db-01", 100000, 256, 200},
+        {"build-01", 30000, 512, 50},
+    };
+    int total_rows = 0;
+    uint32_t total_trees = 0;
+    for (int h = 0; h < MERGE_BENCH_HOSTS; h++) {
+        total_rows += hosts[h].rows;
+        total_trees += hosts[h].trees;
+    }
+    int32_t *rows = (int32_t*)malloc((size_t)total_rows * MAX_SYSCALLS * sizeof(int32_t));
+    int32_t *test = (int32_t*)malloc(MERGE_BENCH_TEST * MAX_SYSCALLS * sizeof(int32_t));
+    int *is_anomaly = (int*)malloc(MERGE_BENCH_TEST * sizeof(int));
+    double *reference = (double*)malloc(MERGE_BENCH_TEST * sizeof(double));
+    double *scores = (double*)malloc(MERGE_BENCH_TEST * sizeof(double));
+    ProcessBehavior p;
+    for (int i = 0; i < total_rows; i++) {
+        generate_normal_behavior(&p, "train");
+        memcpy(&rows[(size_t)i * MAX_SYSCALLS], p.syscall_freq, MAX_SYSCALLS * sizeof(int32_t));
+    }
+    for (int i = 0; i < MERGE_BENCH_TEST; i++) {
+        is_anomaly[i] = i % 10 == 0;
+        if (is_anomaly[i]) generate_anomalous_behavior(&p, "test");
+        else generate_normal_behavior(&p, "test");
+        memcpy(&test[i * MAX_SYSCALLS], p.syscall_freq, MAX_SYSCALLS * sizeof(int32_t));
+    }
+
+    hids_train_options options;
+    hids_train_options_default(&options);
+    options.num_features = MAX_SYSCALLS;
+    options.max_depth = MAX_TREE_DEPTH;
+    options.seed = 42;
+    options.num_trees = total_trees;
+    options.subsample_size = 256;
+    hids_model *central = NULL;
+    hids_train(rows, total_rows, MAX_SYSCALLS, &options, &central);
+
+    // Each host trains on its own rows only
+    hids_model *models[MERGE_BENCH_HOSTS];
+    hids_merge_input inputs[MERGE_BENCH_HOSTS];
+    int first = 0;
+    for (int h = 0; h < MERGE_BENCH_HOSTS; h++) {
+        options.num_trees = hosts[h].trees;
+        options.subsample_size = hosts[h].subsample;
+        options.seed = 43 + h;
+        models[h] = NULL;
+        hids_train(&rows[(size_t)first * MAX_SYSCALLS], hosts[h].rows, MAX_SYSCALLS, &options, &models[h]);
+        inputs[h] = (hids_merge_input){models[h], hosts[h].host, (double)hosts[h].rows};
+        first += hosts[h].rows;
+    }
+    hids_model *merged[2] = {NULL, NULL};
+    hids_status status = hids_merge_forests(inputs, MERGE_BENCH_HOSTS, HIDS_MERGE_UNION, &merged[0]);
+    if (status == HIDS_OK) status = hids_merge_forests(inputs, MERGE_BENCH_HOSTS, HIDS_MERGE_WEIGHTED, &merged[1]);
+
+    printf("\n[MERGE] %d hosts, %d training rows, %d held-out samples\n\n", MERGE_BENCH_HOSTS, total_rows,
+           MERGE_BENCH_TEST);
+    printf("  %-22s %6s %10s %8s %14s\n", "Model", "Trees", "ns/sample", "AUC", "|diff| central");
+    merge_bench_row("central (256 samples)", central, test, is_anomaly, NULL, reference);
+    for (int h = 0; h < MERGE_BENCH_HOSTS; h++) {
+        char name[64];
+        snprintf(name, sizeof(name), "%s alone (%u)", hosts[h].host, hosts[h].subsample);
+        merge_bench_row(name, models[h], test, is_anomaly, reference, scores);
+    }
+    int failures = status != HIDS_OK;
+    const char *names[2] = {"tree union", "weighted by rows"};
+    for (int m = 0; m < 2 && status == HIDS_OK; m++) {
+        merge_bench_row(names[m], merged[m], test, is_anomaly, reference, scores);
+
+        // Sources and per-tree normalizers survive a save and load
+        size_t size = hids_model_size(merged[m]);
+        void *data = malloc(size);
+        hids_model *copy = NULL;
+        double *copy_scores = (double*)malloc(MERGE_BENCH_TEST * sizeof(double));
+        if (hids_serialize(merged[m], data, size) != HIDS_OK || hids_deserialize(data, size, &copy) != HIDS_OK ||
+            hids_model_sources(copy) != MERGE_BENCH_HOSTS) {
+            failures++;
+        } else {
+            hids_score_batch(copy, test, MERGE_BENCH_TEST, MAX_SYSCALLS, copy_scores);
+            if (memcmp(copy_scores, scores, MERGE_BENCH_TEST * sizeof(double)) != 0) failures++;
+        }
+        hids_model_free(copy);
+        free(copy_scores);
+        free(data);
+    }
+
+    printf("\n  %-10s %8s %8s %10s %10s\n", "Source", "Trees", "Samples", "Union", "Weighted");
+    for (uint32_t s = 0; status == HIDS_OK && s < hids_model_sources(merged[0]); s++) {
+        hids_source_info unioned, weighted;
+        hids_model_source(merged[0], s, &unioned);
+        hids_model_source(merged[1], s, &weighted);
+        printf("  %-10s %8u %8u %9.1f%% %9.1f%%\n", unioned.host, unioned.num_trees, unioned.subsample_size,
+               unioned.weight * 100, weighted.weight * 100);
+    }
+    printf("\n  Round trip:   %s\n", failures ? "FAILED" : "merged models reload with identical scores");
+
+    for (int h = 0; h < MERGE_BENCH_HOSTS; h++) hids_model_free(models[h]);
+    hids_model_free(merged[0]);
+    hids_model_free(merged[1]);
+    hids_model_free(central);
+    free(rows);
+    free(test);
+    free(is_anomaly);
+    free(reference);
+    free(scores);
+    return failures == 0 ? 0 : 1;
+}
+
+// Streaming drift checks as occasional syscalls grow, and what observing
+// costs per scored sample
+int bench_drift(void) {
+    srand(42);
+    int32_t *rows = (int32_t*)malloc(DRIFT_BENCH_WINDOW * MAX_SYSCALLS * sizeof(int32_t));
+    double *scores = (double*)malloc(DRIFT_BENCH_WINDOW * sizeof(double));
+    ProcessBehavior p;
+    for (int i = 0; i < BENCH_TRAIN_SIZE * 16; i++) {
+        generate_normal_behavior(&p, "train");
+        memcpy(&rows[i * MAX_SYSCALLS], p.syscall_freq, MAX_SYSCALLS * sizeof(int32_t));
+    }
+    hids_train_options options;
+    hids_train_options_default(&options);
+    options.num_features = MAX_SYSCALLS;
+    options.num_trees = NUM_TREES;
+    options.subsample_size = SUBSAMPLE_SIZE;
+    options.max_depth = MAX_TREE_DEPTH;
+    options.seed = 42;
+    hids_model *model = NULL;
+    hids_drift *drift = NULL;
+    if (hids_train(rows, BENCH_TRAIN_SIZE * 16, MAX_SYSCALLS, &options, &model) != HIDS_OK ||
+        hids_model_set_baseline(model, rows, BENCH_TRAIN_SIZE * 16, MAX_SYSCALLS) != HIDS_OK ||
+        hids_drift_create(model, &drift) != HIDS_OK) {
+        hids_model_free(model);
+        free(rows);
+        free(scores);
+        return 1;
+    }
+
+    printf("\n[DRIFT] Baseline from %d training samples, a check every %d scored samples\n\n",
+           BENCH_TRAIN_SIZE * 16, DRIFT_BENCH_WINDOW);
+    printf("  %-7s %6s %11s %10s %10s %14s %8s\n", "Window", "Drift", "Score mean", "Score PSI", "Max PSI",
+           "Worst syscall", "Signal");
+    int false_alarms = 0, detected_at = -1;
+    for (int w = 0; w < DRIFT_BENCH_WINDOWS; w++) {
+        // After the steady half, occasional syscalls (5-9) drift upwards
+        int shift = w < DRIFT_BENCH_WINDOWS / 2 ? 0 : w - DRIFT_BENCH_WINDOWS / 2 + 1;
+        for (int i = 0; i < DRIFT_BENCH_WINDOW; i++) {
+            generate_normal_behavior(&p, "live");
+            for (int s = 5; s < 10; s++) p.syscall_freq[s] += shift;
+            memcpy(&rows[i * MAX_SYSCALLS], p.syscall_freq, MAX_SYSCALLS * sizeof(int32_t));
+        }
+        hids_score_batch(model, rows, DRIFT_BENCH_WINDOW, MAX_SYSCALLS, scores);
+        hids_drift_observe(drift, rows, DRIFT_BENCH_WINDOW, MAX_SYSCALLS, scores);
+
+        hids_drift_report report;
+        hids_drift_check(drift, &report);
+        hids_drift_reset(drift);
+        printf("  %-7d %+6d %11.4f %10.4f %10.4f %14u %8s\n", w, shift, report.score_mean, report.score_psi,
+               report.max_feature_psi, report.worst_feature, report.retrain ? "RETRAIN" : "-");
+        if (report.retrain && shift == 0) false_alarms++;
+        if (report.retrain && shift > 0 && detected_at < 0) detected_at = shift;
+    }
+
+    // Overhead on the last window, scoring alone vs scoring and observing
+    uint64_t score_ns = 0, observe_ns = 0;
+    for (int r = 0; r < DRIFT_BENCH_ROUNDS; r++) {
+        uint64_t start = now_ns();
+        hids_score_batch(model, rows, DRIFT_BENCH_WINDOW, MAX_SYSCALLS, scores);
+        uint64_t scored = now_ns();
+        hids_drift_observe(drift, rows, DRIFT_BENCH_WINDOW, MAX_SYSCALLS, scores);
+        score_ns += scored - start;
+        observe_ns += now_ns() - scored;
+    }
+    double per_score = (double)score_ns / (DRIFT_BENCH_ROUNDS * DRIFT_BENCH_WINDOW);
+    double per_observe = (double)observe_ns / (DRIFT_BENCH_ROUNDS * DRIFT_BENCH_WINDOW);
+    printf("\n  Detection:    %d false alarms while steady, first signal at %+d calls per syscall\n", false_alarms,
+           detected_at);
+    printf("  Overhead:     %.1f ns/sample observing (%d features + score) on %.1f ns/sample scoring, %.1f%%\n",
+           per_observe, MAX_SYSCALLS, per_score, per_observe / per_score * 100);
+    printf("  Memory:       %zu bytes per monitor, whatever the stream length\n", hids_drift_size(drift));
+
+    hids_drift_free(drift);
+    hids_model_free(model);
+    free(rows);
+    free(scores);
+    return false_alarms == 0 && detected_at > 0 ? 0 : 1;
+}
+
+// Named benchmark, run with: ./hids --bench <name>
+typedef struct {
+    const char *name;
+    int (*run)(void);
+    const char *description;
+} Benchmark;
+
+Benchmark benchmarks[] = {
+    {"rt-latency", bench_rt_latency, "Real-time scoring latency under noisy-neighbor load"},
+    {"rescore", bench_rescore, "Event-driven vs fixed-interval rescoring: CPU and detection delay"},
+    {"queue", bench_queue, "Risk-ordered vs FIFO scoring queue under overload"},
+    {"sampling", bench_sampling, "Syscall sampling rate vs detection AUC and collection cost"},
+    {"latency", bench_latency, "Per-stage latency histograms from syscall to INTRUSION line"},
+    {"metrics", bench_metrics, "Counter overhead on scoring throughput, and a metrics scrape"},
+    {"sink", bench_sink, "10M results written with fprintf vs the async result sink"},
+    {"alerts", bench_alerts, "Alert lines with and without deduplication and rate limiting"},
+    {"attribution", bench_attribution, "Cost and accuracy of top-k syscall attribution"},
+    {"tree", bench_tree, "Process-tree and cgroup aggregation vs per-process scoring"},
+    {"windows", bench_windows, "Multi-resolution windows vs one window on burst and slow attacks"},
+    {"shards", bench_shards, "Contended process updates: shared atomics vs per-thread shards, 1-64 threads"},
+    {"pool", bench_pool, "50k process creations/s: pooled records, per-thread caches, epoch reclamation"},
+    {"checkpoint", bench_checkpoint, "Checkpoint pause, write and restore time for 1M tracked processes"},
+    {"numa", bench_numa, "Scoring throughput: shared forest vs per-node replicas, local and remote"},
+    {"hugepages", bench_hugepages, "Tree building and scoring with 4KB vs huge-page dataset and model"},
+    {"budget", bench_budget, "Holding a 5% CPU budget under synthetic overload by shedding work"},
+    {"autotune", bench_autotune, "Startup calibration of scoring kernel and batch size, cold and cached"},
+    {"libhids", bench_libhids, "libhids scoring in-process vs one subprocess per batch, batch 1-1024"},
+    {"sharded", bench_sharded, "Training time with 1-8 worker processes over Unix sockets, one shard each"},
+    {"merge", bench_merge, "Host forests merged by tree union and by weight vs a centrally trained forest"},
+    {"drift", bench_drift, "Streaming score and syscall drift checks, and their cost per scored sample"},
+};
+
+int run_benchmark(const char *name) {
+    int count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+    for (int i = 0; i < count; i++) {
+        if (name != NULL && strcmp(name, benchmarks[i].name) == 0) {
+            return benchmarks[i].run();
+        }
+    }
+
+    printf("Available benchmarks:\n");
+    for (int i = 0; i < count; i++) {
+        printf("  %-20s %s\n", benchmarks[i].name, benchmarks[i].description);
+    }
+    return name == NULL ? 0 : 1;
+}
+
+// ==================== MODEL FILE FRONTEND ====================
+
+// ./hids --train MODEL < rows: train on normal behavior and save the model
+// ./hids --score MODEL < rows > scores: one double per row
+int model_frontend(const char *mode, const char *path) {
+    size_t n;
+    int32_t *rows = read_rows(STDIN_FILENO, &n);
+    if (rows == NULL) {
+        fprintf(stderr, "hids: %s\n", hids_strerror(HIDS_ERR_NOMEM));
+        return 1;
+    }
+    hids_model *model = NULL;
+    hids_status status;
+    if (strcmp(mode, "--train") == 0) {
+        hids_train_options options;
+        hids_train_options_default(&options);
+        options.num_features = MAX_SYSCALLS;
+        options.num_trees = NUM_TREES;
+        options.subsample_size = SUBSAMPLE_SIZE;
+        options.max_depth = MAX_TREE_DEPTH;
+        status = hids_train(rows, n, MAX_SYSCALLS, &options, &model);
+        if (status == HIDS_OK) status = hids_model_set_baseline(model, rows, n, MAX_SYSCALLS);
+        if (status == HIDS_OK) status = hids_save(model, path);
+    } else {
+        status = hids_load(path, &model);
+        if (status == HIDS_OK && hids_model_features(model) != MAX_SYSCALLS) status = HIDS_ERR_FORMAT;
+        double *scores = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+        if (status == HIDS_OK && scores == NULL) status = HIDS_ERR_NOMEM;
+        if (status == HIDS_OK) status = hids_score_batch(model, rows, n, MAX_SYSCALLS, scores);
+        if (status == HIDS_OK && fwrite(scores, sizeof(double), n, stdout) != n) status = HIDS_ERR_IO;
+
+        // Compare the batch with the training baseline, if the model has one
+        hids_drift *drift = NULL;
+        if (status == HIDS_OK && hids_model_has_baseline(model) && hids_drift_create(model, &drift) == HIDS_OK) {
+            hids_drift_report report;
+            hids_drift_observe(drift, rows, n, MAX_SYSCALLS, scores);
+            hids_drift_check(drift, &report);
+            if (report.retrain) {
+                fprintf(stderr, "[DRIFT] retrain recommended: score PSI %.3f, syscall %u PSI %.3f (mean moved %.1f sd)\n",
+                        report.score_psi, report.worst_feature, report.max_feature_psi, report.worst_feature_shift);
+            }
+            hids_drift_free(drift);
+        }
+        free(scores);
+    }
+    if (status != HIDS_OK) fprintf(stderr, "hids: %s: %s\n", path, hids_strerror(status));
+    hids_model_free(model);
+    free(rows);
+    return status == HIDS_OK ? 0 : 1;
+}
+
+// ./hids --import-sklearn DUMP MODEL: convert a scikit-learn forest dumped
+// by scripts/export_sklearn.py into a model file for --score
+int import_frontend(const char *dump, const char *path) {
+    hids_model *model = NULL;
+    hids_status status = hids_import_sklearn(dump, &model);
+    if (status != HIDS_OK) {
+        fprintf(stderr, "hids: %s: %s\n", dump, hids_strerror(status));
+        return 1;
+    }
+    status = hids_save(model, path);
+    if (status != HIDS_OK) fprintf(stderr, "hids: %s: %s\n", path, hids_strerror(status));
+    else printf("[IMPORT] %u features, anomalous above %.4f\n", hids_model_features(model), hids_model_threshold(model));
+    hids_model_free(model);
+    return status == HIDS_OK ? 0 : 1;
+}
+
+// ./hids --merge OUT union|weighted HOST=MODEL[@WEIGHT]...: merge host
+// forests into one model, keeping each host as a source
+int merge_frontend(const char *path, const char *mode, int argc, char **argv) {
+    if (argc < 1 || argc > HIDS_MAX_TREES || (strcmp(mode, "union") != 0 && strcmp(mode, "weighted") != 0)) {
+        fprintf(stderr, "usage: hids --merge OUT union|weighted HOST=MODEL[@WEIGHT]...\n");
+        return 1;
+    }
+    hids_merge_input *inputs = (hids_merge_input*)calloc(argc, sizeof(hids_merge_input));
+    hids_model **models = (hids_model**)calloc(argc, sizeof(hids_model*));
+    hids_status status = inputs != NULL && models != NULL ? HIDS_OK : HIDS_ERR_NOMEM;
+    const char *failed = path;
+    for (int i = 0; i < argc && status == HIDS_OK; i++) {
+        char *model_path = strchr(argv[i], '=');
+        char *weight = strrchr(argv[i], '@');
+        if (model_path != NULL) *model_path++ = '\0';
+        else model_path = argv[i];
+        if (weight != NULL && weight > model_path) *weight++ = '\0';
+        else weight = NULL;
+        status = hids_load(model_path, &models[i]);
+        failed = model_path;
+        inputs[i] = (hids_merge_input){models[i], argv[i], weight != NULL ? atof(weight) : 1.0};
+    }
+    hids_model *merged = NULL;
+    if (status == HIDS_OK) {
+        status = hids_merge_forests(inputs, argc, strcmp(mode, "union") == 0 ? HIDS_MERGE_UNION : HIDS_MERGE_WEIGHTED,
+                                    &merged);
+        failed = "merge";
+    }
+    if (status == HIDS_OK) {
+        status = hids_save(merged, path);
+        failed = path;
+    }
+    if (status != HIDS_OK) {
+        fprintf(stderr, "hids: %s: %s\n", failed, hids_strerror(status));
+    } else {
+        for (uint32_t s = 0; s < hids_model_sources(merged); s++) {
+            hids_source_info info;
+            hids_model_source(merged, s, &info);
+            printf("[MERGE] %-20s %5u trees of %4u samples, %5.1f%% of the score\n", info.host, info.num_trees,
+                   info.subsample_size, info.weight * 100);
+        }
+    }
+    hids_model_free(merged);
+    for (int i = 0; models != NULL && i < argc; i++) hids_model_free(models[i]);
+    free(models);
+    free(inputs);
+    return status == HIDS_OK ? 0 : 1;
+}
+
+// ./hids --train-coordinator MODEL SOCKET WORKERS [TREES [SEED]]: train a
+// forest from WORKERS workers connecting on SOCKET and save it. SEED 0 or
+// none seeds from the clock.
+int coordinator_frontend(const char *path, const char *socket_path, int workers, int num_trees, uint64_t seed) {
+    hids_train_options options;
+    hids_train_options_default(&options);
+    options.num_features = MAX_SYSCALLS;
+    options.num_trees = num_trees > 0 ? (uint32_t)num_trees : NUM_TREES;
+    options.subsample_size = SUBSAMPLE_SIZE;
+    options.max_depth = MAX_TREE_DEPTH;
+    options.seed = seed;
+
+    int listen_fd = shard_listen(socket_path);
+    if (listen_fd < 0) {
+        fprintf(stderr, "hids: %s: %s\n", socket_path, strerror(errno));
+        return 1;
+    }
+    ShardWorkerStats stats[SHARD_MAX_WORKERS];
+    hids_model *model = NULL;
+    hids_status status = shard_coordinate(listen_fd, workers, &options, &model, stats);
+    close(listen_fd);
+    unlink(socket_path);
+    if (status == HIDS_OK) status = hids_save(model, path);
+    if (status != HIDS_OK) {
+        fprintf(stderr, "hids: %s: %s\n", path, hids_strerror(status));
+    } else {
+        for (int w = 0; w < workers; w++) {
+            printf("[SHARD] worker %d: %llu rows, %u trees, load %.1f ms, train %.1f ms\n", w,
+                   (unsigned long long)stats[w].rows, stats[w].trees, stats[w].load_ns / 1e6, stats[w].train_ns / 1e6);
+        }
+    }
+    hids_model_free(model);
+    return status == HIDS_OK ? 0 : 1;
+}
+
+// ==================== MAIN PROGRAM ====================
+
+int main(int argc, char *argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+        return run_benchmark(argc >= 3 ? argv[2] : NULL);
+    }
+    if (argc >= 3 && (strcmp(argv[1], "--train") == 0 || strcmp(argv[1], "--score") == 0)) {
+        return model_frontend(argv[1], argv[2]);
+    }
+    if (argc >= 4 && strcmp(argv[1], "--import-sklearn") == 0) {
+        return import_frontend(argv[2], argv[3]);
+    }
+    if (argc >= 5 && strcmp(argv[1], "--train-coordinator") == 0) {
+        return coordinator_frontend(argv[2], argv[3], atoi(argv[4]), argc >= 6 ? atoi(argv[5]) : 0,
+                                    argc >= 7 ? strtoull(argv[6], NULL, 0) : 0);
+    }
+    if (argc >= 4 && strcmp(argv[1], "--merge") == 0) {
+        return merge_frontend(argv[2], argv[3], argc - 4, argv + 4);
+    }
+    if (argc >= 4 && strcmp(argv[1], "--train-worker") == 0) {
+        hids_status status = shard_work(argv[2], argv[3]);
+        if (status != HIDS_OK) fprintf(stderr, "hids: %s: %s\n", argv[3], hids_strerror(status));
+        return status == HIDS_OK ? 0 : 1;
+    }
+
+    srand(time(NULL));
+    tsc_calibrate();                  // Latency histograms count TSC ticks
+    metrics_register_thread();
+    
+    printf("======================================================\n");
+    printf("  Host-Based Intrusion Detection System (HIDS)\n");
+    printf("  System Call Anomaly Detection using Isolation Forest\n");
+    printf("======================================================\n");
+    
+    // Generate training dataset (normal behavior only)
+    int train_size = 20;
+    ProcessBehavior *training_data = (ProcessBehavior*)malloc(train_size * sizeof(ProcessBehavior));
+    
+    printf("\n[DATA] Generating training dataset...\n");
+    for (int i = 0; i < train_size; i++) {
+        char name[50];
+        sprintf(name, "train_proc_%d", i);
+        generate_normal_behavior(&training_data[i], name);
+    }
+    printf("[DATA] Generated %d normal process behaviors for training\n", train_size);
+    
+    // Train Isolation Forest
+    IsolationForest *forest = train_isolation_forest(training_data, train_size);
+    if (forest == NULL) {
+        free(training_data);
+        return 1;
+    }
+    
+    // Generate test dataset (mix of normal and anomalous)
+    int test_size = 10;
+    ProcessBehavior *test_data = (ProcessBehavior*)malloc(test_size * sizeof(ProcessBehavior));
+    
+    printf("\n[DATA] Generating test dataset...\n");
+    for (int i = 0; i < test_size; i++) {
+        char name[50];
+        sprintf(name, "test_proc_%d", i);
+        
+        // 60% normal, 40% anomalous
+        if (i < 6) {
+            generate_normal_behavior(&test_data[i], name);
+        } else {
+            generate_anomalous_behavior(&test_data[i], name);
+        }
+    }
+    printf("[DATA] Generated %d test process behaviors\n", test_size);
+    
+    // Pick the fastest scoring kernel for this model and CPU, or reuse the
+    // decision cached by an earlier run
+    CompactForest model;
+    if (compact_forest_build(&model, forest) != 0) {
+        fprintf(stderr, "Failed to flatten the forest\n");
+        return 1;
+    }
+    char cache[512];
+    autotune_cache_path(cache, sizeof(cache), "hids_autotune");
+    ScoringPlan plan = autotune_scoring(forest, &model, cache, NULL, NULL);
+    
+    // Watch scored behavior against the training data's distribution
+    hids_drift *drift = NULL;
+    hids_status drift_status = hids_model_set_baseline(forest->model, &training_data[0].syscall_freq[0], train_size,
+                                                       BEHAVIOR_STRIDE);
+    if (drift_status != HIDS_OK || hids_drift_create(forest->model, &drift) != HIDS_OK) {
+        fprintf(stderr, "[DRIFT] Monitor unavailable; scoring without it\n");
+    }
+    
+    // Detect intrusions
+    detect_intrusions(forest, &model, &plan, test_data, test_size, NULL, drift);
+    
+    // Cleanup
+    hids_drift_free(drift);
+    compact_forest_free(&model);
+    free_forest(forest);
+    free(training_data);
+    free(test_data);
+    
+    printf("\n[COMPLETE] HIDS execution finished successfully!\n");
+    printf("======================================================\n");
+    
+    return 0;
+
+}
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+# Score synthetic syscall counts from Python: the hids binding on the whole
+# array, a pure-Python loop converting and scoring one row at a time, and
+# scikit-learn's IsolationForest.decision_function.
+#
+# Build the binding in the repo root first (see hidsmodule.c), then:
+#   python3 scripts/bench_python.py [--rows 10000000] [--loop-rows 100000]
+
+import argparse
+import array
+import os
+import sys
+import time
+
+import numpy as np
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+import hids
+
+FEATURES = 20
+
+
+# Same shape as generate_normal_behavior() / generate_anomalous_behavior()
+def generate(rng, n, anomalous_fraction):
+    rows = rng.integers(0, 5, size=(n, FEATURES), dtype=np.int32)
+    rows[:, :5] = rng.integers(40, 60, size=(n, 5), dtype=np.int32)
+    attacks = rng.random(n) < anomalous_fraction
+    rows[attacks, :5] = rng.integers(0, 5, size=(attacks.sum(), 5), dtype=np.int32)
+    rows[attacks, 11:] = rng.integers(0, 50, size=(attacks.sum(), FEATURES - 11), dtype=np.int32)
+    return rows
+
+
+def timed(label, rows, fn):
+    start = time.perf_counter()
+    result = fn()
+    elapsed = time.perf_counter() - start
+    print(f"  {label:<34} {elapsed:9.3f} s {elapsed / rows * 1e9:10.1f} ns/row")
+    return result, elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--rows", type=int, default=10_000_000)
+    parser.add_argument("--loop-rows", type=int, default=100_000, help="rows timed for the pure-Python loop")
+    args = parser.parse_args()
+
+    rng = np.random.default_rng(42)
+    train = generate(rng, 256, 0.0)
+    rows = generate(rng, args.rows, 0.05)
+    model = hids.train(train, num_trees=10, subsample_size=8, max_depth=10, seed=42)
+    print(f"\n[PYTHON] {args.rows} rows of {FEATURES} features, 10 trees, {os.cpu_count()} CPUs\n")
+
+    scores, _ = timed("hids, int32 in place, 1 thread", args.rows, lambda: model.score(rows, threads=1))
+    expected = np.frombuffer(scores, dtype=np.float64)
+    out = np.empty(args.rows)
+    _, native = timed("hids, int32 in place, all threads", args.rows, lambda: model.score(rows, out=out))
+    mismatches = int((out != expected).sum())
+    as_float = rows.astype(np.float32)
+    timed("hids, float32 converted per block", args.rows, lambda: model.score(as_float, out=out))
+    mismatches += int((out != expected).sum())
+
+    # One row at a time, as scoring scripts convert each process record
+    n = min(args.loop_rows, args.rows)
+    def loop():
+        result = []
+        for row in rows[:n].tolist():
+            sample = memoryview(array.array("i", row)).cast("B").cast("i", (1, FEATURES))
+            result.append(model.score(sample, threads=1)[0])
+        return result
+    looped, elapsed = timed(f"pure-Python loop ({n} rows)", n, loop)
+    mismatches += int((np.array(looped) != expected[:n]).sum())
+    print(f"  {'  extrapolated to all rows':<34} {elapsed / n * args.rows:9.1f} s")
+
+    try:
+        from sklearn.ensemble import IsolationForest
+    except ImportError:
+        print("  scikit-learn not installed, skipping IsolationForest.decision_function")
+    else:
+        forest = IsolationForest(n_estimators=10, max_samples=8, random_state=42).fit(train.astype(np.float32))
+        _, sklearn = timed("sklearn decision_function", args.rows, lambda: forest.decision_function(as_float))
+        print(f"\n  Speedup:      {sklearn / native:.1f}x over scikit-learn")
+
+    print(f"  Agreement:    {mismatches} scores differ between paths")
+    return 0 if mismatches == 0 else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+# Dump a scikit-learn IsolationForest for hids_import_sklearn(); the layout
+# is documented in hids.h.
+#
+# Usage: scripts/export_sklearn.py MODEL DUMP   (model saved with joblib or pickle)
+#        scripts/export_sklearn.py --check       (needs the hids binding)
+#
+# --check fits forests on fixture syscall counts, imports their dumps and
+# fails unless the native scores match score_samples() and predict().
+
+import os
+import struct
+import sys
+import tempfile
+
+import numpy as np
+
+MAGIC = 0x4C4B5348  # "HSKL"
+VERSION = 1
+
+
+def export(forest, path):
+    n_features = forest.n_features_in_
+    with open(path, "wb") as f:
+        f.write(struct.pack("=6Id", MAGIC, VERSION, n_features, len(forest.estimators_), forest.max_samples_, 0,
+                            forest.offset_))
+        for estimator, features in zip(forest.estimators_, forest.estimators_features_):
+            tree = estimator.tree_
+            # Trees fit on a feature subset number their features within it
+            subset = forest._max_features != n_features
+            f.write(struct.pack("=I", tree.node_count))
+            for i in range(tree.node_count):
+                leaf = tree.children_left[i] == -1
+                feature = -1 if leaf else int(features[tree.feature[i]] if subset else tree.feature[i])
+                f.write(struct.pack("=4id", int(tree.children_left[i]), int(tree.children_right[i]), feature,
+                                    int(tree.n_node_samples[i]), 0.0 if leaf else float(tree.threshold[i])))
+
+
+# Syscall count fixtures shaped like generate_normal_behavior(), with 5% attacks
+def fixture(rng, n):
+    rows = rng.integers(0, 5, size=(n, 20), dtype=np.int32)
+    rows[:, :5] = rng.integers(40, 60, size=(n, 5), dtype=np.int32)
+    attacks = rng.random(n) < 0.05
+    rows[attacks, 11:] = rng.integers(0, 50, size=(attacks.sum(), 9), dtype=np.int32)
+    return rows
+
+
+def check():
+    sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+    import hids
+    from sklearn.ensemble import IsolationForest
+
+    rng = np.random.default_rng(7)
+    train, test = fixture(rng, 2000), fixture(rng, 20000)
+    configs = [
+        dict(n_estimators=10, max_samples=8),
+        dict(n_estimators=100),
+        dict(n_estimators=50, max_samples=512, contamination=0.05),
+        dict(n_estimators=30, max_samples=64, max_features=0.5),
+        dict(n_estimators=20, max_samples=1.0, bootstrap=True, contamination=0.1),
+    ]
+    failures = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        dump = os.path.join(tmp, "forest.hskl")
+        for config in configs:
+            forest = IsolationForest(random_state=42, **config).fit(train)
+            export(forest, dump)
+            model = hids.import_sklearn(dump)
+            scores = np.frombuffer(model.score(test))
+            diff = np.abs(scores + forest.score_samples(test)).max()
+            predicted = np.where(scores > model.threshold, -1, 1)
+            disagree = int((predicted != forest.predict(test)).sum())
+            ok = diff < 1e-9 and disagree == 0
+            failures += not ok
+            print(f"  {'ok  ' if ok else 'FAIL'} {config}: max score difference {diff:.1e}, "
+                  f"{disagree} predictions differ")
+    return 1 if failures else 0
+
+
+def main():
+    if sys.argv[1:] == ["--check"]:
+        return check()
+    if len(sys.argv) != 3:
+        print("usage: export_sklearn.py MODEL DUMP | --check", file=sys.stderr)
+        return 2
+    import joblib
+    export(joblib.load(sys.argv[1]), sys.argv[2])
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
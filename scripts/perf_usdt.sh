@@ -0,0 +1,22 @@
+#!/bin/sh
+# Record the detector's USDT probes with perf and print per-probe counts.
+#
+# Usage: scripts/perf_usdt.sh [path/to/hids] [hids arguments...]
+#   e.g. scripts/perf_usdt.sh ./hids --bench latency
+#
+# Needs perf built with SDT support and permission to create uprobes.
+
+set -e
+HIDS=${1:-./hids}
+[ $# -gt 0 ] && shift
+
+perf buildid-cache --add "$HIDS"
+for probe in tree__start tree__done score__start score__done score_batch__start score_batch__done \
+             batch__start batch__done alert; do
+    perf probe -q -d "sdt_hids:$probe" 2>/dev/null || true
+    perf probe -q -x "$HIDS" "sdt_hids:$probe"
+done
+
+perf record -q -e 'sdt_hids:*' -o hids.perf.data -- "$HIDS" "$@" > /dev/null
+perf script -i hids.perf.data -F event | sort | uniq -c
+echo "Full trace with timestamps: perf script -i hids.perf.data"